@@ -0,0 +1,47 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+#include "array.h"
+#include "list.h"
+#include "cloth.h"
+#include "network.h"
+#include "event.h"
+#include "metrics.h"
+#include "group_add_queue.h"
+
+/* Checkpoint of the simulation (see `checkpoint_time` and `restore_filename` in cloth_input.txt).
+
+   It is written just before the first event at or after `checkpoint_time` is executed, and it contains the whole state
+   of the simulation at that point: the network (nodes with their mission control, channels, edges with their hot and cold state,
+   groups with their history), the group add queue, the payments with their routes and attempts, the initial paths not used yet,
+   the pending events in the order of the scheduler (the event about to be executed first), the metrics, the state of the random
+   generator, `simulation->current_time` and the counters (`network_version`, `group_attempt_counter`).
+   A simulation restored from it executes the same events in the same order as the one which wrote it.
+
+   The file starts with the magic "CLOTHCKP" and the format version (uint32); every section starts with an 8 byte tag.
+   The values and the structures are written with the byte order and the layout of the host: a checkpoint must be read
+   by the same build of CLoTH which wrote it */
+
+#define CHECKPOINT_MAGIC "CLOTHCKP"
+#define CHECKPOINT_VERSION 1
+#define CHECKPOINT_TAG_SIZE 8
+
+struct checkpoint {
+  struct network* network;
+  struct array* payments;
+  struct group_add_queue* group_add_queue;
+  struct event* next_event; // the event which was about to be executed
+  struct array** paths;     // initial paths of the payments, NULL if already used
+  long n_paths;
+  struct metrics* metrics;  // NULL if the metrics were not accumulated
+};
+
+void write_checkpoint(char filename[], struct simulation* simulation, struct network* network, struct array* payments,
+                      struct group_add_queue* group_add_queue, struct event* next_event, struct metrics* metrics);
+
+struct checkpoint* read_checkpoint(char filename[], struct network_params net_params, struct simulation* simulation);
+
+void restore_initial_paths(struct checkpoint* checkpoint);
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include "heap.h"
+#include "scheduler.h"
 #include <gsl/gsl_rng.h>
 #include <gsl/gsl_randist.h>
 
@@ -19,10 +20,17 @@ struct network_params{
   char nodes_filename[256];
   char channels_filename[256];
   char edges_filename[256];
+  char network_snapshot_filename[256]; // binary snapshot read instead of the csv files, if not empty (see snapshot.h)
   unsigned int payment_timeout; // set -1 to disable payment timeout
   unsigned int average_payment_forward_interval;
   unsigned int variance_payment_forward_interval;
   enum routing_method routing_method;
+  enum scheduler_type event_scheduler;
+  long n_threads; // dijkstra threads, the number of processors if <= 0
+  unsigned int speculative_pathfinding; // find the paths of the upcoming FINDPATH events in advance in the dijkstra threads
+  long speculation_window; // payments whose first attempt is speculated in a round
+  unsigned int route_cache; // reuse the paths found for the same endpoints and similar amounts (channel_update and group_routing)
+  long channel_update_history; // most recent channel updates kept for each edge
   unsigned int group_cap_update;
   unsigned int group_broadcast_delay;
   int group_size;
@@ -41,6 +49,21 @@ struct network_params{
   int      enable_group_event_csv;   /* bool: CSVログ有効/無効 */
   char     group_event_csv_filename[256];
   int  enable_group_trace_verbose;
+  int      locked_balance_trace;     /* bool: HTLCごとのロック残高を locked_balance_trace.csv に書き出す */
+  int      binary_output;            /* bool: 支払いを列指向バイナリ payments_output.bin にも書き出す */
+  int      metrics_summary;          /* bool: 評価指標をシミュレーション中に集計し metrics_summary.csv に1行で書き出す */
+  long     progress_every_events;    /* progress.tmp の更新間隔（イベント数, 0で無効） */
+  double   progress_every_seconds;   /* progress.tmp の更新間隔（秒, 0で無効） */
+  int      progress_mmap;            /* bool: progress.tmp をmmapして更新 */
+
+  /* === checkpoint/restore === */
+  uint64_t checkpoint_time;          /* この時刻(ms)以降の最初のイベントの実行直前に状態を書き出す（0で無効） */
+  char     checkpoint_filename[256];
+  char     restore_filename[256];    /* 空でなければこのチェックポイントから再開 */
+
+  /* === parameter sweep === */
+  char     sweep_filename[256];      /* 空でなければ各行のパラメータで子プロセスごとにシミュレーション（sweep.h参照） */
+  long     sweep_processes;          /* 同時に実行する子プロセス数（0以下でプロセッサ数） */
 
   /* === optional: per-edge tau randomization === */
   int      tau_randomize;            /* bool */
@@ -58,11 +81,13 @@ struct payments_params{
   unsigned int mpp;
   double max_fee_limit_mu; // average_max_fee_limit [satoshi]
   double max_fee_limit_sigma; // variance_max_fee_limit [satoshi]
+  unsigned int payments_csv_export; // write the random payments to "payments.csv"
+  unsigned int stream_payments; // generate the random payments while the simulation advances
 };
 
 struct simulation{
   uint64_t current_time; //milliseconds
-  struct heap* events;
+  struct scheduler* events;
   gsl_rng* random_generator;
 };
 
@@ -0,0 +1,41 @@
+#ifndef COLUMNAR_H
+#define COLUMNAR_H
+
+#include <stdint.h>
+#include "array.h"
+#include "network.h"
+
+/* Binary columnar output of the payments (see `binary_output` in cloth_input.txt and scripts/read_columnar.py).
+
+   All the integers are little-endian. The file starts with the magic "CLOTHCOL", the format version (uint32) and the number of
+   tables (uint32), followed by the directory of the tables; for each table:
+     name (16 bytes, zero padded), number of rows (uint64), number of columns (uint32), reserved (uint32),
+     and for each column: name (32 bytes, zero padded), offset of its data from the beginning of the file (uint64).
+   The data of a column are `number of rows` int64 values; missing values are -1.
+
+   Tables (in this order):
+     payments:      id, sender_id, receiver_id, amount, start_time, max_fee_limit, end_time, mpp, is_success, no_balance_count,
+                    offline_node_count, timeout_exp, attempts, total_fee, route_offset, route_len, attempts_offset, attempts_len
+     route_hops:    edge_id (the hops of the final route of the payments)
+     attempts:      payment_id, attempts, is_succeeded, end_time, error_edge, error_type, hops_offset, hops_len
+     attempt_hops:  edge_id, from_node_id, to_node_id, sent_amt, edge_cap, channel_cap, group_cap, channel_update
+   The rows of a payment (attempt) in a child table are [offset, offset + len); the rows have the order of payments_output.csv */
+
+#define COLUMNAR_MAGIC "CLOTHCOL"
+#define COLUMNAR_VERSION 1
+#define COLUMNAR_TABLE_NAME_SIZE 16
+#define COLUMNAR_COLUMN_NAME_SIZE 32
+
+struct columnar_table {
+  const char* name;
+  long n_columns;
+  const char** column_names;
+  long n_rows;
+  int64_t** columns;
+};
+
+void write_columnar_output(struct network* network, struct array* payments, char output_dir_name[]);
+
+void remove_columnar_output(char output_dir_name[]);
+
+#endif
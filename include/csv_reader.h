@@ -0,0 +1,35 @@
+#ifndef CSV_READER_H
+#define CSV_READER_H
+
+#include <stdint.h>
+
+/* Reader of the csv input files (network and payments): the file is mapped in memory and split at line boundaries into
+   chunks, which are parsed in parallel by the threads of a thread pool.
+   The first line of the file is the header and is skipped, as the blank lines; the first `n_columns` columns of each row
+   must be integers (negative values are stored in two's complement), the other columns are ignored */
+
+#define CSV_MIN_CHUNK_SIZE (1L << 16)
+#define CSV_CHUNKS_PER_THREAD 4
+
+struct csv_table {
+  long n_rows;
+  long n_columns;
+  uint64_t* values; // the column j of the row i is values[i*n_columns + j]
+  long* lines; // line number in the file of each row, for the error messages
+};
+
+static inline uint64_t csv_get(struct csv_table* table, long row, long column) {
+  return table->values[row*table->n_columns + column];
+}
+
+static inline long csv_get_long(struct csv_table* table, long row, long column) {
+  return (long) (int64_t) csv_get(table, row, column);
+}
+
+struct csv_table* read_csv_file(char filename[], long n_columns, long n_threads);
+
+long* csv_rows_in_id_order(struct csv_table* table, char filename[]);
+
+void free_csv_table(struct csv_table* table);
+
+#endif
@@ -36,8 +36,10 @@
 #include <stdio.h>
 
 #include "heap.h"
+#include "scheduler.h"
 #include "array.h"
 #include "payments.h"
+#include "output.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -64,13 +66,17 @@ struct event {
   enum event_type type;
   long node_id;
   struct payment *payment;
+  long hop_index; // HTLC events: position in the payment route of the hop entering `node_id` (-1 for the sender)
+  struct event* next; // used by the calendar queue scheduler and by the free list of the event pool
 };
 
 struct event* new_event(uint64_t time, enum event_type type, long node_id, struct payment* payment);
+void free_event(struct event* e);
+void free_event_pool(void);
 int compare_event(struct event* e1, struct event *e2);
-struct heap* initialize_events(struct array* payments);
+struct scheduler* initialize_events(struct array* payments, enum scheduler_type scheduler_type);
 
-extern FILE* csv_group_events;
+extern struct output_file* csv_group_events;
 
 /* CSV 出力先ディレクトリを指定してオープン（ヘッダも出力）。dirpath 配下に "group_events.csv" を作成。 */
 void group_events_open(const char* dirpath);
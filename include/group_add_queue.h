@@ -0,0 +1,52 @@
+#ifndef GROUP_ADD_QUEUE_H
+#define GROUP_ADD_QUEUE_H
+
+#include <stdint.h>
+#include "array.h"
+#include "network.h"
+
+/* queue of the edges waiting to join a group: the edges are kept in FIFO order (the order in which they are tried as seeds)
+   and are also indexed by balance with a skip list, so that the edges which can join a group are found with a range query
+   over [min_cap_limit, max_cap_limit] instead of a scan of the whole queue.
+   The key of an edge in the index is its balance when it was indexed: `group_add_queue_refresh` updates the keys of the
+   edges whose balance changed, before the index is queried */
+
+#define GROUP_ADD_QUEUE_MAX_LEVEL 24
+
+struct group_add_queue_item {
+  struct edge* edge;
+  uint64_t position; // position in FIFO order: increasing from the head to the tail
+  uint64_t balance; // key in the balance index (ties broken by edge id)
+  struct group_add_queue_item* prev;
+  struct group_add_queue_item* next;
+  int level;
+  struct group_add_queue_item* forward[]; // next items in the balance index, one per level
+};
+
+struct group_add_queue {
+  long len;
+  struct group_add_queue_item* head;
+  struct group_add_queue_item* tail;
+  uint64_t next_position;
+  int level;
+  struct group_add_queue_item* index; // sentinel of the balance index, with GROUP_ADD_QUEUE_MAX_LEVEL levels
+  uint64_t random_state; // levels of the skip list (the random generator of the simulation is not used)
+};
+
+struct group_add_queue* group_add_queue_initialize();
+
+void group_add_queue_push(struct group_add_queue* queue, struct edge* edge);
+
+void group_add_queue_push_by_balance(struct group_add_queue* queue, struct array* edges);
+
+void group_add_queue_remove(struct group_add_queue* queue, struct group_add_queue_item* item);
+
+void group_add_queue_rotate(struct group_add_queue* queue);
+
+void group_add_queue_refresh(struct group_add_queue* queue);
+
+struct array* group_add_queue_range(struct group_add_queue* queue, uint64_t min_balance, uint64_t max_balance, struct array* items);
+
+void group_add_queue_free(struct group_add_queue* queue);
+
+#endif
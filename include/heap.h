@@ -17,8 +17,16 @@ struct heap* heap_insert_or_update(struct heap *h, void* data, int(*compare)(),
 
 void* heap_pop(struct heap* h, int(*compare)());
 
+/* indexed variant: each element stores its own position in the heap (returned by `get_heap_index`, -1 when not in the heap),
+   so that an update (decrease-key) costs O(log n) instead of a linear scan */
+struct heap* heap_insert_or_update_indexed(struct heap *h, void* data, int(*compare)(), long*(*get_heap_index)());
+
+void* heap_pop_indexed(struct heap* h, int(*compare)(), long*(*get_heap_index)());
+
 long heap_len(struct heap*h);
 
+void heap_clear(struct heap* h);
+
 void heap_free(struct heap* h);
 
 #endif
@@ -8,22 +8,19 @@
 #include "network.h"
 #include "payments.h"
 #include "event.h"
+#include "group_add_queue.h"
 
 #define OFFLINELATENCY 3000 //3 seconds waiting for a node not responding (tcp default retransmission time)
 
-/* a node pair result registers the most recent result of a payment (fail or success, with the corresponding amount and time)
-   that occurred when the payment traversed an edge connecting the two nodes of the node pair */
-struct node_pair_result{
-  long to_node_id;
-  uint64_t fail_time;
-  uint64_t fail_amount;
-  uint64_t success_time;
-  uint64_t success_amount;
-};
-
+/* group construction attempts so far (全体で単調増加), numbering the attempts in the group events */
+extern uint64_t group_attempt_counter;
 
 uint64_t compute_fee(uint64_t amount_to_forward, struct policy policy);
 
+struct array* find_payment_path(struct payment* payment, int attempt, struct network* network, uint64_t current_time, long p, enum routing_method routing_method);
+
+int has_path_enough_capacity(struct array* path, struct payment* payment, struct network* network, uint64_t current_time, enum routing_method routing_method);
+
 void find_path(struct event* event, struct simulation* simulation, struct network* network, struct array** payments, unsigned int mpp, enum routing_method routing_method, struct network_params net_params);
 
 void send_payment(struct event* event, struct simulation* simulation, struct network* network, struct network_params net_params);
@@ -44,10 +41,8 @@ void channel_update_fail(struct event* event, struct simulation* simulation, str
 
 void channel_update_success(struct event* event, struct simulation* simulation, struct network* network);
 
-// return `struct element* group_add_queue`
-struct element* request_group_update(struct event* event, struct simulation* simulation, struct network* network, struct network_params net_params, struct element* group_add_queue);
+void request_group_update(struct event* event, struct simulation* simulation, struct network* network, struct network_params net_params, struct group_add_queue* group_add_queue);
 
-// return `struct element* group_add_queue`
-struct element* construct_groups(struct simulation* simulation, struct element* group_add_queue, struct network *network, struct network_params net_params);
+void construct_groups(struct simulation* simulation, struct group_add_queue* group_add_queue, struct network *network, struct network_params net_params);
 
 #endif
@@ -0,0 +1,67 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include "network.h"
+#include "payments.h"
+
+#define N_METRICS_PERCENTILES 5
+
+/* streaming estimate of a quantile with the P-square algorithm (Jain and Chlamtac, 1985): five markers track the minimum, the
+   p/2, p, (1+p)/2 quantiles and the maximum, and their heights are adjusted with a piecewise-parabolic interpolation
+   as observations arrive, in constant memory. The first five observations are kept and give the exact quantile */
+struct p2_quantile {
+  double p;
+  long n;
+  double height[5];
+  double position[5];
+  double desired[5];
+  double increment[5];
+};
+
+/* count, mean, variance (Welford), minimum, maximum and percentiles of a distribution, accumulated one value at a time */
+struct online_stat {
+  long n;
+  double mean;
+  double m2;
+  double min;
+  double max;
+  struct p2_quantile percentiles[N_METRICS_PERCENTILES];
+};
+
+/* the metrics of `scripts/analyze_output.py` (RESULT_HEADER), accumulated while the payments complete
+   (see `metrics_summary` in cloth_input.txt) */
+struct metrics {
+  long n_payments;
+  long n_attempts;
+  long n_success;
+  long n_fail_no_path;
+  long n_fail_timeout;
+  long n_fail_no_alternative_path;
+  long n_retries;
+  long n_retries_no_balance;
+  uint64_t simulation_time;
+  struct online_stat time;
+  struct online_stat time_success;
+  struct online_stat time_fail;
+  struct online_stat retry;
+  struct online_stat fee;
+  struct online_stat fee_per_satoshi;
+  struct online_stat route_len;
+};
+
+void online_stat_initialize(struct online_stat* stat);
+
+void online_stat_add(struct online_stat* stat, double value);
+
+double online_stat_percentile(struct online_stat* stat, int i);
+
+struct metrics* metrics_initialize(void);
+
+void metrics_add_payment(struct metrics* metrics, struct payment* payment);
+
+void write_metrics_summary(struct metrics* metrics, struct network* network, double request_amt_rate, char output_dir_name[]);
+
+void metrics_free(struct metrics* metrics);
+
+#endif
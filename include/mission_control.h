@@ -0,0 +1,46 @@
+#ifndef MISSION_CONTROL_H
+#define MISSION_CONTROL_H
+
+#include <stdint.h>
+
+/* a node pair result registers the most recent result of a payment (fail or success, with the corresponding amount and time)
+   that occurred when the payment traversed an edge connecting the two nodes of the node pair */
+struct node_pair_result{
+  long from_node_id;
+  long to_node_id;
+  uint64_t fail_time;
+  uint64_t fail_amount;
+  uint64_t success_time;
+  uint64_t success_amount;
+};
+
+/* node pair results collected by a sender node (mission control).
+   It is allocated only for the nodes which actually send payments and it stores only the pairs they observed:
+   - `results` is a pool of node pair results;
+   - `pairs` is an open addressing hash table keyed by (from_node_id, to_node_id) containing indexes of `results`;
+   - `from_nodes`/`from_heads` is an open addressing hash table keyed by from_node_id containing the index of the most recent result of that from node;
+     the results of the same from node are chained through `next_result` (most recent first) */
+struct mission_control {
+  struct node_pair_result* results;
+  long* next_result;
+  long n_results;
+  long results_size;
+  long* pairs;
+  long pairs_size;
+  long* from_nodes;
+  long* from_heads;
+  long n_from_nodes;
+  long from_nodes_size;
+};
+
+struct mission_control* mission_control_initialize(long size);
+
+struct node_pair_result* mission_control_get(struct mission_control* mc, long from_node_id, long to_node_id);
+
+struct node_pair_result* mission_control_add(struct mission_control* mc, long from_node_id, long to_node_id);
+
+long mission_control_first(struct mission_control* mc, long from_node_id);
+
+void mission_control_free(struct mission_control* mc);
+
+#endif
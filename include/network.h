@@ -5,6 +5,7 @@
 #include <stdint.h>
 #include "cloth.h"
 #include "list.h"
+#include "mission_control.h"
 
 #define MAXMSATOSHI 5E17 //5 millions  bitcoin
 #define MAXTIMELOCK 100
@@ -31,7 +32,7 @@ struct policy {
 struct node {
   long id;
   struct array* open_edges;
-  struct element **results;
+  struct mission_control* mission_control; // node pair results of the payments sent by the node, NULL until it sends one
   unsigned int explored;
 };
 
@@ -46,20 +47,49 @@ struct channel {
   unsigned int is_closed;
 };
 
-/* an edge represents one of the two direction of a payment channel */
+/* an edge represents one of the two direction of a payment channel;
+   its mutable hot state (balance, group, flows) and its cold bookkeeping live in the `edge_store` of the network
+   and must be accessed through the `edge_*` accessors below */
 struct edge {
   long id;
+  struct edge_store* store;
   long channel_id;
   long from_node_id;
   long to_node_id;
   long counter_edge_id;
   struct policy policy;
-  uint64_t balance;
   unsigned int is_closed;
-  uint64_t tot_flows;
-  struct group* group;
-  struct element* channel_updates;
-  struct element* edge_locked_balance_and_durations;
+};
+
+struct channel_update {
+    long edge_id;
+    uint64_t time;
+    uint64_t htlc_maximum_msat;
+};
+
+/* channel updates of an edge: the initial one (the channel capacity, at time 0) and a ring buffer with the most recent ones,
+   at most `channel_update_history_size` (allocated at the first update) */
+struct channel_update_history {
+  struct channel_update initial;
+  struct channel_update* ring;
+  long n_updates; // updates received after the initial one, the ring keeps the last min(n_updates, channel_update_history_size)
+};
+
+#define LOCKED_HISTOGRAM_BUCKETS 16
+
+/* online statistics of the balance locked in an edge by the HTLCs of the payments, weighted by the lock duration:
+   bucket i of the histogram counts the locks with balance*duration (millisatoshi*ms) in [16^i, 16^(i+1)) (0 is in bucket 0) */
+struct edge_locked_stats {
+  uint64_t count;
+  uint64_t sum_balance_duration;
+  uint64_t max_balance_duration;
+  uint64_t histogram[LOCKED_HISTOGRAM_BUCKETS];
+};
+
+/* bookkeeping of an edge which is not used when forwarding payments or finding paths */
+struct edge_cold {
+  struct channel_update_history channel_updates;
+  struct edge_locked_stats locked_stats;
 
   /* === leave/rejoin metadata === */
   double   tolerance_tau;     /* UL threshold */
@@ -70,12 +100,20 @@ struct edge {
   /* === stats: how many times used as group min capacity === */
   uint64_t min_cap_use_count;
   unsigned int in_group_add_queue; /* 1 if this edge is currently enqueued */
+
+  uint64_t version; /* `network_version` of the last change of the capacity estimated for the edge (channel update, group) */
 };
 
-struct edge_locked_balance_and_duration{
-    uint64_t locked_balance;
-    uint64_t locked_start_time;
-    uint64_t locked_end_time;
+/* storage of the edges as struct of arrays indexed by edge id:
+   the fields read and written when forwarding payments and finding paths are packed in contiguous arrays,
+   the rest is kept in the `cold` side table */
+struct edge_store {
+  long size;
+  uint64_t* balance;
+  struct group** group;
+  uint64_t* tot_flows;
+  uint64_t* htlc_maximum_msat; // capacity estimated from the channel updates (see `add_channel_update`)
+  struct edge_cold* cold;
 };
 
 struct edge_snapshot {
@@ -88,15 +126,10 @@ struct edge_snapshot {
   uint64_t sent_amt;
 };
 
-struct channel_update {
-    long edge_id;
-    uint64_t time;
-    uint64_t htlc_maximum_msat;
-};
-
 struct group_update {
     uint64_t time;
     uint64_t group_cap;
+    long n_edges; /* length of edge_balances */
     uint64_t* edge_balances;
 };
 
@@ -113,6 +146,7 @@ struct group {
     uint64_t max_cap;
     uint64_t min_cap;
     uint64_t group_cap;            /* usually = min_cap if group_cap_update=true */
+    uint64_t version;              /* `network_version` of the last change of group_cap */
 
     uint64_t is_closed; /* GROUP_NOT_CLOSED if open; otherwise closed time (can be 0) */
     uint64_t constructed_time;
@@ -141,18 +175,47 @@ struct network {
   struct array* nodes;
   struct array* channels;
   struct array* edges;
+  struct edge_store* edge_store;
   struct array* groups;
   gsl_ran_discrete_t* faulty_node_prob; //the probability that a nodes in the network has a fault and goes offline
 };
 
+/* incremented at every change of the state read by the path finding (balances, groups, channel updates, node pair results),
+   so that a path found earlier can be known to be still the one that would be found now (see `speculation.c`) */
+extern uint64_t network_version;
+
+extern long channel_update_history_size;
+
 /* constructors */
 struct node* new_node(long id);
 struct channel* new_channel(long id, long direction1, long direction2, long node1, long node2, uint64_t capacity);
-struct edge* new_edge(long id, long channel_id, long counter_edge_id, long from_node_id, long to_node_id, uint64_t balance, struct policy policy, uint64_t channel_capacity);
+struct edge* new_edge(struct edge_store* store, long id, long channel_id, long counter_edge_id, long from_node_id, long to_node_id, uint64_t balance, struct policy policy, uint64_t channel_capacity);
+struct edge_store* new_edge_store(long size);
+void free_edge_store(struct edge_store* store);
+
+/* edge accessors */
+static inline uint64_t edge_get_balance(struct edge* e) { return e->store->balance[e->id]; }
+static inline void edge_set_balance(struct edge* e, uint64_t balance) { e->store->balance[e->id] = balance; network_version++; }
+static inline struct group* edge_get_group(struct edge* e) { return e->store->group[e->id]; }
+static inline void edge_set_group(struct edge* e, struct group* group) { e->store->group[e->id] = group; e->store->cold[e->id].version = ++network_version; }
+static inline uint64_t edge_get_tot_flows(struct edge* e) { return e->store->tot_flows[e->id]; }
+static inline void edge_set_tot_flows(struct edge* e, uint64_t tot_flows) { e->store->tot_flows[e->id] = tot_flows; }
+static inline struct edge_cold* edge_cold(struct edge* e) { return &(e->store->cold[e->id]); }
+
+/* channel updates */
+void add_channel_update(struct edge* edge, uint64_t htlc_maximum_msat, uint64_t time);
+long channel_updates_len(struct edge* edge);
+struct channel_update* get_channel_update(struct edge* edge, long i);
+
+/* locked balance statistics */
+void locked_balance_trace_open(const char* dirpath);
+void locked_balance_trace_close(void);
+void record_locked_balance(struct edge* edge, uint64_t locked_balance, uint64_t locked_start_time, uint64_t locked_end_time);
 
 /* network lifecycle */
 void open_channel(struct network* network, gsl_rng* random_generator);
 struct network* initialize_network(struct network_params net_params, gsl_rng* random_generator);
+void set_network_params(struct network* network, struct network_params net_params);
 void free_network(struct network* network);
 
 /* group maintenance */
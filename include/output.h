@@ -0,0 +1,62 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+
+#define OUTPUT_BUFFER_SIZE (1 << 20) // size of the user-space buffer of an output file
+#define OUTPUT_MAX_PENDING_CHUNKS 64 // full buffers waiting for the writer thread, the producers wait beyond
+
+struct output_file;
+
+/* text formatted in the buffer of an output file, handed to the writer thread */
+struct output_chunk {
+  struct output_file* file; // NULL for the chunk which stops the writer
+  char* data;
+  size_t len;
+  int close; // last chunk of the file: the file is closed after writing it
+  _Atomic(struct output_chunk*) next;
+};
+
+/* background thread writing the output files.
+   The chunks of all the files are pushed to a lock-free multi-producer single-consumer queue (a linked list whose tail is
+   swapped atomically) and they are written in order of push, so the chunks of a file formatted by a single thread are written in order.
+   The writer sleeps on `available` when the queue is empty; `free_slots` bounds the memory of the pending chunks */
+struct output_writer {
+  pthread_t tid;
+  struct output_chunk* head; // last chunk consumed (or the initial stub), owned by the writer thread
+  _Atomic(struct output_chunk*) tail;
+  sem_t available;
+  sem_t free_slots;
+};
+
+/* output file whose text is formatted in a large user-space buffer: when the buffer is full it is handed to the writer thread,
+   or written directly if there is no writer. An output file must be written by one thread at a time.
+   The files not closed yet are kept in a list: if the program exits before closing them (e.g. after an error), the pending
+   chunks and the buffers are written at exit, so that the partial output is kept */
+struct output_file {
+  FILE* file;
+  struct output_writer* writer;
+  char* buffer;
+  size_t len;
+  size_t size;
+  struct output_file* prev_open;
+  struct output_file* next_open;
+};
+
+extern struct output_writer* output_writer;
+
+struct output_writer* output_writer_initialize(void);
+
+void output_writer_free(struct output_writer* writer);
+
+struct output_file* output_open(const char* filename, struct output_writer* writer);
+
+int output_printf(struct output_file* out, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+void output_close(struct output_file* out);
+
+#endif
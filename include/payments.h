@@ -1,6 +1,7 @@
 #ifndef PAYMENTS_H
 #define PAYMENTS_H
 
+#include <stdio.h>
 #include <stdint.h>
 #include <gsl/gsl_rng.h>
 #include "array.h"
@@ -42,6 +43,7 @@ struct payment {
   unsigned int is_timeout;
   struct element* history; // list of `struct attempt`
   struct array* min_cap_used_edges;
+  struct speculated_path* speculated_path; // path of the next attempt found in advance (see `speculation.c`), NULL if none
 };
 
 struct attempt {
@@ -53,8 +55,26 @@ struct attempt {
   short is_succeeded;
 };
 
+/* generator of random payments: payments are drawn one at a time, so that they can be produced either all before the simulation
+   or lazily while the simulation advances (see `stream_payments` in cloth_input.txt) */
+struct payment_generator {
+  struct payments_params pay_params;
+  long n_nodes;
+  gsl_rng* random_generator;
+  long n_generated;
+  uint64_t payment_time;
+  struct payment* last_payment; // the most recently generated payment
+  FILE* payments_file; // "payments.csv" export, NULL if disabled
+};
+
 struct payment* new_payment(long id, long sender, long receiver, uint64_t amount, uint64_t start_time, uint64_t max_fee_limit);
-struct array* initialize_payments(struct payments_params pay_params, long n_nodes, gsl_rng* random_generator);
+
+struct payment_generator* new_payment_generator(struct payments_params pay_params, long n_nodes, gsl_rng* random_generator);
+
+struct payment* generate_next_payment(struct payment_generator* generator, long id);
+
+void free_payment_generator(struct payment_generator* generator);
+struct array* initialize_payments(struct payments_params pay_params, long n_nodes, gsl_rng* random_generator, long n_threads);
 void add_attempt_history(struct payment* pmt, struct network* network, uint64_t time, short is_succeeded);
 
 #endif
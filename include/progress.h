@@ -0,0 +1,31 @@
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#include <stdint.h>
+#include <time.h>
+
+#define PROGRESS_CLOCK_CHECK_EVENTS 1024 // the wall clock is read once every this number of events
+
+/* reporter of the fraction of completed payments to "progress.tmp" in the output directory (polled by the run_all_simulations scripts).
+   The file is rewritten every `every_events` events or every `every_seconds` seconds of wall-clock time (0 disables a condition);
+   with `use_mmap` the file is mapped in memory once and the value is overwritten in place without system calls */
+struct progress_reporter {
+  char filename[512];
+  long every_events;
+  double every_seconds;
+  long n_events;
+  long n_events_since_report;
+  struct timespec last_report;
+  int use_mmap;
+  char* mapped;
+};
+
+struct progress_reporter* progress_initialize(const char* output_dir_name, long every_events, double every_seconds, int use_mmap);
+
+void progress_event(struct progress_reporter* progress, long completed_payments, long n_payments);
+
+void progress_write(struct progress_reporter* progress, long completed_payments, long n_payments);
+
+void progress_free(struct progress_reporter* progress);
+
+#endif
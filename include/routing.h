@@ -8,20 +8,21 @@
 #include "array.h"
 #include "list.h"
 #include "network.h"
+#include "thread_pool.h"
 
-#define N_THREADS 8
 #define FINALTIMELOCK 40
 
-extern pthread_mutex_t data_mutex;
-extern pthread_mutex_t jobs_mutex;
 extern struct array** paths;
-extern struct element* jobs;
+extern long n_paths;
+extern long n_dijkstra_slots;
+extern struct thread_pool* thread_pool;
+extern struct routing_graph* routing_graph;
+extern struct route_cache* route_cache;
 
-struct thread_args{
+struct initial_paths_args{
   struct network* network;
   struct array* payments;
   uint64_t current_time;
-  long data_index;
   enum routing_method routing_method;
 };
 
@@ -34,6 +35,48 @@ struct distance{
   uint32_t timelock;
   double weight;
   long next_edge;
+  long heap_index; // position in the distance heap (-1 if not in the heap)
+  uint64_t generation; // dijkstra execution in which this distance was last set (see `get_distance`)
+};
+
+/* read-only snapshot of the network topology used in the hot loop of dijkstra (compressed sparse row format):
+   the edges entering node `i` (the counter edges of its open edges, in the same order) are stored contiguously in positions [offsets[i], offsets[i+1]) */
+struct routing_graph {
+  long n_nodes;
+  long n_edges;
+  long* offsets;
+  long* edge_id;
+  long* from_node_id;
+  uint64_t* fee_base;
+  uint64_t* fee_proportional;
+  uint64_t* min_htlc;
+  uint32_t* timelock;
+  uint64_t* channel_capacity; // the mutable state of the edges (balance, group) is read from `network->edge_store` by edge id
+};
+
+/* path cached for the first attempts of the payments between two nodes with amounts in the same bucket (see `route_cache` in cloth_input.txt).
+   It records the versions of the edges and of the groups of its hops: it is used only if none of them changed since
+   (no channel update landed, no group_cap changed) and if it satisfies the constraints of dijkstra for the amount */
+struct route_cache_entry {
+  long sender; // -1 if the entry is empty
+  long receiver;
+  long bucket;
+  struct array* path;
+  uint64_t* edge_versions;
+  struct group** groups;
+  uint64_t* group_versions;
+};
+
+/* open-addressing hash table of the cached paths, keyed by (sender, receiver, amount bucket) */
+struct route_cache {
+  struct route_cache_entry* entries;
+  long size;
+  long n_entries;
+  /* stats */
+  long n_hits;
+  long n_misses;
+  long n_invalidations;
+  long n_rejections;
 };
 
 struct dijkstra_hop {
@@ -71,16 +114,32 @@ enum pathfind_error{
   NOPATH
 };
 
-void initialize_dijkstra(long n_nodes, long n_edges, struct array* payments);
+void initialize_dijkstra(struct network* network, struct array* payments, long n_threads);
+
+struct routing_graph* build_routing_graph(struct network* network);
+
+void free_routing_graph(struct routing_graph* graph);
 
 uint64_t estimate_capacity(struct edge* edge, struct network* network, enum routing_method routing_method);
 
+uint64_t estimate_edge_capacity(struct edge_store* store, long edge_id, uint64_t channel_capacity, enum routing_method routing_method);
+
 void run_dijkstra_threads(struct network* network, struct array* payments, uint64_t current_time, enum routing_method routing_method);
 
 struct array* dijkstra(long source, long destination, uint64_t amount, struct network* network, uint64_t current_time, long p, enum pathfind_error *error, enum routing_method routing_method, struct element* exclude_edges, uint64_t max_fee_limit);
 
 struct route* transform_path_into_route(struct array* path_hops, uint64_t amount_to_send, struct network* network, uint64_t time);
 
+struct route_cache* route_cache_initialize(long size);
+
+struct array* route_cache_get(struct route_cache* cache, long sender, long receiver, uint64_t amount, uint64_t max_fee_limit, struct network* network, enum routing_method routing_method);
+
+void route_cache_put(struct route_cache* cache, long sender, long receiver, uint64_t amount, struct array* path, struct network* network);
+
+void print_route_cache_stats(struct route_cache* cache);
+
+void route_cache_free(struct route_cache* cache);
+
 void print_hop(struct route_hop* hop);
 
 int compare_distance(struct distance* a, struct distance* b);
@@ -0,0 +1,45 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include "heap.h"
+
+struct event;
+
+/* the data structure holding the future events of the simulation, selected by `event_scheduler` in cloth_input.txt */
+enum scheduler_type {
+  BINARY_HEAP_SCHEDULER,   // reference implementation
+  CALENDAR_QUEUE_SCHEDULER
+};
+
+/* calendar queue (R. Brown, 1988): events are hashed by time in `n_buckets` buckets of `width` milliseconds,
+   each bucket is a list sorted by time (events with the same time are kept in insertion order) linked through `event->next`.
+   The number of buckets follows the number of events and the width is resampled from the earliest events at every resize,
+   so that insert and pop are O(1) amortized */
+struct calendar_queue {
+  struct event** buckets;
+  long n_buckets;
+  uint64_t width;
+  long size;
+  long last_bucket;     // bucket of the last popped event
+  uint64_t bucket_top;  // upper time bound of `last_bucket` in the current year
+  uint64_t last_time;   // time of the last popped event
+};
+
+struct scheduler {
+  enum scheduler_type type;
+  struct heap* heap;
+  struct calendar_queue* calendar_queue;
+};
+
+struct scheduler* scheduler_initialize(enum scheduler_type type, long size);
+
+void scheduler_insert(struct scheduler* scheduler, struct event* event);
+
+struct event* scheduler_pop(struct scheduler* scheduler);
+
+long scheduler_len(struct scheduler* scheduler);
+
+void scheduler_free(struct scheduler* scheduler);
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+#include "network.h"
+
+/* Binary snapshot of a network read from csv files (see `network_snapshot_filename` in cloth_input.txt and
+   scripts/convert_network_snapshot.py, which converts the nodes, channels and edges csv files into a snapshot).
+
+   All the integers are little-endian. The file starts with a header:
+     magic "CLOTHNET" (8 bytes), format version (uint32), number of sections (uint32),
+     checksum (uint32, CRC-32 of the whole file with this field set to 0), reserved (uint32),
+   followed by the directory of the sections; for each section:
+     name (8 bytes, zero padded), offset of its records from the beginning of the file (uint64), number of records (uint64),
+     size of a record (uint64).
+   The records of a section are contiguous and start at an offset multiple of 8; the records of the nodes, channels and edges
+   are in id order (the record i has id i).
+
+   Sections (in this order) and their fixed-width records:
+     nodes:     id (int64)
+     channels:  id, edge1, edge2, node1, node2 (int64), capacity (uint64)
+     edges:     id, channel_id, counter_edge_id, from_node_id, to_node_id (int64), balance, fee_base, fee_proportional,
+                min_htlc (uint64), timelock (uint32), reserved (uint32) */
+
+#define SNAPSHOT_MAGIC "CLOTHNET"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_HEADER_SIZE 24
+#define SNAPSHOT_SECTION_NAME_SIZE 8
+#define SNAPSHOT_SECTION_SIZE 32
+#define SNAPSHOT_CHECKSUM_OFFSET 16
+
+#define SNAPSHOT_NODE_RECORD_SIZE 8
+#define SNAPSHOT_CHANNEL_RECORD_SIZE 48
+#define SNAPSHOT_EDGE_RECORD_SIZE 80
+
+enum snapshot_section {SNAPSHOT_NODES, SNAPSHOT_CHANNELS, SNAPSHOT_EDGES, N_SNAPSHOT_SECTIONS};
+
+struct network* load_network_snapshot(char filename[]);
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef SPECULATION_H
+#define SPECULATION_H
+
+#include <stdint.h>
+#include "array.h"
+#include "network.h"
+#include "payments.h"
+
+/* path of the next attempt of a payment found in advance, with the state of the network it was found in */
+struct speculated_path {
+  struct array* path; // NULL if no path was found
+  int attempt;
+  uint64_t network_version;
+  uint64_t time;
+};
+
+struct speculation_job {
+  struct payment* payment;
+  int attempt;
+};
+
+/* speculative path finding (see `speculative_pathfinding` in cloth_input.txt).
+   When a FINDPATH event needs a path which was not found in advance, the paths of the upcoming FINDPATH events
+   (the scheduled retries and the first attempts of the next `window` payments) are found together by the thread pool.
+   The simulation waits for them, so they are all found against the same state of the network.
+   When the event of a payment is executed, its speculated path is used as is if the network did not change since (`network_version`),
+   it is validated against the current balances and group caps if it changed, and it is found again only if it is stale */
+struct speculation {
+  long window;
+  long next_payment; // position in the payments of the next payment whose first attempt can be speculated
+  struct array* pending_retries; // payments with a retry scheduled since the last round
+  struct speculation_job* jobs;
+  long jobs_size;
+  /* stats */
+  long n_rounds;
+  long n_speculated;
+  long n_exact;
+  long n_validated;
+  long n_stale;
+};
+
+extern struct speculation* speculation;
+
+struct speculation* speculation_initialize(long window);
+
+void add_pending_retry(struct payment* payment);
+
+struct array* get_speculated_path(struct payment* payment, struct array* payments, struct network* network, uint64_t current_time, enum routing_method routing_method);
+
+void discard_speculated_path(struct payment* payment);
+
+void print_speculation_stats(struct speculation* speculation);
+
+void speculation_free(struct speculation* speculation);
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "array.h"
+
+/* Parameter sweep (see `sweep_filename` in cloth_input.txt): the network and the payments are loaded once, then each point
+   of the sweep is simulated in a child process created with fork(), which shares the loaded data copy-on-write and applies
+   the overrides of the point to the parameters of cloth_input.txt.
+
+   Each line of the sweep file which is not empty and does not start with '#' is a point:
+     <name> <parameter>=<value> <parameter>=<value> ...
+   The output of a point is written in the subdirectory <name> of the output directory, together with its cloth_input.txt
+   (with the overrides applied) and the standard output and error of its simulation (cloth.log) */
+
+#define SWEEP_MAX_OVERRIDES 64
+
+struct sweep_point {
+  char name[256];
+  long n_overrides;
+  char parameters[SWEEP_MAX_OVERRIDES][64];
+  char values[SWEEP_MAX_OVERRIDES][256];
+};
+
+/* simulation of a point, executed in its child process with the output directory of the point; it returns the exit status */
+typedef int (*sweep_job)(struct sweep_point* point, char output_dir_name[], void* arg);
+
+struct array* read_sweep_points(char filename[]);
+
+long run_sweep(struct array* points, char output_dir_name[], long max_processes, sweep_job job, void* arg);
+
+void free_sweep_points(struct array* points);
+
+#endif
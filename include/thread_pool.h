@@ -0,0 +1,37 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+/* a job is called with the index of the job and the index of the worker thread which executes it (in [0, n_threads)) */
+typedef void (*thread_pool_job)(long job_index, long thread_index, void* arg);
+
+/* persistent pool of worker threads: the threads are created once and wait for work between the runs.
+   The jobs of a run are the indexes [0, n_jobs); the workers grab them `batch_size` at a time by atomically incrementing `next_job` */
+struct thread_pool {
+  long n_threads;
+  pthread_t* tid;
+  pthread_mutex_t mutex;
+  pthread_cond_t work_available;
+  pthread_cond_t work_done;
+  unsigned long run_id; // incremented at each run, workers wait for a new value
+  long n_active; // workers still executing the current run
+  int shutdown;
+  /* current run */
+  thread_pool_job job;
+  void* arg;
+  long n_jobs;
+  long batch_size;
+  atomic_long next_job;
+};
+
+long get_n_threads(long configured_threads);
+
+struct thread_pool* thread_pool_initialize(long n_threads);
+
+void thread_pool_run(struct thread_pool* pool, long n_jobs, long batch_size, thread_pool_job job, void* arg);
+
+void thread_pool_free(struct thread_pool* pool);
+
+#endif
@@ -5,10 +5,6 @@
 #include "routing.h"
 #include "htlc.h"
 
-int is_equal_result(struct node_pair_result *a, struct node_pair_result *b);
-
-int is_equal_key_result(long key, struct node_pair_result *a);
-
 int is_equal_edge(struct edge* edge1, struct edge* edge2);
 
 int is_equal_long(long* a, long* b);
@@ -6,6 +6,8 @@ from concurrent.futures import ProcessPoolExecutor
 import numpy as np
 from matplotlib import pyplot as plt
 
+from read_columnar import payments_as_csv_rows, read_columnar
+
 csv.field_size_limit(200_000_000)
 
 BASE_HEADER = ["simulation_id"]
@@ -159,8 +161,13 @@ def save_scatter(data_x: list, data_y: list, x_label: str, y_label: str, filepat
 def analyze_output(output_dir_name):
     simulation_time = 0
     result = {}
-    with open(output_dir_name + 'payments_output.csv', 'r') as csv_pay:
-        payments = list(csv.DictReader(csv_pay))
+    # payments_output.bin (binary_output=true) is read instead of the csv if present
+    binary = os.path.exists(output_dir_name + 'payments_output.bin')
+    with open(output_dir_name + ('payments_output.bin' if binary else 'payments_output.csv'), 'rb' if binary else 'r') as payments_file:
+        if binary:
+            payments = payments_as_csv_rows(read_columnar(payments_file))
+        else:
+            payments = list(csv.DictReader(payments_file))
 
         total_payment_num = len(payments)
         total_attempts_num = 0
@@ -202,7 +209,7 @@ def analyze_output(output_dir_name):
                 time_fail_distribution.append(time)
                 if (pay["route"] == "") and (attempts == 1):
                     total_fail_no_path_num += 1
-                elif pay["timeout_exp"] == 1:
+                elif pay["timeout_exp"] == "1":
                     total_timeout_num += 1
                 else:
                     total_fail_no_alternative_path_num += 1
@@ -317,12 +324,8 @@ def analyze_output(output_dir_name):
             edge_fee[edge["id"]] = {"fee_base": edge["fee_base"], "fee_proportional": edge["fee_proportional"]}
             if edge["group"] != "NULL":
                 edge_in_group_num += 1
-            if edge["locked_balance_and_duration"] != "":
-                locked_balance_and_duration = [tuple(map(int, pair.split('x'))) for pair in edge["locked_balance_and_duration"].split("-")]
-                total_locked_balance_and_duration = 0
-                for (locked_balance, locked_duration) in locked_balance_and_duration:
-                    total_locked_balance_and_duration += locked_balance * locked_duration  # [millisatoshi*ms]
-                locked_balance_and_duration_distribution.append(total_locked_balance_and_duration)
+            if int(edge["locked_count"]) > 0:
+                locked_balance_and_duration_distribution.append(int(edge["locked_balance_duration_sum"]))  # [millisatoshi*ms]
 
         result = result | {
             "group_cover_rate": edge_in_group_num / len(edges),  # 全エッジに対するグループに属するエッジが占める割合
@@ -349,7 +352,7 @@ def analyze_output(output_dir_name):
         for group in groups:
             try:
                 group_capacity_distribution.append(int(group["group_capacity"]))
-                if group["is_closed(closed_time)"] != "0":
+                if group["is_closed(closed_time)"] != "-1":
                     closed_time = int(group["is_closed(closed_time)"])
                     constructed_time = int(group["constructed_time"])
                     group_survival_time_distribution.append(closed_time - constructed_time)
@@ -430,7 +433,12 @@ def process_output_dir(output_dir):
     row_data = {"simulation_id": relative_path}
     row_data.update(load_cloth_input(output_dir))
     try:
-        row_data.update(analyze_output(output_dir))
+        # metrics accumulated by the simulator (metrics_summary=true), the output tables are analyzed otherwise
+        if os.path.exists(output_dir + "metrics_summary.csv"):
+            with open(output_dir + "metrics_summary.csv", "r") as metrics_summary:
+                row_data.update(next(csv.DictReader(metrics_summary)))
+        else:
+            row_data.update(analyze_output(output_dir))
     except Exception as e:
         print("FAILED SIMULATION : " + output_dir, file=sys.stderr)
     print(output_dir)
@@ -0,0 +1,65 @@
+"""Converter of the csv files of a network (nodes, channels, edges) into a binary network snapshot (see include/snapshot.h).
+
+    python3 scripts/convert_network_snapshot.py nodes_ln.csv channels_ln.csv edges_ln.csv network_ln.bin
+
+The snapshot is used by the simulator instead of the csv files when `network_snapshot_filename` is set in cloth_input.txt.
+"""
+import csv
+import struct
+import sys
+import zlib
+
+MAGIC = b"CLOTHNET"
+VERSION = 1
+HEADER = struct.Struct("<8sIIII")
+SECTION = struct.Struct("<8sQQQ")
+CHECKSUM_OFFSET = 16
+
+NODE = struct.Struct("<q")
+CHANNEL = struct.Struct("<qqqqqQ")
+EDGE = struct.Struct("<qqqqqQQQQII")
+
+
+def read_rows(filename, columns):
+    """the rows of a csv file as tuples of integers of the given columns, in id order"""
+    with open(filename, newline="") as f:
+        reader = csv.DictReader(f)
+        rows = [tuple(int(row[column]) for column in columns) for row in reader]
+    rows.sort(key=lambda row: row[0])
+    for i, row in enumerate(rows):
+        if row[0] != i:
+            raise ValueError(f"{filename}: the ids are not 0..{len(rows) - 1} (missing or repeated id {i})")
+    return rows
+
+
+def convert(nodes_filename, channels_filename, edges_filename, snapshot_filename):
+    nodes = read_rows(nodes_filename, ["id"])
+    channels = read_rows(channels_filename, ["id", "edge1_id", "edge2_id", "node1_id", "node2_id", "capacity"])
+    edges = read_rows(edges_filename, ["id", "channel_id", "counter_edge_id", "from_node_id", "to_node_id", "balance",
+                                       "fee_base", "fee_proportional", "min_htlc", "timelock"])
+
+    sections = [(b"nodes", NODE, nodes), (b"channels", CHANNEL, channels), (b"edges", EDGE, edges)]
+    offset = HEADER.size + len(sections) * SECTION.size
+    directory = b""
+    data = b""
+    for name, record, rows in sections:
+        padding = -offset % 8
+        data += b"\0" * padding
+        offset += padding
+        directory += SECTION.pack(name, offset, len(rows), record.size)
+        reserved = (0,) if record is EDGE else ()
+        data += b"".join(record.pack(*row, *reserved) for row in rows)
+        offset += len(rows) * record.size
+
+    snapshot = bytearray(HEADER.pack(MAGIC, VERSION, len(sections), 0, 0) + directory + data)
+    struct.pack_into("<I", snapshot, CHECKSUM_OFFSET, zlib.crc32(snapshot))
+    with open(snapshot_filename, "wb") as f:
+        f.write(snapshot)
+    print(f"{snapshot_filename}: {len(nodes)} nodes, {len(channels)} channels, {len(edges)} edges")
+
+
+if __name__ == "__main__":
+    if len(sys.argv) != 5:
+        print(f"usage: {sys.argv[0]} nodes.csv channels.csv edges.csv snapshot.bin")
+        sys.exit(1)
+    convert(*sys.argv[1:])
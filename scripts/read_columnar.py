@@ -0,0 +1,79 @@
+"""Reader of payments_output.bin, the binary columnar output of the payments (see include/columnar.h).
+
+    tables = read_columnar("result/payments_output.bin")
+    tables["payments"]["amount"][i]  # columns are array('q') of int64, missing values are -1
+
+The rows of the payment i in a child table are [offset, offset + len), e.g. its attempts are
+rows(tables["payments"], i, "attempts") of tables["attempts"].
+"""
+import struct
+import sys
+from array import array
+
+MAGIC = b"CLOTHCOL"
+VERSION = 1
+TABLE_NAME_SIZE = 16
+COLUMN_NAME_SIZE = 32
+
+
+def read_columnar(file):
+    """the tables of a columnar output file (a path or a file opened in binary mode)"""
+    if hasattr(file, "read"):
+        data = file.read()
+    else:
+        with open(file, "rb") as f:
+            data = f.read()
+
+    if data[:8] != MAGIC:
+        raise ValueError("not a columnar output file")
+    version, n_tables = struct.unpack_from("<II", data, 8)
+    if version != VERSION:
+        raise ValueError(f"unsupported version {version} of the columnar output file")
+
+    tables = {}
+    pos = 16
+    for _ in range(n_tables):
+        name = data[pos:pos + TABLE_NAME_SIZE].rstrip(b"\0").decode()
+        n_rows, n_columns, _ = struct.unpack_from("<QII", data, pos + TABLE_NAME_SIZE)
+        pos += TABLE_NAME_SIZE + 16
+        columns = {}
+        for _ in range(n_columns):
+            column_name = data[pos:pos + COLUMN_NAME_SIZE].rstrip(b"\0").decode()
+            (offset,) = struct.unpack_from("<Q", data, pos + COLUMN_NAME_SIZE)
+            pos += COLUMN_NAME_SIZE + 8
+            column = array("q")
+            column.frombytes(data[offset:offset + 8 * n_rows])
+            if sys.byteorder != "little":
+                column.byteswap()
+            columns[column_name] = column
+        tables[name] = columns
+    return tables
+
+
+def rows(table, i, child):
+    """range of the rows of the child table `child` (route, attempts or hops) of the row i of `table`"""
+    offset = table[child + "_offset"][i]
+    return range(offset, offset + table[child + "_len"][i])
+
+
+def payments_as_csv_rows(tables):
+    """the payments with the columns of payments_output.csv used by analyze_output.py (as strings, as csv.DictReader returns them)"""
+    payments = tables["payments"]
+    route_hops = tables["route_hops"]["edge_id"]
+    result = []
+    for i in range(len(payments["id"])):
+        row = {name: str(column[i]) for name, column in payments.items()}
+        route = rows(payments, i, "route")
+        row["route"] = "-".join(str(route_hops[j]) for j in route)
+        row["total_fee"] = "" if payments["total_fee"][i] == -1 else row["total_fee"]
+        result.append(row)
+    return result
+
+
+if __name__ == "__main__":
+    if len(sys.argv) != 2:
+        print(f"usage: {sys.argv[0]} payments_output.bin")
+        sys.exit(1)
+    for table_name, table in read_columnar(sys.argv[1]).items():
+        n_rows = len(next(iter(table.values()))) if table else 0
+        print(f"{table_name}: {n_rows} rows, columns {', '.join(table.keys())}")
@@ -0,0 +1,798 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <gsl/gsl_rng.h>
+#include "../include/checkpoint.h"
+#include "../include/payments.h"
+#include "../include/routing.h"
+#include "../include/htlc.h"
+#include "../include/scheduler.h"
+
+/* Functions in this file write the state of the simulation in a checkpoint file and restore it (see checkpoint.h) */
+
+static void write_bytes(FILE* file, const void* data, size_t size) {
+  if(size > 0 && fwrite(data, 1, size, file) != size) {
+    fprintf(stderr, "ERROR: cannot write the checkpoint\n");
+    exit(-1);
+  }
+}
+
+static void read_bytes(FILE* file, void* data, size_t size) {
+  if(size > 0 && fread(data, 1, size, file) != size) {
+    fprintf(stderr, "ERROR: the checkpoint is truncated\n");
+    exit(-1);
+  }
+}
+
+#define WRITE_VALUE(file, value) write_bytes(file, &(value), sizeof(value))
+#define READ_VALUE(file, value) read_bytes(file, &(value), sizeof(value))
+
+static void write_long(FILE* file, long value) {
+  WRITE_VALUE(file, value);
+}
+
+static long read_long(FILE* file) {
+  long value;
+  READ_VALUE(file, value);
+  return value;
+}
+
+static void write_tag(FILE* file, const char* tag) {
+  char buffer[CHECKPOINT_TAG_SIZE];
+  memset(buffer, 0, CHECKPOINT_TAG_SIZE);
+  memcpy(buffer, tag, strnlen(tag, CHECKPOINT_TAG_SIZE));
+  write_bytes(file, buffer, CHECKPOINT_TAG_SIZE);
+}
+
+static void read_tag(FILE* file, const char* tag) {
+  char buffer[CHECKPOINT_TAG_SIZE], expected[CHECKPOINT_TAG_SIZE];
+  memset(expected, 0, CHECKPOINT_TAG_SIZE);
+  memcpy(expected, tag, strnlen(tag, CHECKPOINT_TAG_SIZE));
+  read_bytes(file, buffer, CHECKPOINT_TAG_SIZE);
+  if(memcmp(buffer, expected, CHECKPOINT_TAG_SIZE) != 0) {
+    fprintf(stderr, "ERROR: corrupted checkpoint, section <%s> not found\n", tag);
+    exit(-1);
+  }
+}
+
+static void* checkpoint_malloc(size_t size) {
+  void* data = malloc(size > 0 ? size : 1);
+  if(data == NULL) {
+    fprintf(stderr, "ERROR: malloc failed while reading the checkpoint\n");
+    exit(-1);
+  }
+  return data;
+}
+
+static struct array* array_of_size(long len) {
+  return array_initialize(len > 0 ? len : 1);
+}
+
+/* the data of a list from its tail to its head: pushing them in this order rebuilds the list */
+static void** list_reversed(struct element* head, long* len) {
+  struct element* iterator;
+  void** data;
+  long i;
+  *len = list_len(head);
+  data = checkpoint_malloc(sizeof(void*)*(*len));
+  i = *len;
+  for(iterator = head; iterator != NULL; iterator = iterator->next)
+    data[--i] = iterator->data;
+  return data;
+}
+
+static struct edge* get_edge_by_id(struct network* network, long id) {
+  if(id < 0 || id >= array_len(network->edges)) {
+    fprintf(stderr, "ERROR: corrupted checkpoint, edge <%ld> does not exist\n", id);
+    exit(-1);
+  }
+  return array_get(network->edges, id);
+}
+
+static struct payment* get_payment_by_index(struct array* payments, long index) {
+  if(index < 0 || index >= array_len(payments)) {
+    fprintf(stderr, "ERROR: corrupted checkpoint, payment <%ld> does not exist\n", index);
+    exit(-1);
+  }
+  return array_get(payments, index);
+}
+
+/* index of a payment in the payments array, which is its id until the shards of the multi-path payments are merged */
+static long payment_index(struct array* payments, struct payment* payment) {
+  if(payment == NULL)
+    return -1;
+  if(payment->id < 0 || payment->id >= array_len(payments) || array_get(payments, payment->id) != payment) {
+    fprintf(stderr, "ERROR: cannot write the checkpoint, payment <%ld> is not at its index in the payments\n", payment->id);
+    exit(-1);
+  }
+  return payment->id;
+}
+
+
+/* NETWORK */
+
+static void write_mission_control(FILE* file, struct mission_control* mc) {
+  write_long(file, mc != NULL);
+  if(mc == NULL)
+    return;
+  WRITE_VALUE(file, *mc);
+  write_bytes(file, mc->results, sizeof(struct node_pair_result)*mc->n_results);
+  write_bytes(file, mc->next_result, sizeof(long)*mc->n_results);
+  write_bytes(file, mc->pairs, sizeof(long)*mc->pairs_size);
+  write_bytes(file, mc->from_nodes, sizeof(long)*mc->from_nodes_size);
+  write_bytes(file, mc->from_heads, sizeof(long)*mc->from_nodes_size);
+}
+
+static struct mission_control* read_mission_control(FILE* file) {
+  struct mission_control* mc;
+  if(!read_long(file))
+    return NULL;
+  mc = checkpoint_malloc(sizeof(struct mission_control));
+  READ_VALUE(file, *mc);
+  mc->results = checkpoint_malloc(sizeof(struct node_pair_result)*mc->results_size);
+  mc->next_result = checkpoint_malloc(sizeof(long)*mc->results_size);
+  mc->pairs = checkpoint_malloc(sizeof(long)*mc->pairs_size);
+  mc->from_nodes = checkpoint_malloc(sizeof(long)*mc->from_nodes_size);
+  mc->from_heads = checkpoint_malloc(sizeof(long)*mc->from_nodes_size);
+  read_bytes(file, mc->results, sizeof(struct node_pair_result)*mc->n_results);
+  read_bytes(file, mc->next_result, sizeof(long)*mc->n_results);
+  read_bytes(file, mc->pairs, sizeof(long)*mc->pairs_size);
+  read_bytes(file, mc->from_nodes, sizeof(long)*mc->from_nodes_size);
+  read_bytes(file, mc->from_heads, sizeof(long)*mc->from_nodes_size);
+  return mc;
+}
+
+static void write_nodes(FILE* file, struct network* network) {
+  struct node* node;
+  long i, j;
+  write_tag(file, "NODES");
+  write_long(file, array_len(network->nodes));
+  for(i = 0; i < array_len(network->nodes); i++) {
+    node = array_get(network->nodes, i);
+    write_long(file, node->id);
+    WRITE_VALUE(file, node->explored);
+    write_long(file, array_len(node->open_edges));
+    for(j = 0; j < array_len(node->open_edges); j++)
+      write_long(file, *((long*)array_get(node->open_edges, j)));
+    write_mission_control(file, node->mission_control);
+  }
+}
+
+/* the open edges of the nodes point to the ids of the edges, so they are resolved once the edges are read */
+static long** read_nodes(FILE* file, struct network* network, long** n_open_edges) {
+  struct node* node;
+  long i, j, n_nodes, **open_edge_ids;
+  read_tag(file, "NODES");
+  n_nodes = read_long(file);
+  open_edge_ids = checkpoint_malloc(sizeof(long*)*n_nodes);
+  *n_open_edges = checkpoint_malloc(sizeof(long)*n_nodes);
+  network->nodes = array_of_size(n_nodes);
+  for(i = 0; i < n_nodes; i++) {
+    node = new_node(read_long(file));
+    READ_VALUE(file, node->explored);
+    (*n_open_edges)[i] = read_long(file);
+    open_edge_ids[i] = checkpoint_malloc(sizeof(long)*(*n_open_edges)[i]);
+    for(j = 0; j < (*n_open_edges)[i]; j++)
+      open_edge_ids[i][j] = read_long(file);
+    node->mission_control = read_mission_control(file);
+    network->nodes = array_insert(network->nodes, node);
+  }
+  return open_edge_ids;
+}
+
+static void write_channels(FILE* file, struct network* network) {
+  struct channel* channel;
+  long i;
+  write_tag(file, "CHANNELS");
+  write_long(file, array_len(network->channels));
+  for(i = 0; i < array_len(network->channels); i++) {
+    channel = array_get(network->channels, i);
+    WRITE_VALUE(file, *channel);
+  }
+}
+
+static void read_channels(FILE* file, struct network* network) {
+  struct channel* channel;
+  long i, n_channels;
+  read_tag(file, "CHANNELS");
+  n_channels = read_long(file);
+  network->channels = array_of_size(n_channels);
+  for(i = 0; i < n_channels; i++) {
+    channel = checkpoint_malloc(sizeof(struct channel));
+    READ_VALUE(file, *channel);
+    network->channels = array_insert(network->channels, channel);
+  }
+}
+
+/* the groups of the edges are written as their ids (their index in `network->groups`) */
+static long group_index(struct network* network, struct group* group) {
+  if(group == NULL)
+    return -1;
+  if(group->id < 0 || group->id >= array_len(network->groups) || array_get(network->groups, group->id) != group) {
+    fprintf(stderr, "ERROR: cannot write the checkpoint, group <%ld> is not in the groups of the network\n", group->id);
+    exit(-1);
+  }
+  return group->id;
+}
+
+static void write_edges(FILE* file, struct network* network) {
+  struct edge* edge;
+  struct edge_store* store = network->edge_store;
+  struct edge_cold* cold;
+  long i;
+  write_tag(file, "EDGES");
+  write_long(file, channel_update_history_size);
+  write_long(file, array_len(network->edges));
+  for(i = 0; i < array_len(network->edges); i++) {
+    edge = array_get(network->edges, i);
+    if(edge == NULL || edge->id != i) {
+      fprintf(stderr, "ERROR: cannot write the checkpoint, edge <%ld> is not at its index in the edges\n", i);
+      exit(-1);
+    }
+    WRITE_VALUE(file, *edge);
+    WRITE_VALUE(file, store->balance[i]);
+    WRITE_VALUE(file, store->tot_flows[i]);
+    WRITE_VALUE(file, store->htlc_maximum_msat[i]);
+    write_long(file, group_index(network, store->group[i]));
+    cold = edge_cold(edge);
+    WRITE_VALUE(file, *cold);
+    if(cold->channel_updates.ring != NULL)
+      write_bytes(file, cold->channel_updates.ring, sizeof(struct channel_update)*channel_update_history_size);
+  }
+}
+
+static long* read_edges(FILE* file, struct network* network) {
+  struct edge e, *edge;
+  struct edge_store* store;
+  struct edge_cold* cold;
+  long i, n_edges, *group_ids;
+  read_tag(file, "EDGES");
+  channel_update_history_size = read_long(file);
+  n_edges = read_long(file);
+  network->edges = array_of_size(n_edges);
+  network->edge_store = store = new_edge_store(n_edges > 0 ? n_edges : 1);
+  group_ids = checkpoint_malloc(sizeof(long)*n_edges);
+  for(i = 0; i < n_edges; i++) {
+    READ_VALUE(file, e);
+    edge = new_edge(store, e.id, e.channel_id, e.counter_edge_id, e.from_node_id, e.to_node_id, 0, e.policy, 0);
+    edge->is_closed = e.is_closed;
+    READ_VALUE(file, store->balance[i]);
+    READ_VALUE(file, store->tot_flows[i]);
+    READ_VALUE(file, store->htlc_maximum_msat[i]);
+    group_ids[i] = read_long(file);
+    cold = edge_cold(edge);
+    READ_VALUE(file, *cold);
+    if(cold->channel_updates.ring != NULL) {
+      cold->channel_updates.ring = checkpoint_malloc(sizeof(struct channel_update)*channel_update_history_size);
+      read_bytes(file, cold->channel_updates.ring, sizeof(struct channel_update)*channel_update_history_size);
+    }
+    network->edges = array_insert(network->edges, edge);
+  }
+  return group_ids;
+}
+
+static void write_groups(FILE* file, struct network* network) {
+  struct group* group;
+  struct group_update* group_update;
+  struct edge* edge;
+  void** history;
+  long i, j, n_history;
+  write_tag(file, "GROUPS");
+  write_long(file, array_len(network->groups));
+  for(i = 0; i < array_len(network->groups); i++) {
+    group = array_get(network->groups, i);
+    group_index(network, group);
+    WRITE_VALUE(file, *group);
+    write_long(file, array_len(group->edges));
+    for(j = 0; j < array_len(group->edges); j++) {
+      edge = array_get(group->edges, j);
+      write_long(file, edge != NULL ? edge->id : -1);
+    }
+    history = list_reversed(group->history, &n_history);
+    write_long(file, n_history);
+    for(j = 0; j < n_history; j++) {
+      group_update = history[j];
+      WRITE_VALUE(file, group_update->time);
+      WRITE_VALUE(file, group_update->group_cap);
+      write_long(file, group_update->n_edges);
+      write_bytes(file, group_update->edge_balances, sizeof(uint64_t)*group_update->n_edges);
+    }
+    free(history);
+  }
+}
+
+static void read_groups(FILE* file, struct network* network) {
+  struct group* group;
+  struct group_update* group_update;
+  long i, j, n_groups, n_edges, edge_id, n_history;
+  read_tag(file, "GROUPS");
+  n_groups = read_long(file);
+  network->groups = array_initialize(n_groups > 1000 ? n_groups : 1000);
+  for(i = 0; i < n_groups; i++) {
+    group = checkpoint_malloc(sizeof(struct group));
+    READ_VALUE(file, *group);
+    n_edges = read_long(file);
+    group->edges = array_of_size(n_edges);
+    for(j = 0; j < n_edges; j++) {
+      edge_id = read_long(file);
+      group->edges = array_insert(group->edges, edge_id != -1 ? get_edge_by_id(network, edge_id) : NULL);
+    }
+    group->history = NULL;
+    n_history = read_long(file);
+    for(j = 0; j < n_history; j++) {
+      group_update = checkpoint_malloc(sizeof(struct group_update));
+      READ_VALUE(file, group_update->time);
+      READ_VALUE(file, group_update->group_cap);
+      group_update->n_edges = read_long(file);
+      group_update->edge_balances = checkpoint_malloc(sizeof(uint64_t)*group_update->n_edges);
+      read_bytes(file, group_update->edge_balances, sizeof(uint64_t)*group_update->n_edges);
+      group->history = push(group->history, group_update);
+    }
+    network->groups = array_insert(network->groups, group);
+  }
+}
+
+static void write_network(FILE* file, struct network* network) {
+  write_nodes(file, network);
+  write_channels(file, network);
+  write_edges(file, network);
+  write_groups(file, network);
+}
+
+static struct network* read_network(FILE* file, struct network_params net_params) {
+  struct network* network;
+  struct node* node;
+  struct edge* edge;
+  long i, j, *n_open_edges, **open_edge_ids, *group_ids;
+  double faulty_prob[2];
+
+  network = checkpoint_malloc(sizeof(struct network));
+  open_edge_ids = read_nodes(file, network, &n_open_edges);
+  read_channels(file, network);
+  group_ids = read_edges(file, network);
+  read_groups(file, network);
+
+  for(i = 0; i < array_len(network->nodes); i++) {
+    node = array_get(network->nodes, i);
+    for(j = 0; j < n_open_edges[i]; j++) {
+      edge = get_edge_by_id(network, open_edge_ids[i][j]);
+      node->open_edges = array_insert(node->open_edges, &(edge->id));
+    }
+    free(open_edge_ids[i]);
+  }
+  for(i = 0; i < array_len(network->edges); i++) {
+    if(group_ids[i] < -1 || group_ids[i] >= array_len(network->groups)) {
+      fprintf(stderr, "ERROR: corrupted checkpoint, group <%ld> does not exist\n", group_ids[i]);
+      exit(-1);
+    }
+    network->edge_store->group[i] = group_ids[i] != -1 ? array_get(network->groups, group_ids[i]) : NULL;
+  }
+  free(open_edge_ids);
+  free(n_open_edges);
+  free(group_ids);
+
+  faulty_prob[0] = 1 - net_params.faulty_node_prob;
+  faulty_prob[1] = net_params.faulty_node_prob;
+  network->faulty_node_prob = gsl_ran_discrete_preproc(2, faulty_prob);
+
+  return network;
+}
+
+
+/* GROUP ADD QUEUE */
+
+static void write_group_add_queue(FILE* file, struct group_add_queue* group_add_queue) {
+  struct group_add_queue_item* item;
+  write_tag(file, "QUEUE");
+  write_long(file, group_add_queue->len);
+  /* from the tail to the head, as the other lists */
+  for(item = group_add_queue->tail; item != NULL; item = item->prev)
+    write_long(file, item->edge->id);
+}
+
+static struct group_add_queue* read_group_add_queue(FILE* file, struct network* network) {
+  struct group_add_queue* group_add_queue;
+  struct edge** edges;
+  long i, len;
+  read_tag(file, "QUEUE");
+  len = read_long(file);
+  edges = checkpoint_malloc(sizeof(struct edge*)*(len > 0 ? len : 1));
+  for(i = 0; i < len; i++)
+    edges[i] = get_edge_by_id(network, read_long(file));
+  group_add_queue = group_add_queue_initialize();
+  for(i = len - 1; i >= 0; i--) {
+    /* the flag was restored with the edge, the edge is not in the new queue yet */
+    edge_cold(edges[i])->in_group_add_queue = 0;
+    group_add_queue_push(group_add_queue, edges[i]);
+  }
+  free(edges);
+  return group_add_queue;
+}
+
+
+/* PAYMENTS */
+
+static void write_route(FILE* file, struct route* route) {
+  struct route_hop* hop;
+  long i;
+  write_long(file, route != NULL);
+  if(route == NULL)
+    return;
+  WRITE_VALUE(file, *route);
+  write_long(file, array_len(route->route_hops));
+  for(i = 0; i < array_len(route->route_hops); i++) {
+    hop = array_get(route->route_hops, i);
+    WRITE_VALUE(file, *hop);
+  }
+}
+
+static struct route* read_route(FILE* file) {
+  struct route* route;
+  struct route_hop* hop;
+  long i, n_hops;
+  if(!read_long(file))
+    return NULL;
+  route = checkpoint_malloc(sizeof(struct route));
+  READ_VALUE(file, *route);
+  n_hops = read_long(file);
+  route->route_hops = array_of_size(n_hops);
+  for(i = 0; i < n_hops; i++) {
+    hop = checkpoint_malloc(sizeof(struct route_hop));
+    READ_VALUE(file, *hop);
+    route->route_hops = array_insert(route->route_hops, hop);
+  }
+  return route;
+}
+
+/* the hop of an error is written as its position in the route of the payment (-1 if none) */
+static long error_hop_index(struct payment* payment) {
+  long i;
+  if(payment->error.hop == NULL || payment->route == NULL)
+    return -1;
+  for(i = 0; i < array_len(payment->route->route_hops); i++)
+    if(array_get(payment->route->route_hops, i) == payment->error.hop)
+      return i;
+  return -1;
+}
+
+static void write_attempts(FILE* file, struct element* history) {
+  struct attempt* attempt;
+  struct edge_snapshot* snapshot;
+  void** attempts;
+  long i, j, n_attempts;
+  attempts = list_reversed(history, &n_attempts);
+  write_long(file, n_attempts);
+  for(i = 0; i < n_attempts; i++) {
+    attempt = attempts[i];
+    WRITE_VALUE(file, *attempt);
+    write_long(file, array_len(attempt->route));
+    for(j = 0; j < array_len(attempt->route); j++) {
+      snapshot = array_get(attempt->route, j);
+      WRITE_VALUE(file, *snapshot);
+    }
+  }
+  free(attempts);
+}
+
+static struct element* read_attempts(FILE* file) {
+  struct element* history = NULL;
+  struct attempt* attempt;
+  struct edge_snapshot* snapshot;
+  long i, j, n_attempts, n_snapshots;
+  n_attempts = read_long(file);
+  for(i = 0; i < n_attempts; i++) {
+    attempt = checkpoint_malloc(sizeof(struct attempt));
+    READ_VALUE(file, *attempt);
+    n_snapshots = read_long(file);
+    attempt->route = array_of_size(n_snapshots);
+    for(j = 0; j < n_snapshots; j++) {
+      snapshot = checkpoint_malloc(sizeof(struct edge_snapshot));
+      READ_VALUE(file, *snapshot);
+      attempt->route = array_insert(attempt->route, snapshot);
+    }
+    history = push(history, attempt);
+  }
+  return history;
+}
+
+static void write_payments(FILE* file, struct array* payments) {
+  struct payment* payment;
+  struct edge* edge;
+  long i, j;
+  write_tag(file, "PAYMENTS");
+  write_long(file, array_len(payments));
+  for(i = 0; i < array_len(payments); i++) {
+    payment = array_get(payments, i);
+    if(payment->speculated_path != NULL) {
+      fprintf(stderr, "ERROR: cannot write the checkpoint, payment <%ld> has a speculated path\n", payment->id);
+      exit(-1);
+    }
+    WRITE_VALUE(file, *payment);
+    write_route(file, payment->route);
+    write_long(file, error_hop_index(payment));
+    write_attempts(file, payment->history);
+    if(payment->min_cap_used_edges == NULL)
+      write_long(file, -1);
+    else {
+      write_long(file, array_len(payment->min_cap_used_edges));
+      for(j = 0; j < array_len(payment->min_cap_used_edges); j++) {
+        edge = array_get(payment->min_cap_used_edges, j);
+        write_long(file, edge->id);
+      }
+    }
+  }
+}
+
+static struct array* read_payments(FILE* file, struct network* network) {
+  struct array* payments;
+  struct payment* payment;
+  long i, j, n_payments, hop_index, n_edges;
+  read_tag(file, "PAYMENTS");
+  n_payments = read_long(file);
+  payments = array_of_size(n_payments);
+  for(i = 0; i < n_payments; i++) {
+    payment = checkpoint_malloc(sizeof(struct payment));
+    READ_VALUE(file, *payment);
+    payment->route = read_route(file);
+    hop_index = read_long(file);
+    payment->error.hop = hop_index != -1 ? array_get(payment->route->route_hops, hop_index) : NULL;
+    payment->history = read_attempts(file);
+    n_edges = read_long(file);
+    payment->min_cap_used_edges = NULL;
+    if(n_edges != -1) {
+      payment->min_cap_used_edges = array_of_size(n_edges);
+      for(j = 0; j < n_edges; j++)
+        payment->min_cap_used_edges = array_insert(payment->min_cap_used_edges, get_edge_by_id(network, read_long(file)));
+    }
+    payment->speculated_path = NULL;
+    payments = array_insert(payments, payment);
+  }
+  return payments;
+}
+
+/* the initial paths found by the dijkstra threads before the simulation; only those of the payments which did not start yet are needed */
+static void write_paths(FILE* file, struct array* payments) {
+  struct path_hop* hop;
+  struct payment* payment;
+  long i, j;
+  write_tag(file, "PATHS");
+  write_long(file, n_paths);
+  for(i = 0; i < n_paths; i++) {
+    payment = i < array_len(payments) ? array_get(payments, i) : NULL;
+    if(paths[i] == NULL || payment == NULL || payment->attempts > 0) {
+      write_long(file, -1);
+      continue;
+    }
+    write_long(file, array_len(paths[i]));
+    for(j = 0; j < array_len(paths[i]); j++) {
+      hop = array_get(paths[i], j);
+      WRITE_VALUE(file, *hop);
+    }
+  }
+}
+
+static void read_paths(FILE* file, struct checkpoint* checkpoint) {
+  struct path_hop* hop;
+  long i, j, n_hops;
+  read_tag(file, "PATHS");
+  checkpoint->n_paths = read_long(file);
+  checkpoint->paths = checkpoint_malloc(sizeof(struct array*)*checkpoint->n_paths);
+  for(i = 0; i < checkpoint->n_paths; i++) {
+    n_hops = read_long(file);
+    checkpoint->paths[i] = NULL;
+    if(n_hops == -1)
+      continue;
+    checkpoint->paths[i] = array_of_size(n_hops);
+    for(j = 0; j < n_hops; j++) {
+      hop = checkpoint_malloc(sizeof(struct path_hop));
+      READ_VALUE(file, *hop);
+      checkpoint->paths[i] = array_insert(checkpoint->paths[i], hop);
+    }
+  }
+}
+
+
+/* EVENTS */
+
+static void write_event(FILE* file, struct event* event, struct array* payments) {
+  WRITE_VALUE(file, event->time);
+  WRITE_VALUE(file, event->type);
+  write_long(file, event->node_id);
+  write_long(file, payment_index(payments, event->payment));
+  write_long(file, event->hop_index);
+}
+
+static struct event* read_event(FILE* file, struct array* payments) {
+  struct event* event;
+  uint64_t time;
+  enum event_type type;
+  long node_id, payment, hop_index;
+  READ_VALUE(file, time);
+  READ_VALUE(file, type);
+  node_id = read_long(file);
+  payment = read_long(file);
+  hop_index = read_long(file);
+  event = new_event(time, type, node_id, payment != -1 ? get_payment_by_index(payments, payment) : NULL);
+  event->hop_index = hop_index;
+  return event;
+}
+
+/* the events are written in the order of the scheduler, which decides the order of the events with the same time:
+   the array of the binary heap as it is, the calendar queue in the order of extraction (it keeps the events with the same time
+   in insertion order, so inserting them again in this order leaves it equivalent) */
+static void write_events(FILE* file, struct scheduler* events, struct event* next_event, struct array* payments) {
+  struct event** pending;
+  long i, n_events;
+  write_tag(file, "EVENTS");
+  write_event(file, next_event, payments);
+  WRITE_VALUE(file, events->type);
+  n_events = scheduler_len(events);
+  write_long(file, n_events);
+  if(events->type == BINARY_HEAP_SCHEDULER) {
+    write_long(file, events->heap->size);
+    for(i = 0; i < n_events; i++)
+      write_event(file, events->heap->data[i], payments);
+    return;
+  }
+  pending = malloc(sizeof(struct event*)*(n_events > 0 ? n_events : 1));
+  for(i = 0; i < n_events; i++) {
+    pending[i] = scheduler_pop(events);
+    write_event(file, pending[i], payments);
+  }
+  for(i = 0; i < n_events; i++)
+    scheduler_insert(events, pending[i]);
+  free(pending);
+}
+
+static struct scheduler* read_events(FILE* file, enum scheduler_type scheduler_type, struct array* payments, struct event** next_event) {
+  struct scheduler* events;
+  enum scheduler_type written_type;
+  long i, n_events, heap_size;
+  read_tag(file, "EVENTS");
+  *next_event = read_event(file, payments);
+  READ_VALUE(file, written_type);
+  n_events = read_long(file);
+  heap_size = written_type == BINARY_HEAP_SCHEDULER ? read_long(file) : n_events;
+  events = scheduler_initialize(scheduler_type, heap_size > n_events ? heap_size : n_events + 1);
+  for(i = 0; i < n_events; i++) {
+    if(scheduler_type == BINARY_HEAP_SCHEDULER && written_type == BINARY_HEAP_SCHEDULER) {
+      /* the heap is restored as it was, not rebuilt by insertion, to keep the order of the events with the same time */
+      events->heap->data[i] = read_event(file, payments);
+      events->heap->index = i + 1;
+    }
+    else
+      scheduler_insert(events, read_event(file, payments));
+  }
+  return events;
+}
+
+
+/* RANDOM GENERATOR */
+
+static void write_random_generator(FILE* file, gsl_rng* random_generator) {
+  const char* name = random_generator->type->name;
+  write_tag(file, "RNG");
+  write_long(file, strlen(name));
+  write_bytes(file, name, strlen(name));
+  if(gsl_rng_fwrite(file, random_generator) != 0) {
+    fprintf(stderr, "ERROR: cannot write the state of the random generator in the checkpoint\n");
+    exit(-1);
+  }
+}
+
+static void read_random_generator(FILE* file, gsl_rng* random_generator) {
+  char name[256];
+  long len;
+  read_tag(file, "RNG");
+  len = read_long(file);
+  if(len < 0 || len >= (long) sizeof(name)) {
+    fprintf(stderr, "ERROR: corrupted checkpoint, wrong name of the random generator\n");
+    exit(-1);
+  }
+  read_bytes(file, name, len);
+  name[len] = '\0';
+  if(strcmp(name, random_generator->type->name) != 0) {
+    fprintf(stderr, "ERROR: the checkpoint was written with the random generator <%s>, not <%s> (see GSL_RNG_TYPE)\n", name, random_generator->type->name);
+    exit(-1);
+  }
+  if(gsl_rng_fread(file, random_generator) != 0) {
+    fprintf(stderr, "ERROR: cannot read the state of the random generator from the checkpoint\n");
+    exit(-1);
+  }
+}
+
+
+/* write the state of the simulation in `filename` just before `next_event` (already extracted from the scheduler) is executed;
+   the file is written under a temporary name and renamed at the end, so that it is never left incomplete */
+void write_checkpoint(char filename[], struct simulation* simulation, struct network* network, struct array* payments,
+                      struct group_add_queue* group_add_queue, struct event* next_event, struct metrics* metrics) {
+  FILE* file;
+  char tmp_filename[1024];
+  uint32_t version = CHECKPOINT_VERSION;
+
+  snprintf(tmp_filename, sizeof(tmp_filename), "%s.tmp", filename);
+  file = fopen(tmp_filename, "wb");
+  if(file == NULL) {
+    fprintf(stderr, "ERROR: cannot open <%s>\n", tmp_filename);
+    exit(-1);
+  }
+
+  write_bytes(file, CHECKPOINT_MAGIC, strlen(CHECKPOINT_MAGIC));
+  WRITE_VALUE(file, version);
+  write_tag(file, "STATE");
+  WRITE_VALUE(file, simulation->current_time);
+  WRITE_VALUE(file, network_version);
+  WRITE_VALUE(file, group_attempt_counter);
+  write_random_generator(file, simulation->random_generator);
+  write_network(file, network);
+  write_group_add_queue(file, group_add_queue);
+  write_payments(file, payments);
+  write_paths(file, payments);
+  write_events(file, simulation->events, next_event, payments);
+  write_tag(file, "METRICS");
+  write_long(file, metrics != NULL);
+  if(metrics != NULL)
+    WRITE_VALUE(file, *metrics);
+  write_tag(file, "END");
+
+  if(fclose(file) != 0 || rename(tmp_filename, filename) != 0) {
+    fprintf(stderr, "ERROR: cannot write the checkpoint <%s>\n", filename);
+    exit(-1);
+  }
+}
+
+/* read the checkpoint `filename`: the state of the simulation (current time, random generator, events) is restored in `simulation`,
+   the rest is returned; the events are put in a scheduler of type `event_scheduler` */
+struct checkpoint* read_checkpoint(char filename[], struct network_params net_params, struct simulation* simulation) {
+  FILE* file;
+  struct checkpoint* checkpoint;
+  char magic[sizeof(CHECKPOINT_MAGIC)];
+  uint32_t version;
+
+  file = fopen(filename, "rb");
+  if(file == NULL) {
+    fprintf(stderr, "ERROR: cannot open the checkpoint <%s>\n", filename);
+    exit(-1);
+  }
+
+  read_bytes(file, magic, strlen(CHECKPOINT_MAGIC));
+  magic[strlen(CHECKPOINT_MAGIC)] = '\0';
+  if(strcmp(magic, CHECKPOINT_MAGIC) != 0) {
+    fprintf(stderr, "ERROR: <%s> is not a checkpoint\n", filename);
+    exit(-1);
+  }
+  READ_VALUE(file, version);
+  if(version != CHECKPOINT_VERSION) {
+    fprintf(stderr, "ERROR: unsupported version %u of the checkpoint <%s>\n", version, filename);
+    exit(-1);
+  }
+
+  checkpoint = checkpoint_malloc(sizeof(struct checkpoint));
+  read_tag(file, "STATE");
+  READ_VALUE(file, simulation->current_time);
+  READ_VALUE(file, network_version);
+  READ_VALUE(file, group_attempt_counter);
+  read_random_generator(file, simulation->random_generator);
+  checkpoint->network = read_network(file, net_params);
+  checkpoint->group_add_queue = read_group_add_queue(file, checkpoint->network);
+  checkpoint->payments = read_payments(file, checkpoint->network);
+  read_paths(file, checkpoint);
+  simulation->events = read_events(file, net_params.event_scheduler, checkpoint->payments, &(checkpoint->next_event));
+  read_tag(file, "METRICS");
+  checkpoint->metrics = NULL;
+  if(read_long(file)) {
+    checkpoint->metrics = checkpoint_malloc(sizeof(struct metrics));
+    READ_VALUE(file, *(checkpoint->metrics));
+  }
+  read_tag(file, "END");
+
+  fclose(file);
+  return checkpoint;
+}
+
+/* replace the initial paths allocated by `initialize_dijkstra` with those of the checkpoint */
+void restore_initial_paths(struct checkpoint* checkpoint) {
+  free(paths);
+  paths = checkpoint->paths;
+  n_paths = checkpoint->n_paths;
+}
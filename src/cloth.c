@@ -19,6 +19,14 @@
 #include "../include/cloth.h"
 #include "../include/network.h"
 #include "../include/event.h"
+#include "../include/progress.h"
+#include "../include/speculation.h"
+#include "../include/output.h"
+#include "../include/columnar.h"
+#include "../include/metrics.h"
+#include "../include/checkpoint.h"
+#include "../include/sweep.h"
+#include "../include/thread_pool.h"
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <errno.h>
@@ -41,49 +49,42 @@ static void ensure_parent_dir(const char* filepath){
   char* slash = strrchr(dir, '/'); if (slash) { *slash = '\0'; mkdir_p(dir); }
 }
 
-/* write the final values of nodes, channels, edges and payments in csv files */
-/*出力ファイルにノード、チャネル、エッジ、支払いの最終値をcsvファイルに出力*/
-void write_output(struct network* network, struct array* payments, char output_dir_name[]) {
-  FILE* csv_channel_output, *csv_group_output, *csv_edge_output, *csv_payment_output, *csv_node_output;
-  long i,j, *id;
+/* channels_output.csv */
+static void write_channels_output(struct network* network, char output_dir_name[]) {
+  struct output_file* csv_channel_output;
   struct channel* channel;
-  struct edge* edge;
-  struct payment* payment;
-  struct node* node;
-  struct route* route;
-  struct array* hops;
-  struct route_hop* hop;
-  DIR* results_dir;
+  long i;
   char output_filename[512];
 
-  results_dir = opendir(output_dir_name);
-  if(!results_dir){
-    printf("cloth.c: Cannot find the output directory. The output will be stored in the current directory.\n");
-    strcpy(output_dir_name, "./");
-  }
-
   strcpy(output_filename, output_dir_name);
   strcat(output_filename, "channels_output.csv"); //チャネルの情報（ID、ノード間の接続、容量など）
-  csv_channel_output = fopen(output_filename, "w");
+  csv_channel_output = output_open(output_filename, output_writer);
   if(csv_channel_output  == NULL) {
     printf("ERROR cannot open channel_output.csv\n");
     exit(-1);
   }
-  fprintf(csv_channel_output, "id,edge1,edge2,node1,node2,capacity,is_closed\n");
+  output_printf(csv_channel_output, "id,edge1,edge2,node1,node2,capacity,is_closed\n");
   for(i=0; i<array_len(network->channels); i++) {
     channel = array_get(network->channels, i);
-    fprintf(csv_channel_output, "%ld,%ld,%ld,%ld,%ld,%ld,%d\n", channel->id, channel->edge1, channel->edge2, channel->node1, channel->node2, channel->capacity, channel->is_closed);
+    output_printf(csv_channel_output, "%ld,%ld,%ld,%ld,%ld,%ld,%d\n", channel->id, channel->edge1, channel->edge2, channel->node1, channel->node2, channel->capacity, channel->is_closed);
   }
-  fclose(csv_channel_output);
+  output_close(csv_channel_output);
+}
+
+/* groups_output.csv */
+static void write_groups_output(struct network* network, char output_dir_name[]) {
+  struct output_file* csv_group_output;
+  long i, j;
+  char output_filename[512];
 
   strcpy(output_filename, output_dir_name);
   strcat(output_filename, "groups_output.csv");
-  csv_group_output = fopen(output_filename, "w");
+  csv_group_output = output_open(output_filename, output_writer);
   if(csv_group_output  == NULL) {
     printf("ERROR cannot open groups_output.csv\n"); //グループの情報（構成エッジ、容量、閉鎖状態など）
     exit(-1);
   }
-    fprintf(csv_group_output, "id,edges,balances,is_closed(closed_time),constructed_time,min_cap_limit,max_cap_limit,max_edge_balance,min_edge_balance,group_capacity,cul\n");
+    output_printf(csv_group_output, "id,edges,balances,is_closed(closed_time),constructed_time,min_cap_limit,max_cap_limit,max_edge_balance,min_edge_balance,group_capacity,cul\n");
   for(i=0; i<array_len(network->groups); i++) {
     struct group *group = array_get(network->groups, i);
     if (!group) continue;
@@ -97,14 +98,14 @@ void write_output(struct network* network, struct array* payments, char output_d
     }
 
     /* id */
-    fprintf(csv_group_output, "%ld,", group->id);
+    output_printf(csv_group_output, "%ld,", group->id);
 
     /* edges（現メンバーID列挙：順序は group->edges の並び） */
     for(j=0; j< n_members; j++){
       struct edge* edge_snapshot = array_get(group->edges, j);
-      fprintf(csv_group_output, "%ld", edge_snapshot ? edge_snapshot->id : -1);
-      if(j < n_members -1) fprintf(csv_group_output, "-");
-      else                fprintf(csv_group_output, ",");
+      output_printf(csv_group_output, "%ld", edge_snapshot ? edge_snapshot->id : -1);
+      if(j < n_members -1) output_printf(csv_group_output, "-");
+      else                output_printf(csv_group_output, ",");
     }
 
     /* balances（最新スナップショットの edge_balances を出力） */
@@ -116,12 +117,12 @@ void write_output(struct network* network, struct array* payments, char output_d
       } else {
         /* 保険：history が無い異常系は現在値で埋める */
         struct edge* edge_snapshot = array_get(group->edges, j);
-        b = edge_snapshot ? edge_snapshot->balance : 0;
+        b = edge_snapshot ? edge_get_balance(edge_snapshot) : 0;
       }
 
-      fprintf(csv_group_output, "%" PRIu64, (uint64_t)b);
-      if(j < n_members -1) fprintf(csv_group_output, "-");
-      else                fprintf(csv_group_output, ",");
+      output_printf(csv_group_output, "%" PRIu64, (uint64_t)b);
+      if(j < n_members -1) output_printf(csv_group_output, "-");
+      else                output_printf(csv_group_output, ",");
     }
 
     /* is_closed(closed_time) */
@@ -144,7 +145,7 @@ void write_output(struct network* network, struct array* payments, char output_d
           eb = group_update->edge_balances[j];
         } else {
           struct edge* edge_snapshot = array_get(group->edges, j);
-          eb = edge_snapshot ? edge_snapshot->balance : 0;
+          eb = edge_snapshot ? edge_get_balance(edge_snapshot) : 0;
         }
 
         if (eb < min_b) min_b = eb;
@@ -161,7 +162,7 @@ void write_output(struct network* network, struct array* payments, char output_d
     }
 
     /* 出力：max/min/group_capacity/cul も同一スナップショットの値 */
-    fprintf(csv_group_output,
+    output_printf(csv_group_output,
             "%lld,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%f\n",
             closed_time_out,
             (uint64_t)group->constructed_time,
@@ -172,161 +173,253 @@ void write_output(struct network* network, struct array* payments, char output_d
             (uint64_t)cap,
             (n_members > 0 ? (sum_cul / (float)n_members) : 0.0f));
   }
-  fclose(csv_group_output);
+  output_close(csv_group_output);
+}
+
+/* edges_output.csv and channel_updates_output.csv */
+static void write_edges_output(struct network* network, char output_dir_name[]) {
+  struct output_file* csv_edge_output, *csv_channel_update_output;
+  struct edge* edge;
+  long i, j;
+  char output_filename[512];
 
   strcpy(output_filename, output_dir_name);
   strcat(output_filename, "edges_output.csv"); //エッジの情報（ID、接続ノード、バランス、手数料など）
-  csv_edge_output = fopen(output_filename, "w");
+  csv_edge_output = output_open(output_filename, output_writer);
   if(csv_edge_output  == NULL) {
     printf("ERROR cannot open edge_output.csv\n");
     exit(-1);
   }
-  fprintf(csv_edge_output, "id,channel_id,counter_edge_id,from_node_id,to_node_id,balance,fee_base,fee_proportional,min_htlc,timelock,is_closed,tot_flows,min_cap_use_count,channel_updates,group,locked_balance_and_duration\n");
+  strcpy(output_filename, output_dir_name);
+  strcat(output_filename, "channel_updates_output.csv"); //エッジごとに保持されたchannel_update（1行1件）
+  csv_channel_update_output = output_open(output_filename, output_writer);
+  if(csv_channel_update_output  == NULL) {
+    printf("ERROR cannot open channel_updates_output.csv\n");
+    exit(-1);
+  }
+  output_printf(csv_channel_update_output, "edge_id,time,htlc_maximum_msat\n");
+  output_printf(csv_edge_output, "id,channel_id,counter_edge_id,from_node_id,to_node_id,balance,fee_base,fee_proportional,min_htlc,timelock,is_closed,tot_flows,min_cap_use_count,channel_updates,group,locked_count,locked_balance_duration_sum,locked_balance_duration_max,locked_balance_duration_histogram\n");
   for(i=0; i<array_len(network->edges); i++) {
     edge = array_get(network->edges, i);
-    fprintf(csv_edge_output,
+    output_printf(csv_edge_output,
         "%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%d,%d,%" PRIu64 ",%" PRIu64 ",",
         edge->id,
         edge->channel_id,
         edge->counter_edge_id,
         edge->from_node_id,
         edge->to_node_id,
-        edge->balance,
+        edge_get_balance(edge),
         edge->policy.fee_base,
         edge->policy.fee_proportional,
         edge->policy.min_htlc,
         edge->policy.timelock,
         edge->is_closed,
-        edge->tot_flows,
-        edge->min_cap_use_count);
-    char channel_updates_text[1000000] = "";
-    for (struct element *iterator = edge->channel_updates; iterator != NULL; iterator = iterator->next) {
-        struct channel_update *channel_update = iterator->data;
-        char temp[1000000];
-        int written = 0;
-        if(iterator->next != NULL) {
-            written = snprintf(temp, sizeof(temp), "-%ld%s", channel_update->htlc_maximum_msat, channel_updates_text);
-        }else{
-            written = snprintf(temp, sizeof(temp), "%ld%s", channel_update->htlc_maximum_msat, channel_updates_text);
-        }
-        // Check if the output was truncated
-        if (written < 0 || (size_t)written >= sizeof(temp)) {
-            fprintf(stderr, "Error: Buffer overflow detected.\n");
-            exit(1);
-        }
-        strncpy(channel_updates_text, temp, sizeof(channel_updates_text) - 1);
-    }
-    fprintf(csv_edge_output, "%s,", channel_updates_text);
-    if(edge->group == NULL){
-        fprintf(csv_edge_output, "NULL,");
+        edge_get_tot_flows(edge),
+        edge_cold(edge)->min_cap_use_count);
+    /* channel_updates (oldest to newest) are streamed to both files */
+    for (j = 0; j < channel_updates_len(edge); j++) {
+        struct channel_update *channel_update = get_channel_update(edge, j);
+        output_printf(csv_edge_output, j == 0 ? "%" PRIu64 : "-%" PRIu64, channel_update->htlc_maximum_msat);
+        output_printf(csv_channel_update_output, "%ld,%" PRIu64 ",%" PRIu64 "\n", edge->id, channel_update->time, channel_update->htlc_maximum_msat);
+    }
+    output_printf(csv_edge_output, ",");
+    if(edge_get_group(edge) == NULL){
+        output_printf(csv_edge_output, "NULL,");
     }else{
-        fprintf(csv_edge_output, "%ld,", edge->group->id);
-    }
-    for(struct element* iterator = edge->edge_locked_balance_and_durations; iterator != NULL; iterator = iterator->next){
-        struct edge_locked_balance_and_duration* edge_locked_balance_time = iterator->data;
-        uint64_t locked_time = edge_locked_balance_time->locked_end_time - edge_locked_balance_time->locked_start_time;
-        fprintf(csv_edge_output, "%lux%lu", edge_locked_balance_time->locked_balance, locked_time);
-        if(iterator->next != NULL){
-            fprintf(csv_edge_output, "-");
-        }
+        output_printf(csv_edge_output, "%ld,", edge_get_group(edge)->id);
+    }
+    struct edge_locked_stats* locked_stats = &(edge_cold(edge)->locked_stats);
+    output_printf(csv_edge_output, "%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",", locked_stats->count, locked_stats->sum_balance_duration, locked_stats->max_balance_duration);
+    for(j = 0; j < LOCKED_HISTOGRAM_BUCKETS; j++){
+        output_printf(csv_edge_output, j == 0 ? "%" PRIu64 : "-%" PRIu64, locked_stats->histogram[j]);
     }
-    fprintf(csv_edge_output, "\n");
+    output_printf(csv_edge_output, "\n");
   }
-  fclose(csv_edge_output);
+  output_close(csv_edge_output);
+  output_close(csv_channel_update_output);
+}
+
+/* payments_output.csv */
+static void write_payments_output(struct network* network, struct array* payments, char output_dir_name[]) {
+  struct output_file* csv_payment_output;
+  struct channel* channel;
+  struct edge* edge;
+  struct payment* payment;
+  struct route* route;
+  struct array* hops;
+  struct route_hop* hop;
+  long i, j;
+  char output_filename[512];
 
   strcpy(output_filename, output_dir_name);
   strcat(output_filename, "payments_output.csv"); //支払いの詳細（送信者、受信者、金額、ルート、成功/失敗など）
-  csv_payment_output = fopen(output_filename, "w");
+  csv_payment_output = output_open(output_filename, output_writer);
   if(csv_payment_output  == NULL) {
     printf("ERROR cannot open payment_output.csv\n");
     exit(-1);
   }
-  fprintf(csv_payment_output, "id,sender_id,receiver_id,amount,start_time,max_fee_limit,end_time,mpp,is_success,no_balance_count,offline_node_count,timeout_exp,attempts,route,total_fee,attempts_history\n");
+  output_printf(csv_payment_output, "id,sender_id,receiver_id,amount,start_time,max_fee_limit,end_time,mpp,is_success,no_balance_count,offline_node_count,timeout_exp,attempts,route,total_fee,attempts_history\n");
   for(i=0; i<array_len(payments); i++)  {
     payment = array_get(payments, i);
     if (payment->id == -1) continue;
-    fprintf(csv_payment_output, "%ld,%ld,%ld,%ld,%ld,%ld,%ld,%u,%u,%d,%d,%u,%d,", payment->id, payment->sender, payment->receiver, payment->amount, payment->start_time, payment->max_fee_limit, payment->end_time, payment->is_shard, payment->is_success, payment->no_balance_count, payment->offline_node_count, payment->is_timeout, payment->attempts);
+    output_printf(csv_payment_output, "%ld,%ld,%ld,%ld,%ld,%ld,%ld,%u,%u,%d,%d,%u,%d,", payment->id, payment->sender, payment->receiver, payment->amount, payment->start_time, payment->max_fee_limit, payment->end_time, payment->is_shard, payment->is_success, payment->no_balance_count, payment->offline_node_count, payment->is_timeout, payment->attempts);
     route = payment->route;
     if(route==NULL)
-      fprintf(csv_payment_output, ",,");
+      output_printf(csv_payment_output, ",,");
     else {
       hops = route->route_hops;
       for(j=0; j<array_len(hops); j++) {
         hop = array_get(hops, j);
         if(j==array_len(hops)-1)
-          fprintf(csv_payment_output,"%ld,",hop->edge_id);
+          output_printf(csv_payment_output,"%ld,",hop->edge_id);
         else
-          fprintf(csv_payment_output,"%ld-",hop->edge_id);
+          output_printf(csv_payment_output,"%ld-",hop->edge_id);
       }
-      fprintf(csv_payment_output, "%ld,",route->total_fee);
+      output_printf(csv_payment_output, "%ld,",route->total_fee);
     }
     // build attempts history json
     if(payment->history != NULL) {
-        fprintf(csv_payment_output, "\"[");
+        output_printf(csv_payment_output, "\"[");
         for (struct element *iterator = payment->history; iterator != NULL; iterator = iterator->next) {
             struct attempt *attempt = iterator->data;
-            fprintf(csv_payment_output, "{\"\"attempts\"\":%d,\"\"is_succeeded\"\":%d,\"\"end_time\"\":%lu,\"\"error_edge\"\":%lu,\"\"error_type\"\":%d,\"\"route\"\":[", attempt->attempts, attempt->is_succeeded, attempt->end_time, attempt->error_edge_id, attempt->error_type);
+            output_printf(csv_payment_output, "{\"\"attempts\"\":%d,\"\"is_succeeded\"\":%d,\"\"end_time\"\":%lu,\"\"error_edge\"\":%lu,\"\"error_type\"\":%d,\"\"route\"\":[", attempt->attempts, attempt->is_succeeded, attempt->end_time, attempt->error_edge_id, attempt->error_type);
             for (j = 0; j < array_len(attempt->route); j++) {
                 struct edge_snapshot* edge_snapshot = array_get(attempt->route, j);
                 edge = array_get(network->edges, edge_snapshot->id);
                 channel = array_get(network->channels, edge->channel_id);
-                fprintf(csv_payment_output,"{\"\"edge_id\"\":%lu,\"\"from_node_id\"\":%lu,\"\"to_node_id\"\":%lu,\"\"sent_amt\"\":%lu,\"\"edge_cap\"\":%lu,\"\"channel_cap\"\":%lu,", edge_snapshot->id, edge->from_node_id, edge->to_node_id, edge_snapshot->sent_amt, edge_snapshot->balance, channel->capacity);
-                if(edge_snapshot->is_in_group) fprintf(csv_payment_output, "\"\"group_cap\"\":%lu,", edge_snapshot->group_cap);
-                else fprintf(csv_payment_output,"\"\"group_cap\"\":null,");
-                if(edge_snapshot->does_channel_update_exist) fprintf(csv_payment_output,"\"\"channel_update\"\":%lu}", edge_snapshot->last_channle_update_value);
-                else fprintf(csv_payment_output,"\"\"channel_update\"\":}");
-                if (j != array_len(attempt->route) - 1) fprintf(csv_payment_output, ",");
+                output_printf(csv_payment_output,"{\"\"edge_id\"\":%lu,\"\"from_node_id\"\":%lu,\"\"to_node_id\"\":%lu,\"\"sent_amt\"\":%lu,\"\"edge_cap\"\":%lu,\"\"channel_cap\"\":%lu,", edge_snapshot->id, edge->from_node_id, edge->to_node_id, edge_snapshot->sent_amt, edge_snapshot->balance, channel->capacity);
+                if(edge_snapshot->is_in_group) output_printf(csv_payment_output, "\"\"group_cap\"\":%lu,", edge_snapshot->group_cap);
+                else output_printf(csv_payment_output,"\"\"group_cap\"\":null,");
+                if(edge_snapshot->does_channel_update_exist) output_printf(csv_payment_output,"\"\"channel_update\"\":%lu}", edge_snapshot->last_channle_update_value);
+                else output_printf(csv_payment_output,"\"\"channel_update\"\":}");
+                if (j != array_len(attempt->route) - 1) output_printf(csv_payment_output, ",");
             }
-            fprintf(csv_payment_output, "]}");
-            if (iterator->next != NULL) fprintf(csv_payment_output, ",");
-            else fprintf(csv_payment_output, "]");
+            output_printf(csv_payment_output, "]}");
+            if (iterator->next != NULL) output_printf(csv_payment_output, ",");
+            else output_printf(csv_payment_output, "]");
         }
-        fprintf(csv_payment_output, "\"");
+        output_printf(csv_payment_output, "\"");
     }
-    fprintf(csv_payment_output, "\n");
+    output_printf(csv_payment_output, "\n");
   }
-  fclose(csv_payment_output);
+  output_close(csv_payment_output);
+}
+
+/* nodes_output.csv */
+static void write_nodes_output(struct network* network, char output_dir_name[]) {
+  struct output_file* csv_node_output;
+  struct node* node;
+  long i, j, *id;
+  char output_filename[512];
 
   strcpy(output_filename, output_dir_name);
   strcat(output_filename, "nodes_output.csv");
-  csv_node_output = fopen(output_filename, "w");
+  csv_node_output = output_open(output_filename, output_writer);
   if(csv_node_output  == NULL) {
     printf("ERROR cannot open nodes_output.csv\n"); //ノードの情報（ID、接続エッジなど）
     return;
   }
-  fprintf(csv_node_output, "id,open_edges\n");
+  output_printf(csv_node_output, "id,open_edges\n");
   for(i=0; i<array_len(network->nodes); i++) {
     node = array_get(network->nodes, i);
-    fprintf(csv_node_output, "%ld,", node->id);
+    output_printf(csv_node_output, "%ld,", node->id);
     if(array_len(node->open_edges)==0)
-      fprintf(csv_node_output, "-1");
+      output_printf(csv_node_output, "-1");
     else {
       for(j=0; j<array_len(node->open_edges); j++) {
         id = array_get(node->open_edges, j);
         if(j==array_len(node->open_edges)-1)
-          fprintf(csv_node_output,"%ld",*id);
+          output_printf(csv_node_output,"%ld",*id);
         else
-          fprintf(csv_node_output,"%ld-",*id);
+          output_printf(csv_node_output,"%ld-",*id);
       }
     }
-    fprintf(csv_node_output,"\n");
+    output_printf(csv_node_output,"\n");
+  }
+  output_close(csv_node_output);
+}
+
+struct write_output_args {
+  struct network* network;
+  struct array* payments;
+  char* output_dir_name;
+};
+
+#define N_OUTPUT_FILES 5
+
+/* a job of the thread pool: format one of the output files (they are written by the output writer thread) */
+static void write_output_job(long job_index, long thread_index, void* arg) {
+  struct write_output_args* args = (struct write_output_args*) arg;
+  (void) thread_index;
+  switch(job_index) {
+  case 0:
+    write_channels_output(args->network, args->output_dir_name);
+    break;
+  case 1:
+    write_groups_output(args->network, args->output_dir_name);
+    break;
+  case 2:
+    write_edges_output(args->network, args->output_dir_name);
+    break;
+  case 3:
+    write_payments_output(args->network, args->payments, args->output_dir_name);
+    break;
+  case 4:
+    write_nodes_output(args->network, args->output_dir_name);
+    break;
+  case N_OUTPUT_FILES:
+    write_columnar_output(args->network, args->payments, args->output_dir_name);
+    break;
   }
-  fclose(csv_node_output);
+}
+
+/* write the final values of nodes, channels, edges and payments in csv files */
+/*出力ファイルにノード、チャネル、エッジ、支払いの最終値をcsvファイルに出力*/
+void write_output(struct network* network, struct array* payments, char output_dir_name[], int binary_output) {
+  struct write_output_args args;
+  DIR* results_dir;
+  long i, n_jobs;
+
+  results_dir = opendir(output_dir_name);
+  if(!results_dir){
+    printf("cloth.c: Cannot find the output directory. The output will be stored in the current directory.\n");
+    strcpy(output_dir_name, "./");
+  }
+
+  /* the files are formatted in parallel by the thread pool, each by a single thread (the last job writes payments_output.bin) */
+  args.network = network;
+  args.payments = payments;
+  args.output_dir_name = output_dir_name;
+  n_jobs = binary_output ? N_OUTPUT_FILES + 1 : N_OUTPUT_FILES;
+  if(thread_pool != NULL)
+    thread_pool_run(thread_pool, n_jobs, 1, write_output_job, &args);
+  else
+    for(i = 0; i < n_jobs; i++)
+      write_output_job(i, 0, &args);
 }
 
 /*ネットワークと支払いの初期パラメータを初期化*/
 void initialize_input_parameters(struct network_params *net_params, struct payments_params *pay_params) {
   net_params->n_nodes = net_params->n_channels = net_params->capacity_per_channel = 0;
   net_params->faulty_node_prob = 0.0;
+  net_params->event_scheduler = BINARY_HEAP_SCHEDULER;
+  net_params->n_threads = 0;
+  net_params->speculative_pathfinding = 0;
+  net_params->speculation_window = 64;
+  net_params->route_cache = 0;
+  net_params->channel_update_history = 16;
   net_params->network_from_file = 0;
   strcpy(net_params->nodes_filename, "\0");
   strcpy(net_params->channels_filename, "\0");
   strcpy(net_params->edges_filename, "\0");
+  strcpy(net_params->network_snapshot_filename, "\0");
   pay_params->inverse_payment_rate = pay_params->amount_mu = 0.0;
   pay_params->n_payments = 0;
   pay_params->payments_from_file = 0;
   strcpy(pay_params->payments_filename, "\0");
   pay_params->mpp = 0;
+  pay_params->payments_csv_export = 0;
+  pay_params->stream_payments = 0;
   net_params->tau_default               = 0.10;
   net_params->k_used_on_min_edge        = 5;
   net_params->cooldown_hops             = 5;
@@ -342,6 +435,17 @@ void initialize_input_parameters(struct network_params *net_params, struct payme
 
   /* logging defaults */
   net_params->enable_group_event_csv = 1;
+  net_params->locked_balance_trace = 0;
+  net_params->binary_output = 0;
+  net_params->metrics_summary = 1;
+  net_params->progress_every_events = 100000;
+  net_params->progress_every_seconds = 1.0;
+  net_params->progress_mmap = 0;
+  net_params->checkpoint_time = 0;
+  strcpy(net_params->checkpoint_filename, "checkpoint.bin");
+  strcpy(net_params->restore_filename, "\0");
+  strcpy(net_params->sweep_filename, "\0");
+  net_params->sweep_processes = 0;
   strncpy(net_params->group_event_csv_filename, "group_events.csv",
           sizeof(net_params->group_event_csv_filename));
   net_params->group_event_csv_filename[sizeof(net_params->group_event_csv_filename)-1] = '\0';
@@ -353,217 +457,301 @@ void initialize_input_parameters(struct network_params *net_params, struct payme
 }
 
 
-/* parse the input parameters in "cloth_input.txt" */
-/*入力ファイル（cloth_input.txt）を読み取り、シミュレーションの設定を読み込む*/
-void read_input(struct network_params* net_params, struct payments_params* pay_params){
-  FILE* input_file;
-  char *parameter, *value, line[1024];
-
-  initialize_input_parameters(net_params, pay_params);
-
-  input_file = fopen("cloth_input.txt","r");
-
-  if(input_file==NULL){
-    fprintf(stderr, "ERROR: cannot open file <cloth_input.txt> in current directory.\n");
-    exit(-1);
-  }
-
-  while(fgets(line, 1024, input_file)){
-
-    parameter = strtok(line, "=");
-    value = strtok(NULL, "=");
-    if(parameter==NULL || value==NULL){
-      fprintf(stderr, "ERROR: wrong format in file <cloth_input.txt>\n");
-      fclose(input_file);
+/* set the value of a parameter of "cloth_input.txt" */
+void set_input_parameter(struct network_params* net_params, struct payments_params* pay_params, char* parameter, char* value){
+  if(strcmp(parameter, "generate_network_from_file")==0){
+    if(strcmp(value, "true")==0)
+      net_params->network_from_file=1;
+    else if(strcmp(value, "false")==0)
+      net_params->network_from_file=0;
+    else{
+      fprintf(stderr, "ERROR: wrong value of parameter <%s> in <cloth_input.txt>. Possible values are <true> or <false>\n", parameter);
       exit(-1);
     }
-
-    if(value[0]==' ' || parameter[strlen(parameter)-1]==' '){
-      fprintf(stderr, "ERROR: no space allowed after/before <=> character in <cloth_input.txt>. Space detected in parameter <%s>\n", parameter);
-      fclose(input_file);
+  }
+  else if(strcmp(parameter, "nodes_filename")==0){
+    strcpy(net_params->nodes_filename, value);
+  }
+  else if(strcmp(parameter, "channels_filename")==0){
+    strcpy(net_params->channels_filename, value);
+  }
+  else if(strcmp(parameter, "edges_filename")==0){
+    strcpy(net_params->edges_filename, value);
+  }
+  else if(strcmp(parameter, "network_snapshot_filename")==0){
+    strcpy(net_params->network_snapshot_filename, value);
+  }
+  else if(strcmp(parameter, "n_additional_nodes")==0){
+    net_params->n_nodes = strtol(value, NULL, 10);
+  }
+  else if(strcmp(parameter, "n_channels_per_node")==0){
+    net_params->n_channels = strtol(value, NULL, 10);
+  }
+  else if(strcmp(parameter, "capacity_per_channel")==0){
+    net_params->capacity_per_channel = strtol(value, NULL, 10);
+  }
+  else if(strcmp(parameter, "faulty_node_probability")==0){
+    net_params->faulty_node_prob = strtod(value, NULL);
+  }
+  else if(strcmp(parameter, "generate_payments_from_file")==0){
+    if(strcmp(value, "true")==0)
+      pay_params->payments_from_file=1;
+    else if(strcmp(value, "false")==0)
+      pay_params->payments_from_file=0;
+    else{
+      fprintf(stderr, "ERROR: wrong value of parameter <%s> in <cloth_input.txt>. Possible values are <true> or <false>\n", parameter);
       exit(-1);
     }
-
-    value[strlen(value)-1] = '\0';
-
-    if(strcmp(parameter, "generate_network_from_file")==0){
-      if(strcmp(value, "true")==0)
-        net_params->network_from_file=1;
-      else if(strcmp(value, "false")==0)
-        net_params->network_from_file=0;
-      else{
-        fprintf(stderr, "ERROR: wrong value of parameter <%s> in <cloth_input.txt>. Possible values are <true> or <false>\n", parameter);
-        fclose(input_file);
-        exit(-1);
-      }
-    }
-    else if(strcmp(parameter, "nodes_filename")==0){
-      strcpy(net_params->nodes_filename, value);
-    }
-    else if(strcmp(parameter, "channels_filename")==0){
-      strcpy(net_params->channels_filename, value);
-    }
-    else if(strcmp(parameter, "edges_filename")==0){
-      strcpy(net_params->edges_filename, value);
-    }
-    else if(strcmp(parameter, "n_additional_nodes")==0){
-      net_params->n_nodes = strtol(value, NULL, 10);
+  }
+  else if(strcmp(parameter, "payment_timeout")==0) {
+      net_params->payment_timeout=strtol(value, NULL, 10);
+  }
+  else if(strcmp(parameter, "average_payment_forward_interval")==0) {
+      net_params->average_payment_forward_interval=strtol(value, NULL, 10);
+  }
+  else if(strcmp(parameter, "variance_payment_forward_interval")==0) {
+      net_params->variance_payment_forward_interval=strtol(value, NULL, 10);
+  }
+  else if(strcmp(parameter, "group_broadcast_delay")==0) {
+      net_params->group_broadcast_delay=strtol(value, NULL, 10);
+  }
+  else if(strcmp(parameter, "routing_method")==0){
+    if(strcmp(value, "cloth_original")==0)
+      net_params->routing_method=CLOTH_ORIGINAL;
+    else if(strcmp(value, "channel_update")==0)
+      net_params->routing_method=CHANNEL_UPDATE;
+    else if(strcmp(value, "group_routing")==0)
+      net_params->routing_method=GROUP_ROUTING;
+    else if(strcmp(value, "ideal")==0)
+      net_params->routing_method=IDEAL;
+    else{
+      fprintf(stderr, "ERROR: wrong value of parameter <%s> in <cloth_input.txt>. Possible values are [\"cloth_original\", \"channel_update\", \"group_routing\", \"ideal\"]\n", parameter);
+      exit(-1);
     }
-    else if(strcmp(parameter, "n_channels_per_node")==0){
-      net_params->n_channels = strtol(value, NULL, 10);
+  }
+  else if(strcmp(parameter, "n_threads")==0){
+    net_params->n_threads = strtol(value, NULL, 10);
+  }
+  else if(strcmp(parameter, "speculative_pathfinding")==0){
+    if(strcmp(value, "true")==0)
+      net_params->speculative_pathfinding=1;
+    else if(strcmp(value, "false")==0)
+      net_params->speculative_pathfinding=0;
+    else{
+      fprintf(stderr, "ERROR: wrong value of parameter <%s> in <cloth_input.txt>. Possible values are <true> or <false>\n", parameter);
+      exit(-1);
     }
-    else if(strcmp(parameter, "capacity_per_channel")==0){
-      net_params->capacity_per_channel = strtol(value, NULL, 10);
+  }
+  else if(strcmp(parameter, "speculation_window")==0){
+    net_params->speculation_window = strtol(value, NULL, 10);
+  }
+  else if(strcmp(parameter, "channel_update_history")==0){
+    net_params->channel_update_history = strtol(value, NULL, 10);
+  }
+  else if(strcmp(parameter, "route_cache")==0){
+    if(strcmp(value, "true")==0)
+      net_params->route_cache=1;
+    else if(strcmp(value, "false")==0)
+      net_params->route_cache=0;
+    else{
+      fprintf(stderr, "ERROR: wrong value of parameter <%s> in <cloth_input.txt>. Possible values are <true> or <false>\n", parameter);
+      exit(-1);
     }
-    else if(strcmp(parameter, "faulty_node_probability")==0){
-      net_params->faulty_node_prob = strtod(value, NULL);
+  }
+  else if(strcmp(parameter, "event_scheduler")==0){
+    if(strcmp(value, "binary_heap")==0)
+      net_params->event_scheduler=BINARY_HEAP_SCHEDULER;
+    else if(strcmp(value, "calendar_queue")==0)
+      net_params->event_scheduler=CALENDAR_QUEUE_SCHEDULER;
+    else{
+      fprintf(stderr, "ERROR: wrong value of parameter <%s> in <cloth_input.txt>. Possible values are [\"binary_heap\", \"calendar_queue\"]\n", parameter);
+      exit(-1);
     }
-    else if(strcmp(parameter, "generate_payments_from_file")==0){
+  }
+  else if(strcmp(parameter, "group_cap_update")==0){
+    if(strcmp(value, "true")==0)
+      net_params->group_cap_update=1;
+    else if(strcmp(value, "false")==0)
+      net_params->group_cap_update=0;
+    else
+      net_params->group_cap_update=-1;
+  }
+  else if(strcmp(parameter, "group_size")==0){
+      if(strcmp(value, "")==0) net_params->group_size = -1;
+      else net_params->group_size = strtol(value, NULL, 10);
+  }
+  else if(strcmp(parameter, "group_size_min")==0){
+    if(strcmp(value, "")==0) net_params->group_size_min = -1;
+    else net_params->group_size_min = strtol(value, NULL, 10);
+  }
+  else if(strcmp(parameter, "group_limit_rate")==0){
+      if(strcmp(value, "")==0) net_params->group_limit_rate = -1;
+      else net_params->group_limit_rate = strtof(value, NULL);
+  }
+  else if (strcmp(parameter,"use_conventional_method")==0) {
       if(strcmp(value, "true")==0)
-        pay_params->payments_from_file=1;
+          net_params->use_conventional_method = 1;
       else if(strcmp(value, "false")==0)
-        pay_params->payments_from_file=0;
-      else{
-        fprintf(stderr, "ERROR: wrong value of parameter <%s> in <cloth_input.txt>. Possible values are <true> or <false>\n", parameter);
-        fclose(input_file);
-        exit(-1);
-      }
-    }
-    else if(strcmp(parameter, "payment_timeout")==0) {
-        net_params->payment_timeout=strtol(value, NULL, 10);
-    }
-    else if(strcmp(parameter, "average_payment_forward_interval")==0) {
-        net_params->average_payment_forward_interval=strtol(value, NULL, 10);
-    }
-    else if(strcmp(parameter, "variance_payment_forward_interval")==0) {
-        net_params->variance_payment_forward_interval=strtol(value, NULL, 10);
-    }
-    else if(strcmp(parameter, "group_broadcast_delay")==0) {
-        net_params->group_broadcast_delay=strtol(value, NULL, 10);
-    }
-    else if(strcmp(parameter, "routing_method")==0){
-      if(strcmp(value, "cloth_original")==0)
-        net_params->routing_method=CLOTH_ORIGINAL;
-      else if(strcmp(value, "channel_update")==0)
-        net_params->routing_method=CHANNEL_UPDATE;
-      else if(strcmp(value, "group_routing")==0)
-        net_params->routing_method=GROUP_ROUTING;
-      else if(strcmp(value, "ideal")==0)
-        net_params->routing_method=IDEAL;
+          net_params->use_conventional_method = 0;
       else{
-        fprintf(stderr, "ERROR: wrong value of parameter <%s> in <cloth_input.txt>. Possible values are [\"cloth_original\", \"channel_update\", \"group_routing\", \"ideal\"]\n", parameter);
-        fclose(input_file);
-        exit(-1);
+          fprintf(stderr, "ERROR: wrong value of <use_conventional_method>. Use true or false.\n");
+          exit(-1);
       }
+  }
+  else if(strcmp(parameter, "group_min_cap_ratio")==0){
+      net_params->group_min_cap_ratio = strtof(value, NULL);
+  }
+  else if(strcmp(parameter, "group_max_cap_ratio")==0){
+      net_params->group_max_cap_ratio = strtof(value, NULL);
+  }
+  else if(strcmp(parameter, "payments_filename")==0){
+    strcpy(pay_params->payments_filename, value);
+  }
+  else if(strcmp(parameter, "payment_rate")==0){
+    pay_params->inverse_payment_rate = 1.0/strtod(value, NULL);
+  }
+  else if(strcmp(parameter, "n_payments")==0){
+    pay_params->n_payments = strtol(value, NULL, 10);
+  }
+  else if(strcmp(parameter, "average_payment_amount")==0){
+    pay_params->amount_mu = strtod(value, NULL);
+  }
+  else if(strcmp(parameter, "variance_payment_amount")==0){
+    pay_params->amount_sigma = strtod(value, NULL);
+  }
+  else if(strcmp(parameter, "mpp")==0){
+    pay_params->mpp = strtoul(value, NULL, 10);
+  }
+  else if(strcmp(parameter, "payments_csv_export")==0){
+    if(strcmp(value, "true")==0)
+      pay_params->payments_csv_export=1;
+    else if(strcmp(value, "false")==0)
+      pay_params->payments_csv_export=0;
+    else{
+      fprintf(stderr, "ERROR: wrong value of parameter <%s> in <cloth_input.txt>. Possible values are <true> or <false>\n", parameter);
+      exit(-1);
     }
-    else if(strcmp(parameter, "group_cap_update")==0){
-      if(strcmp(value, "true")==0)
-        net_params->group_cap_update=1;
-      else if(strcmp(value, "false")==0)
-        net_params->group_cap_update=0;
-      else
-        net_params->group_cap_update=-1;
-    }
-    else if(strcmp(parameter, "group_size")==0){
-        if(strcmp(value, "")==0) net_params->group_size = -1;
-        else net_params->group_size = strtol(value, NULL, 10);
-    }
-    else if(strcmp(parameter, "group_size_min")==0){
-      if(strcmp(value, "")==0) net_params->group_size_min = -1;
-      else net_params->group_size_min = strtol(value, NULL, 10);
-    }
-    else if(strcmp(parameter, "group_limit_rate")==0){
-        if(strcmp(value, "")==0) net_params->group_limit_rate = -1;
-        else net_params->group_limit_rate = strtof(value, NULL);
-    }
-    else if (strcmp(parameter,"use_conventional_method")==0) {
-        if(strcmp(value, "true")==0)
-            net_params->use_conventional_method = 1;
-        else if(strcmp(value, "false")==0)
-            net_params->use_conventional_method = 0;
-        else{
-            fprintf(stderr, "ERROR: wrong value of <use_conventional_method>. Use true or false.\n");
-            fclose(input_file);
-            exit(-1);
-        }
-    }
-    else if(strcmp(parameter, "group_min_cap_ratio")==0){
-        net_params->group_min_cap_ratio = strtof(value, NULL);
-    }
-    else if(strcmp(parameter, "group_max_cap_ratio")==0){
-        net_params->group_max_cap_ratio = strtof(value, NULL);
-    }
-    else if(strcmp(parameter, "payments_filename")==0){
-      strcpy(pay_params->payments_filename, value);
-    }
-    else if(strcmp(parameter, "payment_rate")==0){
-      pay_params->inverse_payment_rate = 1.0/strtod(value, NULL);
-    }
-    else if(strcmp(parameter, "n_payments")==0){
-      pay_params->n_payments = strtol(value, NULL, 10);
-    }
-    else if(strcmp(parameter, "average_payment_amount")==0){
-      pay_params->amount_mu = strtod(value, NULL);
-    }
-    else if(strcmp(parameter, "variance_payment_amount")==0){
-      pay_params->amount_sigma = strtod(value, NULL);
-    }
-    else if(strcmp(parameter, "mpp")==0){
-      pay_params->mpp = strtoul(value, NULL, 10);
-    }
-    else if(strcmp(parameter, "average_max_fee_limit")==0){
-        pay_params->max_fee_limit_mu = strtod(value, NULL);
-    }
-    else if(strcmp(parameter, "variance_max_fee_limit")==0){
-        pay_params->max_fee_limit_sigma = strtod(value, NULL);
-    }
-    else if(strcmp(parameter, "tau_default")==0){
-      net_params->tau_default = strtod(value, NULL);
-    }
-    else if(strcmp(parameter, "k_used_on_min_edge")==0){
-      net_params->k_used_on_min_edge = (int)strtol(value, NULL, 10);
-    }
-    else if(strcmp(parameter, "cooldown_hops")==0){
-      net_params->cooldown_hops = (int)strtol(value, NULL, 10);
-    }
-    else if(strcmp(parameter, "max_leaves_per_group_tick")==0){
-      net_params->max_leaves_per_group_tick = (int)strtol(value, NULL, 10);
+  }
+  else if(strcmp(parameter, "stream_payments")==0){
+    if(strcmp(value, "true")==0)
+      pay_params->stream_payments=1;
+    else if(strcmp(value, "false")==0)
+      pay_params->stream_payments=0;
+    else{
+      fprintf(stderr, "ERROR: wrong value of parameter <%s> in <cloth_input.txt>. Possible values are <true> or <false>\n", parameter);
+      exit(-1);
     }
-    else if(strcmp(parameter, "enable_group_event_csv")==0){
-      if(strcmp(value, "true")==0)      net_params->enable_group_event_csv = 1;
-      else if(strcmp(value, "false")==0)net_params->enable_group_event_csv = 0;
-      else{
-        fprintf(stderr, "ERROR: wrong value of <enable_group_event_csv>. Use true or false.\n");
-        fclose(input_file);
-        exit(-1);
-      }
+  }
+  else if(strcmp(parameter, "average_max_fee_limit")==0){
+      pay_params->max_fee_limit_mu = strtod(value, NULL);
+  }
+  else if(strcmp(parameter, "variance_max_fee_limit")==0){
+      pay_params->max_fee_limit_sigma = strtod(value, NULL);
+  }
+  else if(strcmp(parameter, "tau_default")==0){
+    net_params->tau_default = strtod(value, NULL);
+  }
+  else if(strcmp(parameter, "k_used_on_min_edge")==0){
+    net_params->k_used_on_min_edge = (int)strtol(value, NULL, 10);
+  }
+  else if(strcmp(parameter, "cooldown_hops")==0){
+    net_params->cooldown_hops = (int)strtol(value, NULL, 10);
+  }
+  else if(strcmp(parameter, "max_leaves_per_group_tick")==0){
+    net_params->max_leaves_per_group_tick = (int)strtol(value, NULL, 10);
+  }
+  else if(strcmp(parameter, "enable_group_event_csv")==0){
+    if(strcmp(value, "true")==0)      net_params->enable_group_event_csv = 1;
+    else if(strcmp(value, "false")==0)net_params->enable_group_event_csv = 0;
+    else{
+      fprintf(stderr, "ERROR: wrong value of <enable_group_event_csv>. Use true or false.\n");
+      exit(-1);
     }
-    else if(strcmp(parameter, "group_event_csv_filename")==0){
-      strncpy(net_params->group_event_csv_filename, value, sizeof(net_params->group_event_csv_filename));
-      net_params->group_event_csv_filename[sizeof(net_params->group_event_csv_filename)-1] = '\0';
+  }
+  else if(strcmp(parameter, "locked_balance_trace")==0){
+    if(strcmp(value, "true")==0)      net_params->locked_balance_trace = 1;
+    else if(strcmp(value, "false")==0)net_params->locked_balance_trace = 0;
+    else{
+      fprintf(stderr, "ERROR: wrong value of <locked_balance_trace>. Use true or false.\n");
+      exit(-1);
     }
-    else if(strcmp(parameter, "tau_randomize")==0){
-      if(strcmp(value, "true")==0)      net_params->tau_randomize = 1;
-      else if(strcmp(value, "false")==0)net_params->tau_randomize = 0;
-      else{
-        fprintf(stderr, "ERROR: wrong value of <tau_randomize>. Use true or false.\n");
-        fclose(input_file);
-        exit(-1);
-      }
+  }
+  else if(strcmp(parameter, "binary_output")==0){
+    if(strcmp(value, "true")==0)      net_params->binary_output = 1;
+    else if(strcmp(value, "false")==0)net_params->binary_output = 0;
+    else{
+      fprintf(stderr, "ERROR: wrong value of <binary_output>. Use true or false.\n");
+      exit(-1);
     }
-    else if(strcmp(parameter, "tau_min")==0){
-      net_params->tau_min = strtod(value, NULL);
+  }
+  else if(strcmp(parameter, "metrics_summary")==0){
+    if(strcmp(value, "true")==0)      net_params->metrics_summary = 1;
+    else if(strcmp(value, "false")==0)net_params->metrics_summary = 0;
+    else{
+      fprintf(stderr, "ERROR: wrong value of <metrics_summary>. Use true or false.\n");
+      exit(-1);
     }
-    else if(strcmp(parameter, "tau_max")==0){
-      net_params->tau_max = strtod(value, NULL);
+  }
+  else if(strcmp(parameter, "group_event_csv_filename")==0){
+    strncpy(net_params->group_event_csv_filename, value, sizeof(net_params->group_event_csv_filename));
+    net_params->group_event_csv_filename[sizeof(net_params->group_event_csv_filename)-1] = '\0';
+  }
+  else if(strcmp(parameter, "tau_randomize")==0){
+    if(strcmp(value, "true")==0)      net_params->tau_randomize = 1;
+    else if(strcmp(value, "false")==0)net_params->tau_randomize = 0;
+    else{
+      fprintf(stderr, "ERROR: wrong value of <tau_randomize>. Use true or false.\n");
+      exit(-1);
     }
+  }
+  else if(strcmp(parameter, "tau_min")==0){
+    net_params->tau_min = strtod(value, NULL);
+  }
+  else if(strcmp(parameter, "progress_every_events")==0){
+    net_params->progress_every_events = strtol(value, NULL, 10);
+  }
+  else if(strcmp(parameter, "progress_every_seconds")==0){
+    net_params->progress_every_seconds = strtod(value, NULL);
+  }
+  else if(strcmp(parameter, "progress_mmap")==0){
+    if(strcmp(value, "true")==0)
+      net_params->progress_mmap = 1;
+    else if(strcmp(value, "false")==0)
+      net_params->progress_mmap = 0;
     else{
-      fprintf(stderr, "ERROR: unknown parameter <%s>\n", parameter);
-      fclose(input_file);
+      fprintf(stderr, "ERROR: wrong value of parameter <%s> in <cloth_input.txt>. Possible values are [\"true\", \"false\"]\n", parameter);
       exit(-1);
     }
   }
-  // check invalid group settings
+  else if(strcmp(parameter, "checkpoint_time")==0){
+    net_params->checkpoint_time = strtoull(value, NULL, 10);
+  }
+  else if(strcmp(parameter, "checkpoint_filename")==0){
+    strncpy(net_params->checkpoint_filename, value, sizeof(net_params->checkpoint_filename));
+    net_params->checkpoint_filename[sizeof(net_params->checkpoint_filename)-1] = '\0';
+  }
+  else if(strcmp(parameter, "restore_filename")==0){
+    strncpy(net_params->restore_filename, value, sizeof(net_params->restore_filename));
+    net_params->restore_filename[sizeof(net_params->restore_filename)-1] = '\0';
+  }
+  else if(strcmp(parameter, "sweep_filename")==0){
+    strncpy(net_params->sweep_filename, value, sizeof(net_params->sweep_filename));
+    net_params->sweep_filename[sizeof(net_params->sweep_filename)-1] = '\0';
+  }
+  else if(strcmp(parameter, "sweep_processes")==0){
+    net_params->sweep_processes = strtol(value, NULL, 10);
+  }
+  else if(strcmp(parameter, "tau_max")==0){
+    net_params->tau_max = strtod(value, NULL);
+  }
+  else{
+    fprintf(stderr, "ERROR: unknown parameter <%s>\n", parameter);
+    exit(-1);
+  }
+}
+
+/* check that the values of the parameters are consistent */
+void check_input_parameters(struct network_params* net_params, struct payments_params* pay_params){
   if(net_params->routing_method == GROUP_ROUTING){
     if(net_params->group_limit_rate < 0 || net_params->group_limit_rate > 1){
       fprintf(stderr, "ERROR: wrong value of parameter <group_limit_rate> in <cloth_input.txt>.\n");
@@ -607,10 +795,60 @@ void read_input(struct network_params* net_params, struct payments_params* pay_p
     fprintf(stderr, "ERROR: max_leaves_per_group_tick must be >= 1.\n");
     exit(-1);
   }
+  if(net_params->checkpoint_time > 0 || net_params->restore_filename[0] != '\0') {
+    /* their state (speculated paths, cached paths, payment generator) is not in the checkpoint */
+    if(net_params->speculative_pathfinding || net_params->route_cache || (pay_params->stream_payments && !pay_params->payments_from_file)) {
+      fprintf(stderr, "ERROR: checkpoint_time and restore_filename cannot be used with speculative_pathfinding, route_cache or stream_payments\n");
+      exit(-1);
+    }
+  }
+
+}
+
+/* read the values of the parameters in "cloth_input.txt", without checking them */
+void read_input_file(struct network_params* net_params, struct payments_params* pay_params){
+  FILE* input_file;
+  char *parameter, *value, line[1024];
+
+  initialize_input_parameters(net_params, pay_params);
+
+  input_file = fopen("cloth_input.txt","r");
+
+  if(input_file==NULL){
+    fprintf(stderr, "ERROR: cannot open file <cloth_input.txt> in current directory.\n");
+    exit(-1);
+  }
+
+  while(fgets(line, 1024, input_file)){
+
+    parameter = strtok(line, "=");
+    value = strtok(NULL, "=");
+    if(parameter==NULL || value==NULL){
+      fprintf(stderr, "ERROR: wrong format in file <cloth_input.txt>\n");
+      fclose(input_file);
+      exit(-1);
+    }
+
+    if(value[0]==' ' || parameter[strlen(parameter)-1]==' '){
+      fprintf(stderr, "ERROR: no space allowed after/before <=> character in <cloth_input.txt>. Space detected in parameter <%s>\n", parameter);
+      fclose(input_file);
+      exit(-1);
+    }
+
+    value[strcspn(value, "\r\n")] = '\0'; // the last line may have no newline
+    set_input_parameter(net_params, pay_params, parameter, value);
+  }
 
   fclose(input_file);
 }
 
+/* parse the input parameters in "cloth_input.txt" */
+/*入力ファイル（cloth_input.txt）を読み取り、シミュレーションの設定を読み込む*/
+void read_input(struct network_params* net_params, struct payments_params* pay_params){
+  read_input_file(net_params, pay_params);
+  check_input_parameters(net_params, pay_params);
+}
+
 
 unsigned int has_shards(struct payment* payment){
   return (payment->shards_id[0] != -1 && payment->shards_id[1] != -1);
@@ -654,90 +892,180 @@ gsl_rng* initialize_random_generator(){
 }
 
 
-int main(int argc, char *argv[]) {
+/* network and payments loaded once by a parameter sweep and shared by the simulations of its points (see sweep.h) */
+struct sweep_input {
+  struct network_params net_params;
+  struct payments_params pay_params;
+  struct network* network;     // NULL if the simulations restore a checkpoint
+  gsl_rng* random_generator;   // state after the generation of the network
+  struct array* payments;      // NULL unless the payments are read from a file
+  long n_threads;              // dijkstra threads of each simulation when n_threads <= 0
+};
+
+/* whether a network generated with `a` is the same as one generated with `b` */
+static int is_same_network(struct network_params* a, struct network_params* b) {
+  if(a->network_from_file != b->network_from_file)
+    return 0;
+  if(a->network_from_file)
+    return strcmp(a->nodes_filename, b->nodes_filename) == 0 && strcmp(a->channels_filename, b->channels_filename) == 0 &&
+      strcmp(a->edges_filename, b->edges_filename) == 0 && strcmp(a->network_snapshot_filename, b->network_snapshot_filename) == 0;
+  return a->n_nodes == b->n_nodes && a->n_channels == b->n_channels && a->capacity_per_channel == b->capacity_per_channel;
+}
+
+/* run a simulation and write its output in `output_dir_name`; `sweep_input` is the data loaded by a parameter sweep (NULL if none) */
+static int simulate(struct network_params net_params, struct payments_params pay_params, struct sweep_input* sweep_input, char output_dir_name[]) {
   struct event* event;
   clock_t  begin, end;
   double time_spent=0.0;
   long time_spent_thread = 0;
-  struct network_params net_params;
-  struct payments_params pay_params;
   struct timespec start, finish;
   struct network *network;
-  long n_nodes, n_edges;
+  long n_nodes;
   struct array* payments;
+  struct payment* payment;
+  struct payment_generator* payment_generator = NULL;
   struct simulation* simulation;
-  char output_dir_name[256];
-
-  if(argc != 2) {
-    fprintf(stderr, "ERROR cloth.c: please specify the output directory\n");
-    return -1;
-  }
-  strcpy(output_dir_name, argv[1]);
-
-  {
-    DIR* results_dir = opendir(output_dir_name);
-    if(!results_dir){
-      printf("cloth.c: Cannot find the output directory. The output will be stored in the current directory.\n");
-      strcpy(output_dir_name, "./");
-    } else {
-      closedir(results_dir);
-    }
-  }
+  struct metrics* metrics = NULL;
+  struct checkpoint* checkpoint = NULL;
+  struct event* restored_event = NULL;
+  long completed_payments = 0;
+  int was_completed, checkpoint_pending;
 
-  read_input(&net_params, &pay_params); // 入力パラメータの読み込み
+  output_writer = output_writer_initialize();
   /* パラメータ読込完了後にフラグを見てオープン */
   if (net_params.enable_group_event_csv) {
     group_events_open(output_dir_name);
   }
+  if (net_params.locked_balance_trace) {
+    locked_balance_trace_open(output_dir_name);
+  }
+  if (!net_params.binary_output) {
+    remove_columnar_output(output_dir_name);
+  }
   simulation = malloc(sizeof(struct simulation));
+  simulation->current_time = 0; // time of the groups constructed before the simulation
 
   simulation->random_generator = initialize_random_generator();
-  printf("NETWORK INITIALIZATION\n");
-  network = initialize_network(net_params, simulation->random_generator); //ネットワークの初期化
-  n_nodes = array_len(network->nodes);
-  n_edges = array_len(network->edges);
-
-    // add edge which is not a member of any group to group_add_queue
-    struct element* group_add_queue = NULL;
+  struct group_add_queue* group_add_queue = NULL;
+
+  if(net_params.restore_filename[0] != '\0') {
+    /* the network, the groups, the payments, the events and the initial paths are those of the checkpoint */
+    printf("RESTORE FROM CHECKPOINT %s\n", net_params.restore_filename);
+    checkpoint = read_checkpoint(net_params.restore_filename, net_params, simulation);
+    network = checkpoint->network;
+    payments = checkpoint->payments;
+    group_add_queue = checkpoint->group_add_queue;
+    restored_event = checkpoint->next_event;
+    metrics = checkpoint->metrics;
+    if(net_params.metrics_summary && metrics == NULL) {
+      fprintf(stderr, "ERROR: the checkpoint <%s> has no metrics (it was written with metrics_summary=false)\n", net_params.restore_filename);
+      exit(-1);
+    }
+    if(!net_params.metrics_summary) {
+      metrics_free(metrics);
+      metrics = NULL;
+    }
+    initialize_dijkstra(network, payments, get_n_threads(net_params.n_threads));
+    restore_initial_paths(checkpoint);
+    free(checkpoint);
+    for(long i = 0; i < array_len(payments); i++) {
+      payment = array_get(payments, i);
+      if(payment->end_time != 0)
+        completed_payments++;
+    }
+    printf("restored at time %" PRIu64 " with %ld pending events, %ld/%ld payments completed\n", restored_event->time, scheduler_len(simulation->events) + 1, completed_payments, array_len(payments));
+  }
+  else {
+    printf("NETWORK INITIALIZATION\n");
+    if(sweep_input != NULL && sweep_input->network != NULL && is_same_network(&(sweep_input->net_params), &net_params)) {
+      /* the network loaded by the sweep, the random generator continues as if it had been generated here */
+      network = sweep_input->network;
+      gsl_rng_memcpy(simulation->random_generator, sweep_input->random_generator);
+      set_network_params(network, net_params);
+    }
+    else
+      network = initialize_network(net_params, simulation->random_generator); //ネットワークの初期化
+    n_nodes = array_len(network->nodes);
+
+    // add edge which is not a member of any group to group_add_queue (in increasing balance)
+    group_add_queue = group_add_queue_initialize();
     if(net_params.routing_method == GROUP_ROUTING) {
-      for (int i = 0; i < n_edges; i++) {
-        struct edge* e = array_get(network->edges, i);
-        if (!e) continue;
-
-        if (!e->in_group_add_queue) {
-          e->in_group_add_queue = 1;
-          group_add_queue = list_insert_sorted_position(
-              group_add_queue, e, (long (*)(void *)) get_edge_balance
-          );
-        }
-      }
-        group_add_queue = construct_groups(simulation, group_add_queue, network, net_params);
+      group_add_queue_push_by_balance(group_add_queue, network->edges);
+      construct_groups(simulation, group_add_queue, network, net_params);
+    }
+    printf("group_cover_rate on init : %f\n", (float)(array_len(network->edges) - group_add_queue->len) / (float)(array_len(network->edges)));
+    printf("n_edges=%ld, queue_len_after_init=%ld\n",array_len(network->edges), group_add_queue->len);
+
+    printf("PAYMENTS INITIALIZATION\n");
+    if(pay_params.stream_payments && !pay_params.payments_from_file) {
+      /* only the first payment is generated here, the others are generated during the simulation;
+         the generator draws from a copy of the random generator, so the payments are the same as without streaming */
+      payment_generator = new_payment_generator(pay_params, n_nodes, gsl_rng_clone(simulation->random_generator));
+      payments = array_initialize(1000);
+      payment = generate_next_payment(payment_generator, 0);
+      if(payment != NULL)
+        payments = array_insert(payments, payment);
+    }
+    else if(sweep_input != NULL && sweep_input->payments != NULL && pay_params.payments_from_file &&
+            strcmp(sweep_input->pay_params.payments_filename, pay_params.payments_filename) == 0)
+      payments = sweep_input->payments;
+    else
+      payments = initialize_payments(pay_params,  n_nodes, simulation->random_generator, get_n_threads(net_params.n_threads)); //支払いイベントの生成
+
+    printf("EVENTS INITIALIZATION\n");
+    simulation->events = initialize_events(payments, net_params.event_scheduler);
+    initialize_dijkstra(network, payments, get_n_threads(net_params.n_threads));
+
+    if(net_params.route_cache)
+      route_cache = route_cache_initialize(1024);
+
+    if(net_params.speculative_pathfinding) {
+      /* the paths are found in advance during the simulation, instead of all at the beginning */
+      speculation = speculation_initialize(net_params.speculation_window);
     }
-    printf("group_cover_rate on init : %f\n", (float)(array_len(network->edges) - list_len(group_add_queue)) / (float)(array_len(network->edges)));
-    printf("n_edges=%ld, queue_len_after_init=%ld\n",array_len(network->edges), list_len(group_add_queue));
-
-  printf("PAYMENTS INITIALIZATION\n");
-  payments = initialize_payments(pay_params,  n_nodes, simulation->random_generator); //支払いイベントの生成
-
-  printf("EVENTS INITIALIZATION\n");
-  simulation->events = initialize_events(payments);
-  initialize_dijkstra(n_nodes, n_edges, payments);
-
-  printf("INITIAL DIJKSTRA THREADS EXECUTION\n");
-  clock_gettime(CLOCK_MONOTONIC, &start);
-  run_dijkstra_threads(network, payments, 0, net_params.routing_method);
-  clock_gettime(CLOCK_MONOTONIC, &finish);
-  time_spent_thread = finish.tv_sec - start.tv_sec;
-  printf("Time consumed by initial dijkstra executions: %ld s\n", time_spent_thread);
+    else {
+      printf("INITIAL DIJKSTRA THREADS EXECUTION\n");
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      run_dijkstra_threads(network, payments, 0, net_params.routing_method);
+      clock_gettime(CLOCK_MONOTONIC, &finish);
+      time_spent_thread = finish.tv_sec - start.tv_sec;
+      printf("Time consumed by initial dijkstra executions: %ld s\n", time_spent_thread);
+    }
+  }
 
   printf("EXECUTION OF THE SIMULATION\n");
 
   /* core of the discrete-event simulation: extract next event, advance simulation time, execute the event */
   begin = clock();
-  simulation->current_time = 1;
-  long completed_payments = 0;
-  while(heap_len(simulation->events) != 0) {
-    event = heap_pop(simulation->events, compare_event); //イベントの処理（heap_popでイベントを取得し、対応する処理を実行）
+  if(restored_event == NULL)
+    simulation->current_time = 1;
+  checkpoint_pending = net_params.checkpoint_time > 0 && (restored_event == NULL || restored_event->time < net_params.checkpoint_time);
+  if(net_params.metrics_summary && metrics == NULL)
+    metrics = metrics_initialize();
+  struct progress_reporter* progress = progress_initialize(output_dir_name, net_params.progress_every_events, net_params.progress_every_seconds, net_params.progress_mmap);
+  while(restored_event != NULL || scheduler_len(simulation->events) != 0) {
+    if(restored_event != NULL) {
+      event = restored_event;
+      restored_event = NULL;
+    }
+    else
+      event = scheduler_pop(simulation->events); //イベントの処理（scheduler_popでイベントを取得し、対応する処理を実行）
+
+    if(checkpoint_pending && event->time >= net_params.checkpoint_time) {
+      printf("\nCHECKPOINT at time %" PRIu64 " in %s\n", event->time, net_params.checkpoint_filename);
+      write_checkpoint(net_params.checkpoint_filename, simulation, network, payments, group_add_queue, event, metrics);
+      checkpoint_pending = 0;
+    }
+    was_completed = event->payment->end_time != 0;
+
+    /* streaming payments: when a generated payment starts, the next one is generated and scheduled */
+    if(payment_generator != NULL && event->type == FINDPATH && event->payment == payment_generator->last_payment) {
+      payment = generate_next_payment(payment_generator, array_len(payments));
+      if(payment != NULL) {
+        payments = array_insert(payments, payment);
+        scheduler_insert(simulation->events, new_event(payment->start_time, FINDPATH, payment->sender, payment));
+      }
+    }
 
     simulation->current_time = event->time;
     switch(event->type){
@@ -775,41 +1103,52 @@ int main(int argc, char *argv[]) {
       channel_update_success(event, simulation, network);
       break;
     case UPDATEGROUP:
-      group_add_queue = request_group_update(event, simulation, network, net_params, group_add_queue);
+      request_group_update(event, simulation, network, net_params, group_add_queue);
       break;
     case CONSTRUCTGROUPS:
-      group_add_queue = construct_groups(simulation, group_add_queue, network, net_params);
+      construct_groups(simulation, group_add_queue, network, net_params);
       break;
     default:
       printf("ERROR wrong event type\n");
       exit(-1);
     }
 
-    struct payment* p = array_get(payments, event->payment->id);
-    if(p->end_time != 0 && event->type != UPDATEGROUP && event->type != CONSTRUCTGROUPS && event->type != CHANNELUPDATEFAIL && event->type != CHANNELUPDATESUCCESS){
+    if(!was_completed && event->payment->end_time != 0) {
         completed_payments++;
-        char progress_filename[512];
-        strcpy(progress_filename, output_dir_name);
-        strcat(progress_filename, "progress.tmp");
-        FILE* progress_file = fopen(progress_filename, "w");
-        if(progress_file != NULL){
-            fprintf(progress_file, "%f", (float)completed_payments / (float)array_len(payments));
-        fclose(progress_file);
-        }
+        if(metrics != NULL && !pay_params.mpp)
+          metrics_add_payment(metrics, event->payment);
     }
+    progress_event(progress, completed_payments, array_len(payments));
 
-    free(event);
+    free_event(event);
   }
+  progress_write(progress, completed_payments, array_len(payments));
+  progress_free(progress);
   printf("\n");
+  if(checkpoint_pending)
+    printf("WARNING: no event at or after checkpoint_time, the checkpoint was not written\n");
   end = clock();
 
-  if(pay_params.mpp)
+  if(pay_params.mpp) {
     post_process_payment_stats(payments);
+    /* a multi-path payment is complete only when its shards are merged */
+    for(long i = 0; metrics != NULL && i < array_len(payments); i++) {
+      payment = array_get(payments, i);
+      if(payment->id != -1)
+        metrics_add_payment(metrics, payment);
+    }
+  }
 
   time_spent = (double) (end - begin)/CLOCKS_PER_SEC;
   printf("Time consumed by simulation events: %lf s\n", time_spent);
+  if(speculation != NULL)
+    print_speculation_stats(speculation);
+  if(route_cache != NULL)
+    print_route_cache_stats(route_cache);
 
-  write_output(network, payments, output_dir_name); // シミュレーション結果の出力
+  if(metrics != NULL)
+    write_metrics_summary(metrics, network, round(pay_params.amount_mu) * round(1.0/pay_params.inverse_payment_rate), output_dir_name);
+  write_output(network, payments, output_dir_name, net_params.binary_output); // シミュレーション結果の出力
 
   /* ===== finalize: close any still-open groups at simulation end ===== */
   if (net_params.enable_group_event_csv) {
@@ -825,19 +1164,113 @@ int main(int argc, char *argv[]) {
     for (long i = 0; i < ecnt; i++) {
       struct edge* e = array_get(network->edges, i);
       if (!e) continue;
-      if (e && e->group && e->group->is_closed == GROUP_NOT_CLOSED) {
-        group_close_once(simulation, e->group, "simulation_end");
+      if (e && edge_get_group(e) && edge_get_group(e)->is_closed == GROUP_NOT_CLOSED) {
+        group_close_once(simulation, edge_get_group(e), "simulation_end");
       }
     }
     group_events_close();
   }
 
-  list_free(group_add_queue);
+  locked_balance_trace_close();
+  output_writer_free(output_writer);
+  group_add_queue_free(group_add_queue);
   free(simulation->random_generator);
-  heap_free(simulation->events);
+  if(payment_generator != NULL) {
+    gsl_rng_free(payment_generator->random_generator);
+    free_payment_generator(payment_generator);
+  }
+  scheduler_free(simulation->events);
+  free_event_pool();
+  free_routing_graph(routing_graph);
+  thread_pool_free(thread_pool);
+  speculation_free(speculation);
+  route_cache_free(route_cache);
+  metrics_free(metrics);
   free(simulation);
 
   // free_network(network);
 
   return 0;
 }
+
+/* simulation of a point of a parameter sweep, in its child process */
+static int simulate_sweep_point(struct sweep_point* point, char output_dir_name[], void* arg) {
+  struct sweep_input* sweep_input = arg;
+  struct network_params net_params;
+  struct payments_params pay_params;
+  long i;
+
+  read_input_file(&net_params, &pay_params);
+  for(i = 0; i < point->n_overrides; i++)
+    set_input_parameter(&net_params, &pay_params, point->parameters[i], point->values[i]);
+  check_input_parameters(&net_params, &pay_params);
+  if(net_params.n_threads <= 0)
+    net_params.n_threads = sweep_input->n_threads;
+
+  return simulate(net_params, pay_params, sweep_input, output_dir_name);
+}
+
+/* parameter sweep: load the network and the payments once and simulate the points of `sweep_filename` in child processes */
+static int run_parameter_sweep(struct network_params net_params, struct payments_params pay_params, char output_dir_name[]) {
+  struct sweep_input sweep_input;
+  struct array* points;
+  long n_processes, n_failed;
+
+  points = read_sweep_points(net_params.sweep_filename);
+  n_processes = get_n_threads(net_params.sweep_processes);
+  if(n_processes > array_len(points))
+    n_processes = array_len(points);
+  printf("PARAMETER SWEEP: %ld points, %ld processes\n", array_len(points), n_processes);
+
+  sweep_input.net_params = net_params;
+  sweep_input.pay_params = pay_params;
+  sweep_input.network = NULL;
+  sweep_input.payments = NULL;
+  sweep_input.random_generator = initialize_random_generator();
+  sweep_input.n_threads = get_n_threads(0) / (n_processes > 0 ? n_processes : 1);
+  if(sweep_input.n_threads < 1)
+    sweep_input.n_threads = 1;
+  /* no thread must be running when the children are forked */
+  if(net_params.restore_filename[0] == '\0') {
+    printf("NETWORK INITIALIZATION\n");
+    sweep_input.network = initialize_network(net_params, sweep_input.random_generator);
+    if(pay_params.payments_from_file) {
+      printf("PAYMENTS INITIALIZATION\n");
+      sweep_input.payments = initialize_payments(pay_params, array_len(sweep_input.network->nodes), sweep_input.random_generator, get_n_threads(net_params.n_threads));
+    }
+  }
+
+  n_failed = run_sweep(points, output_dir_name, n_processes, simulate_sweep_point, &sweep_input);
+  printf("PARAMETER SWEEP DONE: %ld/%ld points failed\n", n_failed, array_len(points));
+
+  free_sweep_points(points);
+  gsl_rng_free(sweep_input.random_generator);
+  return n_failed > 0 ? -1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+  struct network_params net_params;
+  struct payments_params pay_params;
+  char output_dir_name[256];
+
+  if(argc != 2) {
+    fprintf(stderr, "ERROR cloth.c: please specify the output directory\n");
+    return -1;
+  }
+  strcpy(output_dir_name, argv[1]);
+
+  {
+    DIR* results_dir = opendir(output_dir_name);
+    if(!results_dir){
+      printf("cloth.c: Cannot find the output directory. The output will be stored in the current directory.\n");
+      strcpy(output_dir_name, "./");
+    } else {
+      closedir(results_dir);
+    }
+  }
+
+  read_input(&net_params, &pay_params); // 入力パラメータの読み込み
+  if(net_params.sweep_filename[0] != '\0')
+    return run_parameter_sweep(net_params, pay_params, output_dir_name);
+  return simulate(net_params, pay_params, NULL, output_dir_name);
+}
@@ -0,0 +1,243 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/columnar.h"
+#include "../include/payments.h"
+#include "../include/list.h"
+
+/* Functions in this file write the payments in the binary columnar format described in columnar.h */
+
+enum payments_column {PAY_ID, PAY_SENDER, PAY_RECEIVER, PAY_AMOUNT, PAY_START_TIME, PAY_MAX_FEE_LIMIT, PAY_END_TIME, PAY_MPP, PAY_IS_SUCCESS,
+                      PAY_NO_BALANCE_COUNT, PAY_OFFLINE_NODE_COUNT, PAY_TIMEOUT_EXP, PAY_ATTEMPTS, PAY_TOTAL_FEE, PAY_ROUTE_OFFSET, PAY_ROUTE_LEN,
+                      PAY_ATTEMPTS_OFFSET, PAY_ATTEMPTS_LEN, N_PAYMENTS_COLUMNS};
+static const char* payments_columns[] = {"id", "sender_id", "receiver_id", "amount", "start_time", "max_fee_limit", "end_time", "mpp", "is_success",
+                                         "no_balance_count", "offline_node_count", "timeout_exp", "attempts", "total_fee", "route_offset", "route_len",
+                                         "attempts_offset", "attempts_len"};
+
+enum route_hops_column {ROUTE_EDGE_ID, N_ROUTE_HOPS_COLUMNS};
+static const char* route_hops_columns[] = {"edge_id"};
+
+enum attempts_column {ATT_PAYMENT_ID, ATT_ATTEMPTS, ATT_IS_SUCCEEDED, ATT_END_TIME, ATT_ERROR_EDGE, ATT_ERROR_TYPE, ATT_HOPS_OFFSET, ATT_HOPS_LEN,
+                      N_ATTEMPTS_COLUMNS};
+static const char* attempts_columns[] = {"payment_id", "attempts", "is_succeeded", "end_time", "error_edge", "error_type", "hops_offset", "hops_len"};
+
+enum attempt_hops_column {HOP_EDGE_ID, HOP_FROM_NODE_ID, HOP_TO_NODE_ID, HOP_SENT_AMT, HOP_EDGE_CAP, HOP_CHANNEL_CAP, HOP_GROUP_CAP, HOP_CHANNEL_UPDATE,
+                          N_ATTEMPT_HOPS_COLUMNS};
+static const char* attempt_hops_columns[] = {"edge_id", "from_node_id", "to_node_id", "sent_amt", "edge_cap", "channel_cap", "group_cap", "channel_update"};
+
+enum {PAYMENTS_TABLE, ROUTE_HOPS_TABLE, ATTEMPTS_TABLE, ATTEMPT_HOPS_TABLE, N_TABLES};
+
+static void table_initialize(struct columnar_table* table, const char* name, const char** column_names, long n_columns, long n_rows) {
+  long i;
+  table->name = name;
+  table->column_names = column_names;
+  table->n_columns = n_columns;
+  table->n_rows = n_rows;
+  table->columns = malloc(sizeof(int64_t*)*n_columns);
+  for(i = 0; i < n_columns; i++) {
+    table->columns[i] = malloc(sizeof(int64_t)*(n_rows > 0 ? n_rows : 1));
+    if(table->columns[i] == NULL) {
+      fprintf(stderr, "ERROR: malloc failed for column <%s> of table <%s>\n", column_names[i], name);
+      exit(-1);
+    }
+  }
+}
+
+static void table_free(struct columnar_table* table) {
+  long i;
+  for(i = 0; i < table->n_columns; i++)
+    free(table->columns[i]);
+  free(table->columns);
+}
+
+static int is_little_endian(void) {
+  uint16_t x = 1;
+  return *((uint8_t*)&x) == 1;
+}
+
+static void write_bytes(FILE* file, const void* data, size_t size) {
+  if(size > 0 && fwrite(data, 1, size, file) != size) {
+    fprintf(stderr, "ERROR: cannot write payments_output.bin\n");
+    exit(-1);
+  }
+}
+
+static void write_u32(FILE* file, uint32_t value) {
+  uint8_t bytes[4];
+  int i;
+  for(i = 0; i < 4; i++)
+    bytes[i] = (uint8_t)(value >> (8*i));
+  write_bytes(file, bytes, 4);
+}
+
+static void write_u64(FILE* file, uint64_t value) {
+  uint8_t bytes[8];
+  int i;
+  for(i = 0; i < 8; i++)
+    bytes[i] = (uint8_t)(value >> (8*i));
+  write_bytes(file, bytes, 8);
+}
+
+static void write_name(FILE* file, const char* name, size_t size) {
+  char buffer[COLUMNAR_COLUMN_NAME_SIZE];
+  memset(buffer, 0, sizeof(buffer));
+  strncpy(buffer, name, size - 1);
+  write_bytes(file, buffer, size);
+}
+
+static void write_column(FILE* file, int64_t* column, long n_rows) {
+  long i;
+  if(is_little_endian()) {
+    write_bytes(file, column, sizeof(int64_t)*n_rows);
+    return;
+  }
+  for(i = 0; i < n_rows; i++)
+    write_u64(file, (uint64_t)column[i]);
+}
+
+static void write_tables(FILE* file, struct columnar_table* tables, long n_tables) {
+  uint64_t offset;
+  long t, c;
+
+  write_bytes(file, COLUMNAR_MAGIC, 8);
+  write_u32(file, COLUMNAR_VERSION);
+  write_u32(file, n_tables);
+
+  /* the data of the columns follow the directory, in the order of the directory */
+  offset = 16;
+  for(t = 0; t < n_tables; t++)
+    offset += COLUMNAR_TABLE_NAME_SIZE + 16 + tables[t].n_columns*(COLUMNAR_COLUMN_NAME_SIZE + 8);
+
+  for(t = 0; t < n_tables; t++) {
+    write_name(file, tables[t].name, COLUMNAR_TABLE_NAME_SIZE);
+    write_u64(file, tables[t].n_rows);
+    write_u32(file, tables[t].n_columns);
+    write_u32(file, 0);
+    for(c = 0; c < tables[t].n_columns; c++) {
+      write_name(file, tables[t].column_names[c], COLUMNAR_COLUMN_NAME_SIZE);
+      write_u64(file, offset);
+      offset += sizeof(int64_t)*tables[t].n_rows;
+    }
+  }
+
+  for(t = 0; t < n_tables; t++)
+    for(c = 0; c < tables[t].n_columns; c++)
+      write_column(file, tables[t].columns[c], tables[t].n_rows);
+}
+
+/* payments_output.bin: the same payments of payments_output.csv, with the route and the attempts history as separate tables */
+void write_columnar_output(struct network* network, struct array* payments, char output_dir_name[]) {
+  struct columnar_table tables[N_TABLES];
+  struct columnar_table* pay, *route_hops, *attempts, *attempt_hops;
+  long i, j, n_payments, n_route_hops, n_attempts, n_attempt_hops, p, r, a, h;
+  struct payment* payment;
+  struct element* iterator;
+  struct attempt* attempt;
+  struct edge_snapshot* edge_snapshot;
+  struct edge* edge;
+  struct channel* channel;
+  struct route_hop* hop;
+  char output_filename[512];
+  FILE* file;
+
+  n_payments = n_route_hops = n_attempts = n_attempt_hops = 0;
+  for(i = 0; i < array_len(payments); i++) {
+    payment = array_get(payments, i);
+    if(payment->id == -1) continue;
+    n_payments++;
+    if(payment->route != NULL)
+      n_route_hops += array_len(payment->route->route_hops);
+    for(iterator = payment->history; iterator != NULL; iterator = iterator->next) {
+      attempt = iterator->data;
+      n_attempts++;
+      n_attempt_hops += array_len(attempt->route);
+    }
+  }
+
+  pay = &(tables[PAYMENTS_TABLE]);
+  route_hops = &(tables[ROUTE_HOPS_TABLE]);
+  attempts = &(tables[ATTEMPTS_TABLE]);
+  attempt_hops = &(tables[ATTEMPT_HOPS_TABLE]);
+  table_initialize(pay, "payments", payments_columns, N_PAYMENTS_COLUMNS, n_payments);
+  table_initialize(route_hops, "route_hops", route_hops_columns, N_ROUTE_HOPS_COLUMNS, n_route_hops);
+  table_initialize(attempts, "attempts", attempts_columns, N_ATTEMPTS_COLUMNS, n_attempts);
+  table_initialize(attempt_hops, "attempt_hops", attempt_hops_columns, N_ATTEMPT_HOPS_COLUMNS, n_attempt_hops);
+
+  p = r = a = h = 0;
+  for(i = 0; i < array_len(payments); i++) {
+    payment = array_get(payments, i);
+    if(payment->id == -1) continue;
+    pay->columns[PAY_ID][p] = payment->id;
+    pay->columns[PAY_SENDER][p] = payment->sender;
+    pay->columns[PAY_RECEIVER][p] = payment->receiver;
+    pay->columns[PAY_AMOUNT][p] = payment->amount;
+    pay->columns[PAY_START_TIME][p] = payment->start_time;
+    pay->columns[PAY_MAX_FEE_LIMIT][p] = payment->max_fee_limit;
+    pay->columns[PAY_END_TIME][p] = payment->end_time;
+    pay->columns[PAY_MPP][p] = payment->is_shard;
+    pay->columns[PAY_IS_SUCCESS][p] = payment->is_success;
+    pay->columns[PAY_NO_BALANCE_COUNT][p] = payment->no_balance_count;
+    pay->columns[PAY_OFFLINE_NODE_COUNT][p] = payment->offline_node_count;
+    pay->columns[PAY_TIMEOUT_EXP][p] = payment->is_timeout;
+    pay->columns[PAY_ATTEMPTS][p] = payment->attempts;
+    pay->columns[PAY_TOTAL_FEE][p] = payment->route != NULL ? (int64_t)payment->route->total_fee : -1;
+
+    pay->columns[PAY_ROUTE_OFFSET][p] = r;
+    if(payment->route != NULL) {
+      for(j = 0; j < array_len(payment->route->route_hops); j++, r++) {
+        hop = array_get(payment->route->route_hops, j);
+        route_hops->columns[ROUTE_EDGE_ID][r] = hop->edge_id;
+      }
+    }
+    pay->columns[PAY_ROUTE_LEN][p] = r - pay->columns[PAY_ROUTE_OFFSET][p];
+
+    pay->columns[PAY_ATTEMPTS_OFFSET][p] = a;
+    for(iterator = payment->history; iterator != NULL; iterator = iterator->next, a++) {
+      attempt = iterator->data;
+      attempts->columns[ATT_PAYMENT_ID][a] = payment->id;
+      attempts->columns[ATT_ATTEMPTS][a] = attempt->attempts;
+      attempts->columns[ATT_IS_SUCCEEDED][a] = attempt->is_succeeded;
+      attempts->columns[ATT_END_TIME][a] = attempt->end_time;
+      attempts->columns[ATT_ERROR_EDGE][a] = attempt->error_edge_id;
+      attempts->columns[ATT_ERROR_TYPE][a] = attempt->error_type;
+      attempts->columns[ATT_HOPS_OFFSET][a] = h;
+      for(j = 0; j < array_len(attempt->route); j++, h++) {
+        edge_snapshot = array_get(attempt->route, j);
+        edge = array_get(network->edges, edge_snapshot->id);
+        channel = array_get(network->channels, edge->channel_id);
+        attempt_hops->columns[HOP_EDGE_ID][h] = edge_snapshot->id;
+        attempt_hops->columns[HOP_FROM_NODE_ID][h] = edge->from_node_id;
+        attempt_hops->columns[HOP_TO_NODE_ID][h] = edge->to_node_id;
+        attempt_hops->columns[HOP_SENT_AMT][h] = edge_snapshot->sent_amt;
+        attempt_hops->columns[HOP_EDGE_CAP][h] = edge_snapshot->balance;
+        attempt_hops->columns[HOP_CHANNEL_CAP][h] = channel->capacity;
+        attempt_hops->columns[HOP_GROUP_CAP][h] = edge_snapshot->is_in_group ? (int64_t)edge_snapshot->group_cap : -1;
+        attempt_hops->columns[HOP_CHANNEL_UPDATE][h] = edge_snapshot->does_channel_update_exist ? (int64_t)edge_snapshot->last_channle_update_value : -1;
+      }
+      attempts->columns[ATT_HOPS_LEN][a] = h - attempts->columns[ATT_HOPS_OFFSET][a];
+    }
+    pay->columns[PAY_ATTEMPTS_LEN][p] = a - pay->columns[PAY_ATTEMPTS_OFFSET][p];
+    p++;
+  }
+
+  strcpy(output_filename, output_dir_name);
+  strcat(output_filename, "payments_output.bin");
+  file = fopen(output_filename, "wb");
+  if(file == NULL) {
+    printf("ERROR cannot open payments_output.bin\n");
+    exit(-1);
+  }
+  write_tables(file, tables, N_TABLES);
+  fclose(file);
+
+  for(i = 0; i < N_TABLES; i++)
+    table_free(&(tables[i]));
+}
+
+/* remove the payments_output.bin of an earlier run, which scripts/analyze_output.py would read instead of the new csv */
+void remove_columnar_output(char output_dir_name[]) {
+  char output_filename[512];
+  strcpy(output_filename, output_dir_name);
+  strcat(output_filename, "payments_output.bin");
+  remove(output_filename);
+}
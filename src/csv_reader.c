@@ -0,0 +1,258 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../include/csv_reader.h"
+#include "../include/thread_pool.h"
+
+/* Functions in this file read the integer columns of a csv file in parallel (see csv_reader.h) */
+
+struct csv_chunk {
+  const char* begin;
+  const char* end;
+  long first_row;
+  long n_rows;
+  long first_line; // line number in the file of the first line of the chunk
+  long n_lines;
+  long error_line; // line number of the first wrong row of the chunk, 0 if there is none
+};
+
+struct csv_job_args {
+  struct csv_chunk* chunks;
+  long n_columns;
+  uint64_t* values;
+  long* lines;
+};
+
+static inline int is_blank_line(const char* p, const char* line_end) {
+  for(; p < line_end; p++)
+    if(*p != ' ' && *p != '\t' && *p != '\r')
+      return 0;
+  return 1;
+}
+
+/* parse the integer at `*p`, moving `*p` after it; it returns 0 if there is no integer */
+static inline int parse_integer(const char** p, const char* line_end, uint64_t* value) {
+  const char* c = *p;
+  uint64_t v = 0;
+  int is_negative = 0;
+
+  while(c < line_end && (*c == ' ' || *c == '\t'))
+    c++;
+  if(c < line_end && (*c == '-' || *c == '+')) {
+    is_negative = *c == '-';
+    c++;
+  }
+  if(c == line_end || *c < '0' || *c > '9')
+    return 0;
+  for(; c < line_end && *c >= '0' && *c <= '9'; c++)
+    v = v*10 + (uint64_t) (*c - '0');
+
+  *value = is_negative ? (uint64_t) 0 - v : v;
+  *p = c;
+  return 1;
+}
+
+static int parse_row(const char* p, const char* line_end, long n_columns, uint64_t* values) {
+  long j;
+
+  for(j = 0; j < n_columns; j++) {
+    if(j > 0) {
+      while(p < line_end && (*p == ' ' || *p == '\t'))
+        p++;
+      if(p == line_end || *p != ',')
+        return 0;
+      p++;
+    }
+    if(!parse_integer(&p, line_end, &values[j]))
+      return 0;
+  }
+  while(p < line_end && (*p == ' ' || *p == '\t' || *p == '\r'))
+    p++;
+  return p == line_end || *p == ',';
+}
+
+/* first pass: count the lines and the rows of a chunk, so that the rows of each chunk know their position in the table */
+static void count_rows_job(long job_index, long thread_index, void* arg) {
+  struct csv_job_args* args = arg;
+  struct csv_chunk* chunk = &(args->chunks[job_index]);
+  const char *p, *line_end;
+  (void) thread_index;
+
+  chunk->n_rows = chunk->n_lines = 0;
+  for(p = chunk->begin; p < chunk->end; p = line_end + 1) {
+    line_end = memchr(p, '\n', chunk->end - p);
+    if(line_end == NULL)
+      line_end = chunk->end;
+    chunk->n_lines++;
+    if(!is_blank_line(p, line_end))
+      chunk->n_rows++;
+  }
+}
+
+/* second pass: parse the rows of a chunk in their position of the table */
+static void parse_rows_job(long job_index, long thread_index, void* arg) {
+  struct csv_job_args* args = arg;
+  struct csv_chunk* chunk = &(args->chunks[job_index]);
+  const char *p, *line_end;
+  uint64_t* values;
+  long line, *lines;
+  (void) thread_index;
+
+  chunk->error_line = 0;
+  values = args->values + chunk->first_row*args->n_columns;
+  lines = args->lines + chunk->first_row;
+  line = chunk->first_line;
+  for(p = chunk->begin; p < chunk->end; p = line_end + 1, line++) {
+    line_end = memchr(p, '\n', chunk->end - p);
+    if(line_end == NULL)
+      line_end = chunk->end;
+    if(is_blank_line(p, line_end))
+      continue;
+    if(!parse_row(p, line_end, args->n_columns, values)) {
+      chunk->error_line = line;
+      return;
+    }
+    *lines++ = line;
+    values += args->n_columns;
+  }
+}
+
+static void run_chunk_jobs(struct thread_pool* pool, long n_chunks, thread_pool_job job, struct csv_job_args* args) {
+  long i;
+  if(pool != NULL)
+    thread_pool_run(pool, n_chunks, 1, job, args);
+  else
+    for(i = 0; i < n_chunks; i++)
+      job(i, 0, args);
+}
+
+struct csv_table* read_csv_file(char filename[], long n_columns, long n_threads) {
+  int file;
+  struct stat file_stat;
+  const char *data, *body, *end, *boundary;
+  size_t size;
+  long i, n_chunks, max_chunks, n_rows, n_lines;
+  struct csv_chunk* chunks;
+  struct csv_job_args args;
+  struct thread_pool* pool;
+  struct csv_table* table;
+
+  file = open(filename, O_RDONLY);
+  if(file < 0) {
+    fprintf(stderr, "ERROR: cannot open file <%s>\n", filename);
+    exit(-1);
+  }
+  if(fstat(file, &file_stat) != 0) {
+    fprintf(stderr, "ERROR: cannot stat file <%s>\n", filename);
+    exit(-1);
+  }
+  size = file_stat.st_size;
+
+  table = malloc(sizeof(struct csv_table));
+  table->n_rows = 0;
+  table->n_columns = n_columns;
+  table->values = NULL;
+  table->lines = NULL;
+  if(size == 0) {
+    close(file);
+    return table;
+  }
+
+  data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, file, 0);
+  close(file);
+  if(data == MAP_FAILED) {
+    fprintf(stderr, "ERROR: cannot map file <%s> in memory\n", filename);
+    exit(-1);
+  }
+  madvise((void*) data, size, MADV_SEQUENTIAL);
+
+  end = data + size;
+  body = memchr(data, '\n', size);
+  body = body != NULL ? body + 1 : end;
+
+  /* chunks of about the same size, each ending at the end of a line */
+  n_threads = n_threads > 0 ? n_threads : 1;
+  max_chunks = n_threads > 1 ? n_threads*CSV_CHUNKS_PER_THREAD : 1;
+  n_chunks = (end - body) / CSV_MIN_CHUNK_SIZE;
+  if(n_chunks > max_chunks)
+    n_chunks = max_chunks;
+  if(n_chunks < 1)
+    n_chunks = 1;
+  chunks = malloc(sizeof(struct csv_chunk)*n_chunks);
+  for(i = 0; i < n_chunks; i++) {
+    chunks[i].begin = i == 0 ? body : chunks[i-1].end;
+    boundary = body + (end - body) / n_chunks * (i + 1);
+    if(i == n_chunks - 1 || boundary <= chunks[i].begin)
+      boundary = i == n_chunks - 1 ? end : chunks[i].begin;
+    else {
+      boundary = memchr(boundary - 1, '\n', end - (boundary - 1));
+      boundary = boundary != NULL ? boundary + 1 : end;
+    }
+    chunks[i].end = boundary;
+  }
+
+  args.chunks = chunks;
+  args.n_columns = n_columns;
+  args.values = NULL;
+  args.lines = NULL;
+  pool = n_chunks > 1 ? thread_pool_initialize(n_threads < n_chunks ? n_threads : n_chunks) : NULL;
+
+  run_chunk_jobs(pool, n_chunks, count_rows_job, &args);
+  n_rows = 0;
+  n_lines = 2; // the header is the line 1
+  for(i = 0; i < n_chunks; i++) {
+    chunks[i].first_row = n_rows;
+    chunks[i].first_line = n_lines;
+    n_rows += chunks[i].n_rows;
+    n_lines += chunks[i].n_lines;
+  }
+
+  table->n_rows = n_rows;
+  table->values = malloc(sizeof(uint64_t)*(n_rows*n_columns > 0 ? n_rows*n_columns : 1));
+  table->lines = malloc(sizeof(long)*(n_rows > 0 ? n_rows : 1));
+  args.values = table->values;
+  args.lines = table->lines;
+  run_chunk_jobs(pool, n_chunks, parse_rows_job, &args);
+
+  /* the threads are joined here: the parameter sweep forks after the input is read */
+  thread_pool_free(pool);
+  munmap((void*) data, size);
+
+  for(i = 0; i < n_chunks; i++) {
+    if(chunks[i].error_line != 0) {
+      fprintf(stderr, "ERROR: wrong row at line %ld of file <%s>, %ld integer columns expected\n", chunks[i].error_line, filename, n_columns);
+      exit(-1);
+    }
+  }
+  free(chunks);
+
+  return table;
+}
+
+/* the index of the row with id i (first column) is the element i of the returned array; the ids must be 0, ..., n_rows-1 */
+long* csv_rows_in_id_order(struct csv_table* table, char filename[]) {
+  long i, id, *rows;
+
+  rows = malloc(sizeof(long)*(table->n_rows > 0 ? table->n_rows : 1));
+  for(i = 0; i < table->n_rows; i++)
+    rows[i] = -1;
+  for(i = 0; i < table->n_rows; i++) {
+    id = csv_get_long(table, i, 0);
+    if(id < 0 || id >= table->n_rows || rows[id] != -1) {
+      fprintf(stderr, "ERROR: wrong id <%ld> in file <%s>, the ids must go from 0 to the number of rows minus one\n", id, filename);
+      exit(-1);
+    }
+    rows[id] = i;
+  }
+  return rows;
+}
+
+void free_csv_table(struct csv_table* table) {
+  free(table->values);
+  free(table->lines);
+  free(table);
+}
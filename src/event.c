@@ -4,19 +4,68 @@
 #include <time.h>
 #include "../include/event.h"
 #include "../include/array.h"
+#include "../include/output.h"
 #include <inttypes.h>
 
-FILE* csv_group_events = NULL;
+struct output_file* csv_group_events = NULL;
+
+#define EVENT_SLAB_SIZE 4096
+
+/* events are allocated in slabs and recycled through a free list linked by `next`:
+   the event popped by the simulation loop is released right after its execution (see `free_event`)
+   and it is the first one handed out for the next hop, so the loop does not call malloc/free in steady state */
+static struct event* event_free_list = NULL;
+static struct array* event_slabs = NULL;
+
+static void event_pool_grow(void) {
+  struct event* slab;
+  long i;
+  slab = (struct event*)malloc(sizeof(struct event)*EVENT_SLAB_SIZE);
+  if(slab == NULL) {
+    fprintf(stderr, "ERROR: malloc failed for event slab\n");
+    exit(-1);
+  }
+  for(i = EVENT_SLAB_SIZE-1; i >= 0; i--) {
+    slab[i].next = event_free_list;
+    event_free_list = &(slab[i]);
+  }
+  if(event_slabs == NULL)
+    event_slabs = array_initialize(16);
+  event_slabs = array_insert(event_slabs, slab);
+}
 
 struct event* new_event(uint64_t time, enum event_type type, long node_id, struct payment* payment) {
-  struct event* e = (struct event*)malloc(sizeof(struct event));
+  struct event* e;
+  if(event_free_list == NULL)
+    event_pool_grow();
+  e = event_free_list;
+  event_free_list = e->next;
   e->time = time;
   e->type = type;
   e->node_id = node_id;
   e->payment = payment;
+  e->hop_index = -1;
+  e->next = NULL;
   return e;
 }
 
+/* give an event back to the pool; it must not be in a scheduler */
+void free_event(struct event* e) {
+  e->next = event_free_list;
+  event_free_list = e;
+}
+
+/* release all the events, including the ones still in use */
+void free_event_pool(void) {
+  long i;
+  if(event_slabs == NULL) return;
+  for(i = 0; i < array_len(event_slabs); i++)
+    free(array_get(event_slabs, i));
+  array_free(event_slabs);
+  event_slabs = NULL;
+  event_free_list = NULL;
+}
+
 int compare_event(struct event *e1, struct event *e2) {
   uint64_t time1 = e1->time, time2 = e2->time;
   if (time1 == time2) return 0;
@@ -24,12 +73,12 @@ int compare_event(struct event *e1, struct event *e2) {
 }
 
 /* initialize events by creating an event for each payment for which a route has to be found */
-struct heap* initialize_events(struct array* payments){
-  struct heap* events = heap_initialize(array_len(payments)*10);
+struct scheduler* initialize_events(struct array* payments, enum scheduler_type scheduler_type){
+  struct scheduler* events = scheduler_initialize(scheduler_type, array_len(payments)*10);
   for(long i = 0; i < array_len(payments); i++){
     struct payment* payment = array_get(payments, i);
     struct event* event = new_event(payment->start_time, FINDPATH, payment->sender, payment);
-    events = heap_insert(events, event, compare_event);
+    scheduler_insert(events, event);
   }
   return events;
 }
@@ -52,18 +101,16 @@ void group_events_open(const char* dirpath) {
     else
         snprintf(path, sizeof(path), "group_events.csv");
 
-    csv_group_events = fopen(path, "w");
+    csv_group_events = output_open(path, output_writer);
     if (csv_group_events) {
-        fprintf(csv_group_events,
+        output_printf(csv_group_events,
             "type,time,group_id,edge_id,role,seed_id,attempt_id,reason,size,needed,members,group_cap,min,max,C15\n");
-        fflush(csv_group_events);
     }
 }
 
 void group_events_close(void) {
     if (csv_group_events) {
-        fflush(csv_group_events);
-        fclose(csv_group_events);
+        output_close(csv_group_events);
         csv_group_events = NULL;
     }
 }
@@ -71,14 +118,14 @@ void group_events_close(void) {
 void ge_construct_begin(uint64_t time, long seed_edge_id, uint64_t attempt_id) {
     if (!csv_group_events) return;
     /* construct_begin,time,-,-,seed,seed_id,attempt_id,-,-,-,-,-,-,-,- */
-    fprintf(csv_group_events,
+    output_printf(csv_group_events,
         "construct_begin,%" PRIu64 ",-,-,seed,%ld,%" PRIu64 ",-,-,-,-,-,-,-,-\n",
         (uint64_t)time, seed_edge_id, (uint64_t)attempt_id);
 }
 
 void ge_construct_abort(uint64_t time, long seed_edge_id, int size, int needed, uint64_t attempt_id) {
     if (!csv_group_events) return;
-    fprintf(csv_group_events,
+    output_printf(csv_group_events,
         "construct_abort,%" PRIu64 ",-,-,seed,%ld,%" PRIu64 ",shortage,%d,%d,-,-,-,-,-\n",
         (uint64_t)time, seed_edge_id, (uint64_t)attempt_id, size, needed);
 }
@@ -88,7 +135,7 @@ void ge_construct_commit(uint64_t time, long group_id,
                          uint64_t group_cap, uint64_t min_cap, uint64_t max_cap,
                          long seed_edge_id, uint64_t attempt_id) {
     if (!csv_group_events) return;
-    fprintf(csv_group_events,
+    output_printf(csv_group_events,
         "construct_commit,%" PRIu64 ",%ld,-,group,%ld,%" PRIu64 ",commit,-,-,%s,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",-\n",
         (uint64_t)time, group_id,
         seed_edge_id, (uint64_t)attempt_id,
@@ -101,7 +148,7 @@ void ge_join(uint64_t time, long group_id, long edge_id,
              uint64_t min_cap, uint64_t max_cap,
              long seed_edge_id, uint64_t attempt_id) {
     if (!csv_group_events) return;
-    fprintf(csv_group_events,
+    output_printf(csv_group_events,
         "join,%" PRIu64 ",%ld,%ld,join,%ld,%" PRIu64 ",%s,-,-,-,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",-\n",
         (uint64_t)time, group_id, edge_id,
         seed_edge_id, (uint64_t)attempt_id, dash_if_empty(reason),
@@ -113,7 +160,7 @@ void ge_leave(uint64_t time, long group_id, long edge_id,
               uint64_t min_cap, uint64_t max_cap,
               long seed_edge_id, uint64_t attempt_id) {
     if (!csv_group_events) return;
-    fprintf(csv_group_events,
+    output_printf(csv_group_events,
         "leave,%" PRIu64 ",%ld,%ld,leave,%ld,%" PRIu64 ",%s,-,-,-,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",-\n",
         (uint64_t)time, group_id, edge_id,
         seed_edge_id, (uint64_t)attempt_id, dash_if_empty(reason),
@@ -127,7 +174,7 @@ void ge_update_group(uint64_t time, long group_id,
     if (!csv_group_events) return;
     char gidbuf[32];
     const char* gid = gid_or_dash(group_id, gidbuf, sizeof(gidbuf));
-    fprintf(csv_group_events,
+    output_printf(csv_group_events,
         "update_group,%" PRIu64 ",%s,-,group,%ld,%" PRIu64 ",%s,-,-,-,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",-\n",
         (uint64_t)time, gid, seed_edge_id, (uint64_t)attempt_id,
         dash_if_empty(reason),
@@ -138,7 +185,7 @@ void ge_close(uint64_t time, long group_id, const char* reason,
               const char* members_dash_joined,
               long seed_edge_id, uint64_t attempt_id) {
     if (!csv_group_events) return;
-    fprintf(csv_group_events,
+    output_printf(csv_group_events,
         "close,%" PRIu64 ",%ld,-,group,%ld,%" PRIu64 ",%s,-,-,%s,-,-,-,-\n",
         (uint64_t)time, group_id,
         seed_edge_id, (uint64_t)attempt_id, dash_if_empty(reason),
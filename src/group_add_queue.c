@@ -0,0 +1,217 @@
+#include <stdlib.h>
+#include "../include/group_add_queue.h"
+
+/* Functions in this file implement the queue of the edges waiting to join a group (see `struct group_add_queue`) */
+
+struct group_add_queue* group_add_queue_initialize() {
+  struct group_add_queue* queue;
+  int i;
+
+  queue = malloc(sizeof(struct group_add_queue));
+  queue->len = 0;
+  queue->head = queue->tail = NULL;
+  queue->next_position = 0;
+  queue->level = 1;
+  queue->index = malloc(sizeof(struct group_add_queue_item) + sizeof(struct group_add_queue_item*)*GROUP_ADD_QUEUE_MAX_LEVEL);
+  queue->index->edge = NULL;
+  queue->index->level = GROUP_ADD_QUEUE_MAX_LEVEL;
+  for(i = 0; i < GROUP_ADD_QUEUE_MAX_LEVEL; i++)
+    queue->index->forward[i] = NULL;
+  queue->random_state = 0x9E3779B97F4A7C15ULL;
+  return queue;
+}
+
+/* whether `item` comes before the key (balance, edge_id) in the balance index */
+static inline int is_before(struct group_add_queue_item* item, uint64_t balance, long edge_id) {
+  return item->balance < balance || (item->balance == balance && item->edge->id < edge_id);
+}
+
+/* level of a new item of the skip list: one more level with probability 1/4 (xorshift64 generator) */
+static int random_level(struct group_add_queue* queue) {
+  uint64_t x = queue->random_state;
+  int level = 1;
+
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  queue->random_state = x;
+  while(level < GROUP_ADD_QUEUE_MAX_LEVEL && (x & 3) == 0) {
+    level++;
+    x >>= 2;
+  }
+  return level;
+}
+
+static void index_insert(struct group_add_queue* queue, struct group_add_queue_item* item) {
+  struct group_add_queue_item* update[GROUP_ADD_QUEUE_MAX_LEVEL], *x;
+  int i;
+
+  x = queue->index;
+  for(i = queue->level - 1; i >= 0; i--) {
+    while(x->forward[i] != NULL && is_before(x->forward[i], item->balance, item->edge->id))
+      x = x->forward[i];
+    update[i] = x;
+  }
+  for(i = queue->level; i < item->level; i++)
+    update[i] = queue->index;
+  if(item->level > queue->level)
+    queue->level = item->level;
+
+  for(i = 0; i < item->level; i++) {
+    item->forward[i] = update[i]->forward[i];
+    update[i]->forward[i] = item;
+  }
+}
+
+static void index_delete(struct group_add_queue* queue, struct group_add_queue_item* item) {
+  struct group_add_queue_item* x;
+  int i;
+
+  /* the keys are unique: at the levels of the item, the item follows the last item before its key */
+  x = queue->index;
+  for(i = queue->level - 1; i >= 0; i--) {
+    while(x->forward[i] != NULL && is_before(x->forward[i], item->balance, item->edge->id))
+      x = x->forward[i];
+    if(i < item->level)
+      x->forward[i] = item->forward[i];
+  }
+  while(queue->level > 1 && queue->index->forward[queue->level - 1] == NULL)
+    queue->level--;
+}
+
+/* enqueue an edge at the tail, if it is not already in the queue */
+void group_add_queue_push(struct group_add_queue* queue, struct edge* edge) {
+  struct group_add_queue_item* item;
+  int level;
+
+  if(edge == NULL || edge_cold(edge)->in_group_add_queue) return;
+  edge_cold(edge)->in_group_add_queue = 1;
+
+  level = random_level(queue);
+  item = malloc(sizeof(struct group_add_queue_item) + sizeof(struct group_add_queue_item*)*level);
+  item->edge = edge;
+  item->position = queue->next_position++;
+  item->balance = edge_get_balance(edge);
+  item->level = level;
+
+  item->prev = queue->tail;
+  item->next = NULL;
+  if(queue->tail != NULL)
+    queue->tail->next = item;
+  else
+    queue->head = item;
+  queue->tail = item;
+  queue->len++;
+
+  index_insert(queue, item);
+}
+
+static int compare_edges_by_balance(const void* a, const void* b) {
+  struct edge* edge_a = *(struct edge**) a;
+  struct edge* edge_b = *(struct edge**) b;
+  uint64_t balance_a = edge_get_balance(edge_a), balance_b = edge_get_balance(edge_b);
+  if(balance_a != balance_b)
+    return balance_a < balance_b ? -1 : 1;
+  /* among equal balances the last edge first, the order of the sorted insertion of the edges in id order */
+  return edge_a->id < edge_b->id ? 1 : (edge_a->id > edge_b->id ? -1 : 0);
+}
+
+/* enqueue the edges of the array which are not in the queue, in increasing balance */
+void group_add_queue_push_by_balance(struct group_add_queue* queue, struct array* edges) {
+  struct edge** sorted_edges, *edge;
+  long i, n;
+
+  sorted_edges = malloc(sizeof(struct edge*)*(array_len(edges) > 0 ? array_len(edges) : 1));
+  n = 0;
+  for(i = 0; i < array_len(edges); i++) {
+    edge = array_get(edges, i);
+    if(edge != NULL && !edge_cold(edge)->in_group_add_queue)
+      sorted_edges[n++] = edge;
+  }
+  qsort(sorted_edges, n, sizeof(struct edge*), compare_edges_by_balance);
+  for(i = 0; i < n; i++)
+    group_add_queue_push(queue, sorted_edges[i]);
+  free(sorted_edges);
+}
+
+/* dequeue an item, wherever it is in the queue */
+void group_add_queue_remove(struct group_add_queue* queue, struct group_add_queue_item* item) {
+  if(item->prev != NULL)
+    item->prev->next = item->next;
+  else
+    queue->head = item->next;
+  if(item->next != NULL)
+    item->next->prev = item->prev;
+  else
+    queue->tail = item->prev;
+  queue->len--;
+
+  index_delete(queue, item);
+  edge_cold(item->edge)->in_group_add_queue = 0;
+  free(item);
+}
+
+/* move the head to the tail (the edge stays in the queue) */
+void group_add_queue_rotate(struct group_add_queue* queue) {
+  struct group_add_queue_item* item;
+
+  if(queue->len < 2) return;
+  item = queue->head;
+  queue->head = item->next;
+  queue->head->prev = NULL;
+
+  item->prev = queue->tail;
+  item->next = NULL;
+  queue->tail->next = item;
+  queue->tail = item;
+  item->position = queue->next_position++;
+}
+
+/* update the keys of the edges whose balance changed since they were indexed */
+void group_add_queue_refresh(struct group_add_queue* queue) {
+  struct group_add_queue_item* item;
+  uint64_t balance;
+
+  for(item = queue->head; item != NULL; item = item->next) {
+    balance = edge_get_balance(item->edge);
+    if(balance == item->balance) continue;
+    index_delete(queue, item);
+    item->balance = balance;
+    index_insert(queue, item);
+  }
+}
+
+static int compare_items_by_position(const void* a, const void* b) {
+  struct group_add_queue_item* item_a = *(struct group_add_queue_item**) a;
+  struct group_add_queue_item* item_b = *(struct group_add_queue_item**) b;
+  return item_a->position < item_b->position ? -1 : (item_a->position > item_b->position ? 1 : 0);
+}
+
+/* the items with balance in [min_balance, max_balance], in FIFO order; `items` is emptied and reused */
+struct array* group_add_queue_range(struct group_add_queue* queue, uint64_t min_balance, uint64_t max_balance, struct array* items) {
+  struct group_add_queue_item* x;
+  int i;
+
+  array_delete_all(items);
+  if(min_balance > max_balance) return items;
+
+  x = queue->index;
+  for(i = queue->level - 1; i >= 0; i--)
+    while(x->forward[i] != NULL && x->forward[i]->balance < min_balance)
+      x = x->forward[i];
+  for(x = x->forward[0]; x != NULL && x->balance <= max_balance; x = x->forward[0])
+    items = array_insert(items, x);
+
+  qsort(items->element, array_len(items), sizeof(void*), compare_items_by_position);
+  return items;
+}
+
+void group_add_queue_free(struct group_add_queue* queue) {
+  struct group_add_queue_item* item, *next;
+  for(item = queue->head; item != NULL; item = next) {
+    next = item->next;
+    free(item);
+  }
+  free(queue->index);
+  free(queue);
+}
@@ -141,10 +141,94 @@ void* heap_pop(struct heap* h, int(*compare)()) {
   return min;
 }
 
+/* INDEXED HEAP */
+/* same sift-up/sift-down steps as above, but the position of each element is kept updated through `get_heap_index` */
+
+void swap_indexed(struct heap* h, long i, long j, long*(*get_heap_index)()) {
+  swap(&(h->data[i]), &(h->data[j]));
+  *(get_heap_index(h->data[i])) = i;
+  *(get_heap_index(h->data[j])) = j;
+}
+
+void heapify_indexed(struct heap* h, long i, int(*compare)(), long*(*get_heap_index)()) {
+  long left_child, right_child, smallest;
+  int comp_res;
+
+  while(1) {
+    smallest=i;
+    left_child = get_left_child(smallest);
+    right_child = get_right_child(smallest);
+
+    comp_res = left_child < h->index ? (*compare)(h->data[smallest], h->data[left_child]) : -1;
+    if(comp_res>=0)
+      smallest=left_child;
+
+    comp_res = right_child < h->index ? (*compare)(h->data[smallest], h->data[right_child]) : -1;
+    if(comp_res>=0)
+      smallest =right_child;
+
+    if(smallest==i) break;
+    swap_indexed(h, i, smallest, get_heap_index);
+    i=smallest;
+  }
+}
+
+struct heap* heap_insert_or_update_indexed(struct heap *h, void* data, int(*compare)(), long*(*get_heap_index)()) {
+  long i, parent, *heap_index;
+  int comp_res;
+
+  heap_index = get_heap_index(data);
+  if(*heap_index >= 0 && *heap_index < h->index && h->data[*heap_index] == data) {
+    i = *heap_index;
+  }
+  else {
+    if(h->index>=h->size) {
+      h = resize_heap(h);
+    }
+    i=h->index;
+    (h->index)++;
+    h->data[i]=data;
+    *heap_index = i;
+  }
+
+  parent = get_parent(i);
+  while(i>0) {
+    comp_res=(*compare)(h->data[i], h->data[parent]);
+    if(comp_res>0) break;
+    swap_indexed(h, i, parent, get_heap_index);
+    i=parent;
+    parent=get_parent(i);
+  }
+
+  return h;
+}
+
+void* heap_pop_indexed(struct heap* h, int(*compare)(), long*(*get_heap_index)()) {
+  void* min;
+
+  if(h->index==0) return NULL;
+
+  min = h->data[0];
+  *(get_heap_index(min)) = -1;
+  (h->index)--;
+  if(h->index > 0) {
+    h->data[0]=h->data[h->index];
+    *(get_heap_index(h->data[0])) = 0;
+    heapify_indexed(h, 0, compare, get_heap_index);
+  }
+
+  return min;
+}
+
 long heap_len(struct heap*h){
   return h->index;
 }
 
+/* remove all the elements without popping them one by one */
+void heap_clear(struct heap* h){
+  h->index = 0;
+}
+
 void heap_free(struct heap *h) {
   free(h->data);
   free(h);
@@ -20,10 +20,13 @@
 #include "../include/network.h"
 #include "../include/event.h"
 #include "../include/utils.h"
+#include "../include/speculation.h"
 
 /* Functions in this file simulate the HTLC mechanism for exchanging payments, as implemented in the Lightning Network.
    They are a (high-level) copy of functions in lnd-v0.9.1-beta (see files `routing/missioncontrol.go`, `htlcswitch/switch.go`, `htlcswitch/link.go`) */
 
+uint64_t group_attempt_counter = 0;
+
 
 /* AUXILIARY FUNCTIONS */
 
@@ -38,7 +41,7 @@ uint64_t compute_fee(uint64_t amount_to_forward, struct policy policy) {
 unsigned int check_balance_and_policy(struct edge* edge, struct edge* prev_edge, struct route_hop* prev_hop, struct route_hop* next_hop) {
   uint64_t expected_fee;
 
-  if(next_hop->amount_to_forward > edge->balance)
+  if(next_hop->amount_to_forward > edge_get_balance(edge))
     return 0;
 
   if(next_hop->amount_to_forward < edge->policy.min_htlc){
@@ -83,16 +86,32 @@ struct route_hop *get_route_hop(long node_id, struct array *route_hops, int is_s
   return array_get(route_hops, index);
 }
 
+/* retrieve the hop at position `index` of the route of the payment of an HTLC event in O(1) (see `hop_index` in `struct event`);
+   with DEBUG_VALIDATION it is checked against the hop found by scanning the route */
+static struct route_hop* get_event_route_hop(struct event* event, long index, int is_sender) {
+  struct route_hop* route_hop;
+  route_hop = array_get(event->payment->route->route_hops, index);
+#ifdef DEBUG_VALIDATION
+  if(route_hop != get_route_hop(event->node_id, event->payment->route->route_hops, is_sender)) {
+    printf("ERROR (get_event_route_hop): hop %ld of payment %ld is not the %s hop of node %ld \n", index, event->payment->id, is_sender ? "next" : "previous", event->node_id);
+    exit(-1);
+  }
+#else
+  (void)is_sender;
+#endif
+  return route_hop;
+}
+
 /* === helper: count usage when this edge is the group's min-cap === */
 static inline void record_min_cap_use(struct payment* p, struct edge* e) {
     if (!p || !e) return;
-    if (e->group == NULL) return;
+    if (edge_get_group(e) == NULL) return;
 
-    struct group* g = e->group;
+    struct group* g = edge_get_group(e);
     if (g == NULL) return;
 
     /* forward時点で “公開min (= group_cap)” と一致していた */
-    if (e->balance == g->group_cap) {
+    if (edge_get_balance(e) == g->group_cap) {
         if (p->min_cap_used_edges == NULL) {
             p->min_cap_used_edges = array_initialize(4);
         }
@@ -106,7 +125,7 @@ static inline void commit_min_cap_use_on_success(struct payment* p) {
     for (long i = 0; i < array_len(p->min_cap_used_edges); i++) {
         struct edge* e = (struct edge*)array_get(p->min_cap_used_edges, i);
         if (e) {
-            e->min_cap_use_count += 1;
+            edge_cold(e)->min_cap_use_count += 1;
         }
     }
     array_free(p->min_cap_used_edges);
@@ -136,47 +155,41 @@ static inline void discard_min_cap_used_edges(struct payment* p)
 
 /* set the result of a node pair as success: it means that a payment was successfully forwarded in an edge connecting the two nodes of the node pair.
  This information is used by the sender node to find a route that maximizes the possibilities of successfully sending a payment */
-void set_node_pair_result_success(struct element** results, long from_node_id, long to_node_id, uint64_t success_amount, uint64_t success_time){
+void set_node_pair_result_success(struct node* sender, long from_node_id, long to_node_id, uint64_t success_amount, uint64_t success_time){
   struct node_pair_result* result;
 
-  result = get_by_key(results[from_node_id], to_node_id, is_equal_key_result);
+  if(sender->mission_control == NULL)
+    sender->mission_control = mission_control_initialize(64);
 
-  if(result == NULL){
-    result = malloc(sizeof(struct node_pair_result));
-    result->to_node_id = to_node_id;
-    result->fail_time = 0;
-    result->fail_amount = 0;
-    result->success_time = 0;
-    result->success_amount = 0;
-    results[from_node_id] = push(results[from_node_id], result);
-  }
+  result = mission_control_get(sender->mission_control, from_node_id, to_node_id);
+
+  if(result == NULL)
+    result = mission_control_add(sender->mission_control, from_node_id, to_node_id);
 
   result->success_time = success_time;
   if(success_amount > result->success_amount)
     result->success_amount = success_amount;
   if(result->fail_time != 0 && result->success_amount > result->fail_amount)
     result->fail_amount = success_amount + 1;
+  network_version++;
 }
 
 /* set the result of a node pair as success: it means that a payment failed when passing through  an edge connecting the two nodes of the node pair.
    This information is used by the sender node to find a route that maximimizes the possibilities of successfully sending a payment */
-void set_node_pair_result_fail(struct element** results, long from_node_id, long to_node_id, uint64_t fail_amount, uint64_t fail_time){
+void set_node_pair_result_fail(struct node* sender, long from_node_id, long to_node_id, uint64_t fail_amount, uint64_t fail_time){
   struct node_pair_result* result;
 
-  result = get_by_key(results[from_node_id], to_node_id, is_equal_key_result);
+  if(sender->mission_control == NULL)
+    sender->mission_control = mission_control_initialize(64);
+
+  result = mission_control_get(sender->mission_control, from_node_id, to_node_id);
 
   if(result != NULL)
     if(fail_amount > result->fail_amount && fail_time - result->fail_time < 60000)
       return;
 
-  if(result == NULL){
-    result = malloc(sizeof(struct node_pair_result));
-    result->to_node_id = to_node_id;
-    result->fail_time = 0;
-    result->fail_amount = 0;
-    result->success_time = 0;
-    results[from_node_id] = push(results[from_node_id], result);
-  }
+  if(result == NULL)
+    result = mission_control_add(sender->mission_control, from_node_id, to_node_id);
 
   result->fail_amount = fail_amount;
   result->fail_time = fail_time;
@@ -184,6 +197,7 @@ void set_node_pair_result_fail(struct element** results, long from_node_id, long
     result->success_amount = 0;
   else if(fail_amount != 0 && fail_amount <= result->success_amount)
     result->success_amount = fail_amount - 1;
+  network_version++;
 }
 
 /* process a payment which succeeded */
@@ -194,7 +208,7 @@ void process_success_result(struct node* node, struct payment *payment, uint64_t
   route_hops = payment->route->route_hops;
   for(i=0; i<array_len(route_hops); i++){
     hop = array_get(route_hops, i);
-    set_node_pair_result_success(node->results, hop->from_node_id, hop->to_node_id, hop->amount_to_forward, current_time);
+    set_node_pair_result_success(node, hop->from_node_id, hop->to_node_id, hop->amount_to_forward, current_time);
   }
 }
 
@@ -210,18 +224,18 @@ void process_fail_result(struct node* node, struct payment *payment, uint64_t cu
     return;
 
   if(payment->error.type == OFFLINENODE) {
-    set_node_pair_result_fail(node->results, error_hop->from_node_id, error_hop->to_node_id, 0, current_time);
-    set_node_pair_result_fail(node->results, error_hop->to_node_id, error_hop->from_node_id, 0, current_time);
+    set_node_pair_result_fail(node, error_hop->from_node_id, error_hop->to_node_id, 0, current_time);
+    set_node_pair_result_fail(node, error_hop->to_node_id, error_hop->from_node_id, 0, current_time);
   }
   else if(payment->error.type == NOBALANCE) {
     route_hops = payment->route->route_hops;
     for(i=0; i<array_len(route_hops); i++){
       hop = array_get(route_hops, i);
       if(hop->edge_id == error_hop->edge_id) {
-        set_node_pair_result_fail(node->results, hop->from_node_id, hop->to_node_id, hop->amount_to_forward, current_time);
+        set_node_pair_result_fail(node, hop->from_node_id, hop->to_node_id, hop->amount_to_forward, current_time);
         break;
       }
-      set_node_pair_result_success(node->results, hop->from_node_id, hop->to_node_id, hop->amount_to_forward, current_time);
+      set_node_pair_result_success(node, hop->from_node_id, hop->to_node_id, hop->amount_to_forward, current_time);
     }
   }
 }
@@ -240,7 +254,7 @@ void generate_send_payment_event(struct payment* payment, struct array* path, st
   // execute send_payment event immediately
   next_event_time = simulation->current_time;
   send_payment_event = new_event(next_event_time, SENDPAYMENT, payment->sender, payment );
-  simulation->events = heap_insert(simulation->events, send_payment_event, compare_event);
+  scheduler_insert(simulation->events, send_payment_event);
 }
 
 
@@ -254,6 +268,69 @@ struct payment* create_payment_shard(long shard_id, uint64_t shard_amount, struc
 
 /*HTLC FUNCTIONS*/
 
+/* find the path of the attempt number `attempt` of a payment, using the dijkstra data structures of slot `p`;
+   except in the cloth method, the edges where the previous attempts failed are excluded */
+struct array* find_payment_path(struct payment* payment, int attempt, struct network* network, uint64_t current_time, long p, enum routing_method routing_method) {
+  struct element *exclude_edges, *iterator;
+  struct attempt* a;
+  struct array* path;
+  enum pathfind_error error;
+  int use_cache;
+
+  exclude_edges = NULL;
+  if(attempt > 1 && routing_method != CLOTH_ORIGINAL) {
+    for(iterator = payment->history; iterator != NULL; iterator = iterator->next) {
+      a = iterator->data;
+      exclude_edges = push(exclude_edges, array_get(network->edges, a->error_edge_id));
+    }
+  }
+
+  /* the route cache is used only by the simulation thread and for searches without excluded edges */
+  use_cache = route_cache != NULL && p == 0 && exclude_edges == NULL && (routing_method == GROUP_ROUTING || routing_method == CHANNEL_UPDATE);
+  if(use_cache) {
+    path = route_cache_get(route_cache, payment->sender, payment->receiver, payment->amount, payment->max_fee_limit, network, routing_method);
+    if(path != NULL)
+      return path;
+  }
+
+  path = dijkstra(payment->sender, payment->receiver, payment->amount, network, current_time, p, &error, routing_method, exclude_edges, payment->max_fee_limit);
+  list_free(exclude_edges);
+  if(use_cache && path != NULL)
+    route_cache_put(route_cache, payment->sender, payment->receiver, payment->amount, path, network);
+  return path;
+}
+
+/* check whether a path found earlier can still carry the payment and its fees: the capacity of the first edge is known by the sender,
+   the capacity of the others is estimated according to the routing method */
+int has_path_enough_capacity(struct array* path, struct payment* payment, struct network* network, uint64_t current_time, enum routing_method routing_method) {
+  struct path_hop* hop;
+  struct edge* edge;
+  struct route* route;
+  uint64_t path_cap, estimated_cap, fee;
+  long i;
+
+  // calc path capacity
+  path_cap = INT64_MAX;
+  for (i = 0; i < array_len(path); i++) {
+      hop = array_get(path, i);
+      edge = array_get(network->edges, hop->edge);
+      if (i == 0) {
+          // if first edge of the path (directory connected edge to source node)
+          estimated_cap = edge_get_balance(edge);
+      } else {
+          estimated_cap = estimate_capacity(edge, network, routing_method);
+      }
+      if (estimated_cap < path_cap) path_cap = estimated_cap;
+  }
+
+  // calc total fee
+  route = transform_path_into_route(path, payment->amount, network, current_time);
+  fee = route->total_fee;
+  free_route(route);
+
+  return path_cap >= payment->amount + fee;
+}
+
 /* find a path for a payment (a modified version of dijkstra is used: see `routing.c`) */
 void find_path(struct event *event, struct simulation* simulation, struct network* network, struct array** payments, unsigned int mpp, enum routing_method routing_method, struct network_params net_params) {
   struct payment *payment, *shard1, *shard2;
@@ -270,61 +347,30 @@ void find_path(struct event *event, struct simulation* simulation, struct networ
     payment->end_time = simulation->current_time;
     payment->is_timeout = 1;
 
+    discard_speculated_path(payment);
     discard_min_cap_used_edges(payment);
     return;
   }
 
   // find path
-  if(routing_method == CLOTH_ORIGINAL) {
-      if (payment->attempts == 1) {
+  if(speculation != NULL) {
+      path = get_speculated_path(payment, *payments, network, simulation->current_time, routing_method);
+  } else if(routing_method == CLOTH_ORIGINAL) {
+      if (payment->attempts == 1 && payment->id < n_paths) {
           path = paths[payment->id];
       }else {
-          path = dijkstra(payment->sender, payment->receiver, payment->amount, network, simulation->current_time, 0, &error, net_params.routing_method, NULL, payment->max_fee_limit);
+          path = find_payment_path(payment, payment->attempts, network, simulation->current_time, 0, routing_method);
       }
   } else {
 
       if (payment->attempts == 1) {
-          path = paths[payment->id];
-          if (path != NULL) {
-
-              // calc path capacity
-              uint64_t path_cap = INT64_MAX;
-              for (int i = 0; i < array_len(path); i++) {
-                  struct route_hop *hop = array_get(path, i);
-                  struct edge *edge = array_get(network->edges, hop->edge_id);
-                  uint64_t estimated_cap;
-                  if (i == 0) {
-                      // if first edge of the path (directory connected edge to source node)
-                      estimated_cap = edge->balance;
-                  } else {
-                      estimated_cap = estimate_capacity(edge, network, routing_method);
-                  }
-                  if (estimated_cap < path_cap) path_cap = estimated_cap;
-              }
-
-              // calc total fee
-              struct route *route = transform_path_into_route(path, payment->amount, network, simulation->current_time);
-              uint64_t fee = route->total_fee;
-              free_route(route);
-
-              // if path capacity is not enough to send the payment, find new path
-              if (path_cap < payment->amount + fee) {
-                  path = dijkstra(payment->sender, payment->receiver, payment->amount, network, simulation->current_time, 0, &error, net_params.routing_method, NULL, payment->max_fee_limit);
-              }
-          } else {
-              path = dijkstra(payment->sender, payment->receiver, payment->amount, network, simulation->current_time, 0, &error, net_params.routing_method, NULL, payment->max_fee_limit);
+          path = payment->id < n_paths ? paths[payment->id] : NULL; // payments generated during the simulation have no initial path
+          // if path capacity is not enough to send the payment, find new path
+          if (path == NULL || !has_path_enough_capacity(path, payment, network, simulation->current_time, routing_method)) {
+              path = find_payment_path(payment, payment->attempts, network, simulation->current_time, 0, routing_method);
           }
       } else {
-
-          // exclude edges
-          struct element* exclude_edges = NULL;
-          for(struct element* iterator = payment->history; iterator != NULL; iterator = iterator->next) {
-            struct attempt* a = iterator->data;
-            struct edge* exclude_edge = array_get(network->edges, a->error_edge_id);
-            exclude_edges = push(exclude_edges, exclude_edge);
-          }
-
-          path = dijkstra(payment->sender, payment->receiver, payment->amount, network, simulation->current_time, 0, &error, net_params.routing_method, exclude_edges, payment->max_fee_limit);
+          path = find_payment_path(payment, payment->attempts, network, simulation->current_time, 0, routing_method);
       }
   }
 
@@ -399,18 +445,19 @@ void send_payment(struct event* event, struct simulation* simulation, struct net
   struct event* next_event;
   enum event_type event_type;
   unsigned long is_next_node_offline;
-  struct node* node;
 
   payment = event->payment;
   route = payment->route;
-  node = array_get(network->nodes, event->node_id);
   first_route_hop = array_get(route->route_hops, 0);
   next_edge = array_get(network->edges, first_route_hop->edge_id);
 
+#ifdef DEBUG_VALIDATION
+  struct node* node = array_get(network->nodes, event->node_id);
   if(!is_present(next_edge->id, node->open_edges)) {
     printf("ERROR (send_payment): edge %ld is not an edge of node %ld \n", next_edge->id, node->id);
     exit(-1);
   }
+#endif
 
   first_route_hop->edges_lock_start_time = simulation->current_time;
 
@@ -422,63 +469,63 @@ void send_payment(struct event* event, struct simulation* simulation, struct net
     payment->error.hop = first_route_hop;
     next_event_time = simulation->current_time + OFFLINELATENCY;
     next_event = new_event(next_event_time, RECEIVEFAIL, event->node_id, event->payment);
-    simulation->events = heap_insert(simulation->events, next_event, compare_event);
+    scheduler_insert(simulation->events, next_event);
     return;
   }
 
     // fail no balance
-    if(first_route_hop->amount_to_forward > next_edge->balance) {
+    if(first_route_hop->amount_to_forward > edge_get_balance(next_edge)) {
         payment->error.type = NOBALANCE;
         payment->error.hop = first_route_hop;
         payment->no_balance_count += 1;
         next_event_time = simulation->current_time;
         next_event = new_event(next_event_time, RECEIVEFAIL, event->node_id, event->payment);
-        simulation->events = heap_insert(simulation->events, next_event, compare_event);
+        scheduler_insert(simulation->events, next_event);
         return;
     }
 
     record_min_cap_use(payment, next_edge);
 
     // update balance
-    uint64_t prev_balance = next_edge->balance;
+    uint64_t prev_balance = edge_get_balance(next_edge);
     (void)prev_balance; /* silence unused warning */
-    next_edge->balance -= first_route_hop->amount_to_forward;
+    edge_set_balance(next_edge, edge_get_balance(next_edge) - first_route_hop->amount_to_forward);
 
-    next_edge->tot_flows += 1;
+    edge_set_tot_flows(next_edge, edge_get_tot_flows(next_edge) + 1);
 
   // success sending
   event_type = first_route_hop->to_node_id == payment->receiver ? RECEIVEPAYMENT : FORWARDPAYMENT;
   next_event_time = simulation->current_time + net_params.average_payment_forward_interval + (long)(fabs(net_params.variance_payment_forward_interval * gsl_ran_ugaussian(simulation->random_generator)));
   next_event = new_event(next_event_time, event_type, first_route_hop->to_node_id, event->payment);
-  simulation->events = heap_insert(simulation->events, next_event, compare_event);
+  next_event->hop_index = 0;
+  scheduler_insert(simulation->events, next_event);
 }
 
 /* forward an HTLC for the payment (behavior of an intermediate hop node in a route) */
 void forward_payment(struct event* event, struct simulation* simulation, struct network* network, struct network_params net_params){
   struct payment* payment;
-  struct route* route;
   struct route_hop* next_route_hop, *previous_route_hop;
   long  prev_node_id;
   enum event_type event_type;
   struct event* next_event;
   uint64_t next_event_time;
   unsigned long is_next_node_offline;
-  struct node* node;
   unsigned int is_last_hop;
   struct edge *next_edge = NULL, *prev_edge;
 
   payment = event->payment;
-  node = array_get(network->nodes, event->node_id);
-  route = payment->route;
-  next_route_hop=get_route_hop(node->id, route->route_hops, 1);
-  previous_route_hop = get_route_hop(node->id, route->route_hops, 0);
+  next_route_hop = get_event_route_hop(event, event->hop_index + 1, 1);
+  previous_route_hop = get_event_route_hop(event, event->hop_index, 0);
   is_last_hop = next_route_hop->to_node_id == payment->receiver;
   next_route_hop->edges_lock_start_time = simulation->current_time;
 
+#ifdef DEBUG_VALIDATION
+  struct node* node = array_get(network->nodes, event->node_id);
   if(!is_present(next_route_hop->edge_id, node->open_edges)) {
     printf("ERROR (forward_payment): edge %ld is not an edge of node %ld \n", next_route_hop->edge_id, node->id);
     exit(-1);
   }
+#endif
 
   /* simulate the case that the next node in the route is offline */
   is_next_node_offline = gsl_ran_discrete(simulation->random_generator, network->faulty_node_prob);
@@ -490,7 +537,8 @@ void forward_payment(struct event* event, struct simulation* simulation, struct
     event_type = prev_node_id == payment->sender ? RECEIVEFAIL : FORWARDFAIL;
     next_event_time = simulation->current_time + net_params.average_payment_forward_interval + (long)(fabs(net_params.variance_payment_forward_interval * gsl_ran_ugaussian(simulation->random_generator))) + OFFLINELATENCY;
     next_event = new_event(next_event_time, event_type, prev_node_id, event->payment);
-    simulation->events = heap_insert(simulation->events, next_event, compare_event);
+    next_event->hop_index = event->hop_index - 1;
+    scheduler_insert(simulation->events, next_event);
     return;
   }
 
@@ -507,25 +555,27 @@ void forward_payment(struct event* event, struct simulation* simulation, struct
     event_type = prev_node_id == payment->sender ? RECEIVEFAIL : FORWARDFAIL;
     next_event_time = simulation->current_time + net_params.average_payment_forward_interval + (long)(fabs(net_params.variance_payment_forward_interval * gsl_ran_ugaussian(simulation->random_generator)));//prev_channel->latency;
     next_event = new_event(next_event_time, event_type, prev_node_id, event->payment);
-    simulation->events = heap_insert(simulation->events, next_event, compare_event);
+    next_event->hop_index = event->hop_index - 1;
+    scheduler_insert(simulation->events, next_event);
     return;
   }
 
   record_min_cap_use(payment, next_edge);
 
   // update balance
-  uint64_t prev_balance = next_edge->balance;
+  uint64_t prev_balance = edge_get_balance(next_edge);
   (void)prev_balance;
-  next_edge->balance -= next_route_hop->amount_to_forward;
+  edge_set_balance(next_edge, edge_get_balance(next_edge) - next_route_hop->amount_to_forward);
 
-  next_edge->tot_flows += 1;
+  edge_set_tot_flows(next_edge, edge_get_tot_flows(next_edge) + 1);
 
   // success forwarding
   event_type = is_last_hop  ? RECEIVEPAYMENT : FORWARDPAYMENT;
   // interval for forwarding payment
   next_event_time = simulation->current_time + net_params.average_payment_forward_interval + (long)(fabs(net_params.variance_payment_forward_interval * gsl_ran_ugaussian(simulation->random_generator)));//next_channel->latency;
   next_event = new_event(next_event_time, event_type, next_route_hop->to_node_id, event->payment);
-  simulation->events = heap_insert(simulation->events, next_event, compare_event);
+  next_event->hop_index = event->hop_index + 1;
+  scheduler_insert(simulation->events, next_event);
 }
 
 /* receive a payment (behavior of the payment receiver node) */
@@ -538,11 +588,9 @@ void receive_payment(struct event* event, struct simulation* simulation, struct
   struct event* next_event;
   enum event_type event_type;
   uint64_t next_event_time;
-  struct node* node;
 
   payment = event->payment;
   route = payment->route;
-  node = array_get(network->nodes, event->node_id);
 
   last_route_hop = array_get(route->route_hops, array_len(route->route_hops) - 1);
   forward_edge = array_get(network->edges, last_route_hop->edge_id);
@@ -550,13 +598,16 @@ void receive_payment(struct event* event, struct simulation* simulation, struct
 
   last_route_hop->edges_lock_end_time = simulation->current_time;
 
+#ifdef DEBUG_VALIDATION
+  struct node* node = array_get(network->nodes, event->node_id);
   if(!is_present(backward_edge->id, node->open_edges)) {
     printf("ERROR (receive_payment): edge %ld is not an edge of node %ld \n", backward_edge->id, node->id);
     exit(-1);
   }
+#endif
 
   // update balance
-  backward_edge->balance += last_route_hop->amount_to_forward;
+  edge_set_balance(backward_edge, edge_get_balance(backward_edge) + last_route_hop->amount_to_forward);
 
   payment->is_success = 1;
 
@@ -564,7 +615,8 @@ void receive_payment(struct event* event, struct simulation* simulation, struct
   event_type = prev_node_id == payment->sender ? RECEIVESUCCESS : FORWARDSUCCESS;
   next_event_time = simulation->current_time + net_params.average_payment_forward_interval + (long)(fabs(net_params.variance_payment_forward_interval * gsl_ran_ugaussian(simulation->random_generator)));//channel->latency;
   next_event = new_event(next_event_time, event_type, prev_node_id, event->payment);
-  simulation->events = heap_insert(simulation->events, next_event, compare_event);
+  next_event->hop_index = array_len(route->route_hops) - 2;
+  scheduler_insert(simulation->events, next_event);
 }
 
 /* forward an HTLC success back to the payment sender (behavior of a intermediate hop node in the route) */
@@ -575,29 +627,31 @@ void forward_success(struct event* event, struct simulation* simulation, struct
   long prev_node_id;
   struct event* next_event;
   enum event_type event_type;
-  struct node* node;
   uint64_t next_event_time;
 
   payment = event->payment;
-  prev_hop = get_route_hop(event->node_id, payment->route->route_hops, 0);
+  prev_hop = get_event_route_hop(event, event->hop_index, 0);
   forward_edge = array_get(network->edges, prev_hop->edge_id);
   backward_edge = array_get(network->edges, forward_edge->counter_edge_id);
-  node = array_get(network->nodes, event->node_id);
   prev_hop->edges_lock_end_time = simulation->current_time;
 
+#ifdef DEBUG_VALIDATION
+  struct node* node = array_get(network->nodes, event->node_id);
   if(!is_present(backward_edge->id, node->open_edges)) {
     printf("ERROR (forward_success): edge %ld is not an edge of node %ld \n", backward_edge->id, node->id);
     exit(-1);
   }
+#endif
 
   // update balance
-  backward_edge->balance += prev_hop->amount_to_forward;
+  edge_set_balance(backward_edge, edge_get_balance(backward_edge) + prev_hop->amount_to_forward);
 
   prev_node_id = prev_hop->from_node_id;
   event_type = prev_node_id == payment->sender ? RECEIVESUCCESS : FORWARDSUCCESS;
   next_event_time = simulation->current_time + net_params.average_payment_forward_interval + (long)(fabs(net_params.variance_payment_forward_interval * gsl_ran_ugaussian(simulation->random_generator)));//prev_channel->latency;
   next_event = new_event(next_event_time, event_type, prev_node_id, event->payment);
-  simulation->events = heap_insert(simulation->events, next_event, compare_event);
+  next_event->hop_index = event->hop_index - 1;
+  scheduler_insert(simulation->events, next_event);
 }
 
 /* receive an HTLC success (behavior of the payment sender node) */
@@ -616,14 +670,11 @@ void receive_success(struct event* event, struct simulation* simulation, struct
       struct route_hop* route_hop = array_get(payment->route->route_hops, i);
       struct edge* edge = array_get(network->edges, route_hop->edge_id);
 
-      struct edge_locked_balance_and_duration* edge_locked_balance_time = malloc(sizeof(struct edge_locked_balance_and_duration));
-      edge_locked_balance_time->locked_balance = route_hop->amount_to_forward;
-      edge_locked_balance_time->locked_start_time = route_hop->edges_lock_start_time;
-      edge_locked_balance_time->locked_end_time = route_hop->edges_lock_end_time;
+      uint64_t locked_end_time = route_hop->edges_lock_end_time;
       if (route_hop->edges_lock_start_time > route_hop->edges_lock_end_time){
-          edge_locked_balance_time->locked_end_time = simulation->current_time;
+          locked_end_time = simulation->current_time;
       }
-      edge->edge_locked_balance_and_durations = push(edge->edge_locked_balance_and_durations, edge_locked_balance_time);
+      record_locked_balance(edge, route_hop->amount_to_forward, route_hop->edges_lock_start_time, locked_end_time);
   }
 
     // next event
@@ -632,12 +683,12 @@ void receive_success(struct event* event, struct simulation* simulation, struct
     // request_group_update event
     if (net_params.routing_method == GROUP_ROUTING) {
         struct event *next_event = new_event(next_event_time, UPDATEGROUP, event->node_id, event->payment);
-        simulation->events = heap_insert(simulation->events, next_event, compare_event);
+        scheduler_insert(simulation->events, next_event);
     }
 
     // channel update broadcast event
     struct event *channel_update_event = new_event(next_event_time, CHANNELUPDATESUCCESS, node->id, payment);
-    simulation->events = heap_insert(simulation->events, channel_update_event, compare_event);
+    scheduler_insert(simulation->events, channel_update_event);
 }
 
 /* forward an HTLC fail back to the payment sender (behavior of a intermediate hop node in the route) */
@@ -648,32 +699,34 @@ void forward_fail(struct event* event, struct simulation* simulation, struct net
   long prev_node_id;
   struct event* next_event;
   enum event_type event_type;
-  struct node* node;
   uint64_t next_event_time;
 
-  node = array_get(network->nodes, event->node_id);
   payment = event->payment;
-  next_hop = get_route_hop(event->node_id, payment->route->route_hops, 1);
+  next_hop = get_event_route_hop(event, event->hop_index + 1, 1);
   next_edge = array_get(network->edges, next_hop->edge_id);
 
+#ifdef DEBUG_VALIDATION
+  struct node* node = array_get(network->nodes, event->node_id);
   if(!is_present(next_edge->id, node->open_edges)) {
     printf("ERROR (forward_fail): edge %ld is not an edge of node %ld \n", next_edge->id, node->id);
     exit(-1);
   }
+#endif
 
   next_hop->edges_lock_end_time = simulation->current_time;
 
   /* since the payment failed, the balance must be brought back to the state before the payment occurred */
-  uint64_t prev_balance = next_edge->balance;
+  uint64_t prev_balance = edge_get_balance(next_edge);
   (void)prev_balance;
-  next_edge->balance += next_hop->amount_to_forward;
+  edge_set_balance(next_edge, edge_get_balance(next_edge) + next_hop->amount_to_forward);
 
-  prev_hop = get_route_hop(event->node_id, payment->route->route_hops, 0);
+  prev_hop = get_event_route_hop(event, event->hop_index, 0);
   prev_node_id = prev_hop->from_node_id;
   event_type = prev_node_id == payment->sender ? RECEIVEFAIL : FORWARDFAIL;
   next_event_time = simulation->current_time + net_params.average_payment_forward_interval + (long)(fabs(net_params.variance_payment_forward_interval * gsl_ran_ugaussian(simulation->random_generator)));//prev_channel->latency;
   next_event = new_event(next_event_time, event_type, prev_node_id, event->payment);
-  simulation->events = heap_insert(simulation->events, next_event, compare_event);
+  next_event->hop_index = event->hop_index - 1;
+  scheduler_insert(simulation->events, next_event);
 }
 
 /* receive an HTLC fail (behavior of the payment sender node) */
@@ -693,22 +746,20 @@ void receive_fail(struct event* event, struct simulation* simulation, struct net
   if(error_hop->from_node_id != payment->sender){ // if the error occurred in the first hop, the balance hasn't to be updated, since it was not decreased
     first_hop = array_get(payment->route->route_hops, 0);
     next_edge = array_get(network->edges, first_hop->edge_id);
+#ifdef DEBUG_VALIDATION
     if(!is_present(next_edge->id, node->open_edges)) {
       printf("ERROR (receive_fail): edge %ld is not an edge of node %ld \n", next_edge->id, node->id);
       exit(-1);
     }
+#endif
 
-    uint64_t prev_balance = next_edge->balance;
+    uint64_t prev_balance = edge_get_balance(next_edge);
     (void)prev_balance;
-    next_edge->balance += first_hop->amount_to_forward;
+    edge_set_balance(next_edge, edge_get_balance(next_edge) + first_hop->amount_to_forward);
   }
 
   /* record channel_update */
-  struct channel_update *channel_update = malloc(sizeof(struct channel_update));
-  channel_update->htlc_maximum_msat = payment->amount;
-  channel_update->edge_id = error_edge->id;
-  channel_update->time = simulation->current_time;
-  error_edge->channel_updates = push(error_edge->channel_updates, channel_update);
+  add_channel_update(error_edge, payment->amount, simulation->current_time);
 
   add_attempt_history(payment, network, simulation->current_time, 0);
 
@@ -716,70 +767,24 @@ void receive_fail(struct event* event, struct simulation* simulation, struct net
       struct route_hop* route_hop = array_get(payment->route->route_hops, i);
       struct edge* edge = array_get(network->edges, route_hop->edge_id);
 
-      struct edge_locked_balance_and_duration* edge_locked_balance_time = malloc(sizeof(struct edge_locked_balance_and_duration));
-      edge_locked_balance_time->locked_balance = route_hop->amount_to_forward;
-      edge_locked_balance_time->locked_start_time = route_hop->edges_lock_start_time;
-      edge_locked_balance_time->locked_end_time = route_hop->edges_lock_end_time;
+      uint64_t locked_end_time = route_hop->edges_lock_end_time;
       if (route_hop->edges_lock_start_time > route_hop->edges_lock_end_time){
-          edge_locked_balance_time->locked_end_time = simulation->current_time;
+          locked_end_time = simulation->current_time;
       }
-      edge->edge_locked_balance_and_durations = push(edge->edge_locked_balance_and_durations, edge_locked_balance_time);
+      record_locked_balance(edge, route_hop->amount_to_forward, route_hop->edges_lock_start_time, locked_end_time);
 
       if(payment->error.hop->edge_id == edge->id) break;
   }
 
   next_event_time = simulation->current_time;
   next_event = new_event(next_event_time, FINDPATH, payment->sender, payment);
-  simulation->events = heap_insert(simulation->events, next_event, compare_event);
+  scheduler_insert(simulation->events, next_event);
+  if(speculation != NULL)
+    add_pending_retry(payment);
 
   /* channel update broadcast event */
   struct event *channel_update_event = new_event(simulation->current_time + net_params.group_broadcast_delay, CHANNELUPDATEFAIL, node->id, payment);
-  simulation->events = heap_insert(simulation->events, channel_update_event, compare_event);
-}
-
-/* FIFO で edge を group_add_queue に追加するヘルパー */
-static struct element* enqueue_edge_fifo(struct element* head, struct edge* e)
-{
-    if (!e) return head;
-
-    /* 既にキュー内なら二重追加しない */
-    if (e->in_group_add_queue) return head;
-
-    /* “今からキューに居る” を先に確定させる */
-    e->in_group_add_queue = 1;
-
-    if (head == NULL) {
-        return push(NULL, e);
-    } else {
-        struct element* tail = head;
-        while (tail->next != NULL) {
-            tail = tail->next;
-        }
-        return list_insert_after(tail, e, head);
-    }
-}
-
-/* 先頭ノードを末尾へ回す（ノードをfreeしない！ in_group_add_queueも触らない！） */
-static struct element* rotate_queue_head_to_tail(struct element* head)
-{
-    if (head == NULL || head->next == NULL) return head;
-
-    struct element* old_head = head;
-    struct element* new_head = head->next;
-
-    /* detach old_head */
-    new_head->prev = NULL;
-    old_head->next = NULL;
-
-    /* find tail */
-    struct element* tail = new_head;
-    while (tail->next != NULL) tail = tail->next;
-
-    /* append */
-    tail->next = old_head;
-    old_head->prev = tail;
-
-    return new_head;
+  scheduler_insert(simulation->events, channel_update_event);
 }
 
 /* 補充(join)用の条件：あなたの(5)を「補充専用」として実装 */
@@ -791,7 +796,7 @@ static int can_fill_group_local(struct group* g, struct edge* e, struct network_
     if (g->is_closed != GROUP_NOT_CLOSED) return 0;
 
     /* すでに別グループ所属なら補充しない */
-    if (e->group != NULL) return 0;
+    if (edge_get_group(e) != NULL) return 0;
 
     /* target(=group_size) 未満のときだけ補充 */
     if ((long)array_len(g->edges) >= (long)net_params.group_size) return 0;
@@ -800,19 +805,21 @@ static int can_fill_group_local(struct group* g, struct edge* e, struct network_
     if (!can_join_group(g, e)) return 0;
 
     /* (d) group_cap を下げない（= 自分が新しい最小にならない安全版） */
-    if (e->balance < g->group_cap) return 0;
+    if (edge_get_balance(e) < g->group_cap) return 0;
 
     return 1;
 }
 
 /* 既存グループ補充フェーズ：残った queue から size<group_size のグループへ入れる */
-static struct element* fill_existing_groups(struct simulation* simulation,
-                                            struct element* group_add_queue,
-                                            struct network* network,
-                                            struct network_params net_params)
+static void fill_existing_groups(struct simulation* simulation,
+                                 struct group_add_queue* group_add_queue,
+                                 struct network* network,
+                                 struct network_params net_params)
 {
-    if (!simulation || !network) return group_add_queue;
-    if (group_add_queue == NULL) return group_add_queue;
+    if (!simulation || !network) return;
+    if (group_add_queue->len == 0) return;
+
+    struct array* candidates = array_initialize(64);
 
     /* 既存グループを順に見て、足りないものを埋める */
     for (long gi = 0; gi < array_len(network->groups); gi++) {
@@ -826,38 +833,31 @@ static struct element* fill_existing_groups(struct simulation* simulation,
         /* このグループで補充できた edge を記録（最後に1回だけ update_group & ログ） */
         struct array* filled_edges = array_initialize(4);
 
-        struct element* cur = group_add_queue;
-        while (cur != NULL && (long)array_len(g->edges) < (long)net_params.group_size) {
-            struct element* next = cur->next;
-            struct edge* e = (struct edge*)cur->data;
-
-            if (e && can_fill_group_local(g, e, net_params)) {
-                /* --- queue から cur を削除（採用） --- */
-                if (cur->prev) cur->prev->next = cur->next;
-                else          group_add_queue = cur->next;
-                if (cur->next) cur->next->prev = cur->prev;
+        /* 補充できるのは [max(min_cap_limit, group_cap), max_cap_limit] の edge だけ：その範囲を FIFO 順に調べる */
+        uint64_t min_balance = g->min_cap_limit > g->group_cap ? g->min_cap_limit : g->group_cap;
+        candidates = group_add_queue_range(group_add_queue, min_balance, g->max_cap_limit, candidates);
+        for (long ci = 0; ci < array_len(candidates) && (long)array_len(g->edges) < (long)net_params.group_size; ci++) {
+            struct group_add_queue_item* item = array_get(candidates, ci);
+            struct edge* e = item->edge;
 
-                /* キューから外れたのでフラグを戻す */
-                e->in_group_add_queue = 0;
-
-                free(cur);
+            if (can_fill_group_local(g, e, net_params)) {
+                /* --- queue から item を削除（採用、in_group_add_queue も戻る） --- */
+                group_add_queue_remove(group_add_queue, item);
 
                 /* --- group に追加 --- */
                 g->edges = array_insert(g->edges, e);
-                e->group = g;
+                edge_set_group(e, g);
 
                 /* leave/rejoin メタ */
-                e->join_time     = simulation->current_time;
-                e->flows_at_join = e->tot_flows;
-                e->tolerance_tau = net_params.tau_randomize
+                edge_cold(e)->join_time     = simulation->current_time;
+                edge_cold(e)->flows_at_join = edge_get_tot_flows(e);
+                edge_cold(e)->tolerance_tau = net_params.tau_randomize
                     ? (gsl_rng_uniform(simulation->random_generator) *
                        (net_params.tau_max - net_params.tau_min) + net_params.tau_min)
                     : net_params.tau_default;
 
                 filled_edges = array_insert(filled_edges, e);
             }
-
-            cur = next;
         }
 
         /* このグループに1本でも補充できたら、最後に1回だけ update_group */
@@ -872,9 +872,9 @@ static struct element* fill_existing_groups(struct simulation* simulation,
                 for (long j = 0; j < array_len(g->edges); j++) {
                     struct edge* rem = array_get(g->edges, j);
                     if (!rem) continue;
-                    rem->group = NULL;
-                    rem->last_leave_time = simulation->current_time;
-                    group_add_queue = enqueue_edge_fifo(group_add_queue, rem);
+                    edge_set_group(rem, NULL);
+                    edge_cold(rem)->last_leave_time = simulation->current_time;
+                    group_add_queue_push(group_add_queue, rem);
                 }
             } else {
                 /* join ログ（補充） */
@@ -900,15 +900,15 @@ static struct element* fill_existing_groups(struct simulation* simulation,
         array_free(filled_edges);
     }
 
-    return group_add_queue;
+    array_free(candidates);
 }
 
 /* ====== UPDATED: request_group_update with leave/rejoin mechanism ====== */
-struct element* request_group_update(struct event* event,
-                                     struct simulation* simulation,
-                                     struct network* network,
-                                     struct network_params net_params,
-                                     struct element* group_add_queue)
+void request_group_update(struct event* event,
+                          struct simulation* simulation,
+                          struct network* network,
+                          struct network_params net_params,
+                          struct group_add_queue* group_add_queue)
 {
     int scheduled_construct = 0; /* whether to schedule CONSTRUCTGROUPS at the end */
 
@@ -928,8 +928,8 @@ struct element* request_group_update(struct event* event,
         struct edge* counter_edge = array_get(network->edges, edge->counter_edge_id);
 
         /* --- handle group for edge --- */
-        if (edge->group != NULL) {
-            struct group* group = edge->group;
+        if (edge_get_group(edge) != NULL) {
+            struct group* group = edge_get_group(edge);
 
             /* guard: process each group at most once per event */
             if (!seen_group(processed_groups, group)) {
@@ -944,9 +944,9 @@ struct element* request_group_update(struct event* event,
                     for (long j = 0; j < array_len(group->edges); j++) {
                         struct edge* edge_in_group = array_get(group->edges, j);
                         if (!edge_in_group) continue;
-                        edge_in_group->group = NULL;
-                        edge_in_group->last_leave_time = simulation->current_time;
-                        group_add_queue = enqueue_edge_fifo(group_add_queue, edge_in_group);
+                        edge_set_group(edge_in_group, NULL);
+                        edge_cold(edge_in_group)->last_leave_time = simulation->current_time;
+                        group_add_queue_push(group_add_queue, edge_in_group);
                     }
 
                     /* schedule reconstruction immediately */
@@ -954,7 +954,7 @@ struct element* request_group_update(struct event* event,
                         uint64_t next_event_time = simulation->current_time;
                         struct event* next_event = new_event(next_event_time, CONSTRUCTGROUPS,
                                                              event->node_id, event->payment);
-                        simulation->events = heap_insert(simulation->events, next_event, compare_event);
+                        scheduler_insert(simulation->events, next_event);
                     }
                     scheduled_construct = 1;
 
@@ -969,20 +969,20 @@ struct element* request_group_update(struct event* event,
                         if (e == NULL) continue;
 
                         /* cooldown */
-                        if (simulation->current_time >= e->last_leave_time &&
-                            (simulation->current_time - e->last_leave_time) < cooldown_ms) {
+                        if (simulation->current_time >= edge_cold(e)->last_leave_time &&
+                            (simulation->current_time - edge_cold(e)->last_leave_time) < cooldown_ms) {
                             continue;
                         }
 
                         /* UL = max(0, 1 - group_cap / balance) */
                         double UL = 0.0;
-                        if (e->balance > 0) {
-                            UL = 1.0 - ((double)group->group_cap / (double)e->balance);
+                        if (edge_get_balance(e) > 0) {
+                            UL = 1.0 - ((double)group->group_cap / (double)edge_get_balance(e));
                             if (UL < 0.0) UL = 0.0;
                             if (UL > 1.0) UL = 1.0;
                         }
 
-                        if (UL >= e->tolerance_tau) {
+                        if (UL >= edge_cold(e)->tolerance_tau) {
                             leave_candidates = array_insert(leave_candidates, e);
                         }
                     }
@@ -994,13 +994,13 @@ struct element* request_group_update(struct event* event,
 
                         if (net_params.enable_group_event_csv && csv_group_events) {
                             double UL = 0.0;
-                            if (e->balance > 0) {
-                                UL = 1.0 - ((double)group->group_cap / (double)e->balance);
+                            if (edge_get_balance(e) > 0) {
+                                UL = 1.0 - ((double)group->group_cap / (double)edge_get_balance(e));
                                 if (UL < 0.0) UL = 0.0;
                                 if (UL > 1.0) UL = 1.0;
                             }
                             uint64_t used_since_join =
-                                (e->tot_flows >= e->flows_at_join) ? (e->tot_flows - e->flows_at_join) : 0;
+                                (edge_get_tot_flows(e) >= edge_cold(e)->flows_at_join) ? (edge_get_tot_flows(e) - edge_cold(e)->flows_at_join) : 0;
 
                             char reason_buf[128];
                             snprintf(reason_buf, sizeof(reason_buf),
@@ -1019,9 +1019,9 @@ struct element* request_group_update(struct event* event,
 
                         /* remove from group and enqueue */
                         remove_edge_from_group(group, e);
-                        e->group = NULL;
-                        e->last_leave_time = simulation->current_time;
-                        group_add_queue = enqueue_edge_fifo(group_add_queue, e);
+                        edge_set_group(e, NULL);
+                        edge_cold(e)->last_leave_time = simulation->current_time;
+                        group_add_queue_push(group_add_queue, e);
 
                         leaves_this_tick++;
                         scheduled_construct = 1;
@@ -1038,9 +1038,9 @@ struct element* request_group_update(struct event* event,
                             for (long jj = 0; jj < array_len(group->edges); jj++) {
                                 struct edge* rem = array_get(group->edges, jj);
                                 if (!rem) continue;
-                                rem->group = NULL;
-                                rem->last_leave_time = simulation->current_time;
-                                group_add_queue = enqueue_edge_fifo(group_add_queue, rem);
+                                edge_set_group(rem, NULL);
+                                edge_cold(rem)->last_leave_time = simulation->current_time;
+                                group_add_queue_push(group_add_queue, rem);
                             }
 
                             scheduled_construct = 1;
@@ -1053,8 +1053,8 @@ struct element* request_group_update(struct event* event,
         }
 
         /* --- handle group for counter_edge (symmetric) --- */
-        if (counter_edge && counter_edge->group != NULL) {
-            struct group* group = counter_edge->group;
+        if (counter_edge && edge_get_group(counter_edge) != NULL) {
+            struct group* group = edge_get_group(counter_edge);
 
             /* guard: process each group at most once per event */
             if (!seen_group(processed_groups, group)) {
@@ -1070,16 +1070,16 @@ struct element* request_group_update(struct event* event,
                     for (long j = 0; j < array_len(group->edges); j++) {
                         struct edge* edge_in_group = array_get(group->edges, j);
                         if (!edge_in_group) continue;
-                        edge_in_group->group = NULL;
-                        edge_in_group->last_leave_time = simulation->current_time;
-                        group_add_queue = enqueue_edge_fifo(group_add_queue, edge_in_group);
+                        edge_set_group(edge_in_group, NULL);
+                        edge_cold(edge_in_group)->last_leave_time = simulation->current_time;
+                        group_add_queue_push(group_add_queue, edge_in_group);
                     }
 
                     {
                         uint64_t next_event_time = simulation->current_time;
                         struct event* next_event = new_event(next_event_time, CONSTRUCTGROUPS,
                                                              event->node_id, event->payment);
-                        simulation->events = heap_insert(simulation->events, next_event, compare_event);
+                        scheduler_insert(simulation->events, next_event);
                     }
                     scheduled_construct = 1;
 
@@ -1092,19 +1092,19 @@ struct element* request_group_update(struct event* event,
                         struct edge* e = array_get(group->edges, j);
                         if (e == NULL) continue;
 
-                        if (simulation->current_time >= e->last_leave_time &&
-                            (simulation->current_time - e->last_leave_time) < cooldown_ms) {
+                        if (simulation->current_time >= edge_cold(e)->last_leave_time &&
+                            (simulation->current_time - edge_cold(e)->last_leave_time) < cooldown_ms) {
                             continue;
                         }
 
                         double UL = 0.0;
-                        if (e->balance > 0) {
-                            UL = 1.0 - ((double)group->group_cap / (double)e->balance);
+                        if (edge_get_balance(e) > 0) {
+                            UL = 1.0 - ((double)group->group_cap / (double)edge_get_balance(e));
                             if (UL < 0.0) UL = 0.0;
                             if (UL > 1.0) UL = 1.0;
                         }
 
-                        if (UL >= e->tolerance_tau) {
+                        if (UL >= edge_cold(e)->tolerance_tau) {
                             leave_candidates = array_insert(leave_candidates, e);
                         }
                     }
@@ -1117,13 +1117,13 @@ struct element* request_group_update(struct event* event,
                         /* NEW: log leave for counter_edge side as well */
                         if (net_params.enable_group_event_csv && csv_group_events) {
                             double UL = 0.0;
-                            if (e->balance > 0) {
-                                UL = 1.0 - ((double)group->group_cap / (double)e->balance);
+                            if (edge_get_balance(e) > 0) {
+                                UL = 1.0 - ((double)group->group_cap / (double)edge_get_balance(e));
                                 if (UL < 0.0) UL = 0.0;
                                 if (UL > 1.0) UL = 1.0;
                             }
                             uint64_t used_since_join =
-                                (e->tot_flows >= e->flows_at_join) ? (e->tot_flows - e->flows_at_join) : 0;
+                                (edge_get_tot_flows(e) >= edge_cold(e)->flows_at_join) ? (edge_get_tot_flows(e) - edge_cold(e)->flows_at_join) : 0;
 
                             char reason_buf[128];
                             /* edge側と同形式。識別したいなら prefix を付けてもよい */
@@ -1147,9 +1147,9 @@ struct element* request_group_update(struct event* event,
 
                         /* remove from group and enqueue */
                         remove_edge_from_group(group, e);
-                        e->group = NULL;
-                        e->last_leave_time = simulation->current_time;
-                        group_add_queue = enqueue_edge_fifo(group_add_queue, e);
+                        edge_set_group(e, NULL);
+                        edge_cold(e)->last_leave_time = simulation->current_time;
+                        group_add_queue_push(group_add_queue, e);
 
                         leaves_this_tick++;
                         scheduled_construct = 1;
@@ -1165,9 +1165,9 @@ struct element* request_group_update(struct event* event,
                             for (long jj = 0; jj < array_len(group->edges); jj++) {
                                 struct edge* rem = array_get(group->edges, jj);
                                 if (!rem) continue;
-                                rem->group = NULL;
-                                rem->last_leave_time = simulation->current_time;
-                                group_add_queue = enqueue_edge_fifo(group_add_queue, rem);
+                                edge_set_group(rem, NULL);
+                                edge_cold(rem)->last_leave_time = simulation->current_time;
+                                group_add_queue_push(group_add_queue, rem);
                             }
 
                             scheduled_construct = 1;
@@ -1185,30 +1185,32 @@ struct element* request_group_update(struct event* event,
         uint64_t next_event_time = simulation->current_time + net_params.group_broadcast_delay;
         struct event* next_event = new_event(next_event_time, CONSTRUCTGROUPS,
                                              event->node_id, event->payment);
-        simulation->events = heap_insert(simulation->events, next_event, compare_event);
+        scheduler_insert(simulation->events, next_event);
     }
 
     array_free(processed_groups);
-    return group_add_queue;
 }
 
 /* ====== UPDATED: construct_groups ====== */
-struct element* construct_groups(struct simulation* simulation,
-                                 struct element* group_add_queue,
-                                 struct network *network,
-                                 struct network_params net_params)
+void construct_groups(struct simulation* simulation,
+                      struct group_add_queue* group_add_queue,
+                      struct network *network,
+                      struct network_params net_params)
 {
-    if (group_add_queue == NULL) return group_add_queue;
+    if (group_add_queue->len == 0) return;
 
-    static uint64_t attempt_counter = 0;  /* 全体で単調増加 */
+    /* 前回の呼び出しから balance が変わった edge の索引キーを更新（この呼び出し中は balance は変わらない） */
+    group_add_queue_refresh(group_add_queue);
 
     /* その呼び出しで「最大1周」だけ seed を回す（無限ループ防止） */
-    long max_rotations = 0;
-    for (struct element* t = group_add_queue; t != NULL; t = t->next) max_rotations++;
+    long max_rotations = group_add_queue->len;
     long rotations = 0;
 
+    /* seed のレンジに入る queue の edge（FIFO 順） */
+    struct array* candidates = array_initialize(64);
+
     /* ===== 新規グループ構築フェーズ（回せるだけ回す） ===== */
-    while (group_add_queue != NULL) {
+    while (group_add_queue->len > 0) {
 
         if (rotations >= max_rotations) {
             /* 1周しても commit できないなら今回は打ち切り（残りは次回CONSTRUCTGROUPSへ） */
@@ -1216,8 +1218,8 @@ struct element* construct_groups(struct simulation* simulation,
         }
 
         /* 先頭を seed */
-        struct edge* seed_edge = (struct edge*)group_add_queue->data;
-        uint64_t attempt_id = ++attempt_counter;
+        struct edge* seed_edge = group_add_queue->head->edge;
+        uint64_t attempt_id = ++group_attempt_counter;
 
         if (net_params.enable_group_event_csv && csv_group_events) {
             ge_construct_begin((uint64_t)simulation->current_time,
@@ -1227,7 +1229,7 @@ struct element* construct_groups(struct simulation* simulation,
 
         /* provisional group */
         struct group* group = malloc(sizeof(struct group));
-        if (!group) return group_add_queue;
+        if (!group) break;
 
         group->edges = array_initialize(net_params.group_size);
         group->seed_edge_id = seed_edge->id;
@@ -1235,34 +1237,35 @@ struct element* construct_groups(struct simulation* simulation,
 
         /* seed 由来の min/max */
         if (net_params.use_conventional_method) {
-            group->max_cap_limit = seed_edge->balance +
-                (uint64_t)((float)seed_edge->balance * net_params.group_limit_rate);
-            group->min_cap_limit = seed_edge->balance -
-                (uint64_t)((float)seed_edge->balance * net_params.group_limit_rate);
-            if (group->max_cap_limit < seed_edge->balance) group->max_cap_limit = UINT64_MAX;
-            if (group->min_cap_limit > seed_edge->balance) group->min_cap_limit = 0;
+            group->max_cap_limit = edge_get_balance(seed_edge) +
+                (uint64_t)((float)edge_get_balance(seed_edge) * net_params.group_limit_rate);
+            group->min_cap_limit = edge_get_balance(seed_edge) -
+                (uint64_t)((float)edge_get_balance(seed_edge) * net_params.group_limit_rate);
+            if (group->max_cap_limit < edge_get_balance(seed_edge)) group->max_cap_limit = UINT64_MAX;
+            if (group->min_cap_limit > edge_get_balance(seed_edge)) group->min_cap_limit = 0;
         } else {
-            group->max_cap_limit = (uint64_t)((float)seed_edge->balance * net_params.group_max_cap_ratio);
-            group->min_cap_limit = (uint64_t)((float)seed_edge->balance * net_params.group_min_cap_ratio);
+            group->max_cap_limit = (uint64_t)((float)edge_get_balance(seed_edge) * net_params.group_max_cap_ratio);
+            group->min_cap_limit = (uint64_t)((float)edge_get_balance(seed_edge) * net_params.group_min_cap_ratio);
         }
 
         group->id = -1;
         group->is_closed = GROUP_NOT_CLOSED;
         group->constructed_time = simulation->current_time;
         group->history = NULL;
+        group->version = ++network_version;
 
-        /* 採用した queue ノードを記録して後で一括削除 */
-        struct array* chosen_nodes = array_initialize(net_params.group_size);
+        /* 採用した queue の item を記録して後で一括削除 */
+        struct array* chosen_items = array_initialize(net_params.group_size);
 
-        for (struct element* cur = group_add_queue;
-             cur != NULL && array_len(group->edges) < net_params.group_size;
-             cur = cur->next)
-        {
-            struct edge* e = (struct edge*)cur->data;
+        /* レンジ [min_cap_limit, max_cap_limit] 外の edge は can_join_group を満たさないので、レンジ内だけを FIFO 順に調べる */
+        candidates = group_add_queue_range(group_add_queue, group->min_cap_limit, group->max_cap_limit, candidates);
+        for (long ci = 0; ci < array_len(candidates) && array_len(group->edges) < net_params.group_size; ci++) {
+            struct group_add_queue_item* item = array_get(candidates, ci);
+            struct edge* e = item->edge;
 
             if (can_join_group(group, e)) {
                 group->edges = array_insert(group->edges, e);
-                chosen_nodes = array_insert(chosen_nodes, cur);
+                chosen_items = array_insert(chosen_items, item);
             }
         }
 
@@ -1291,32 +1294,19 @@ struct element* construct_groups(struct simulation* simulation,
                                     (uint64_t)attempt_id);
             }
 
-            /* queue から chosen_nodes を削除（= dequeue なのでフラグを0に戻す） */
-            for (int i = 0; i < array_len(chosen_nodes); i++) {
-                struct element* node = array_get(chosen_nodes, i);
-                struct edge* dequeued = (struct edge*)node->data;
-                if (dequeued) dequeued->in_group_add_queue = 0;
-
-                struct element* prev = node->prev;
-                struct element* next = node->next;
-
-                if (prev) prev->next = next;
-                else      group_add_queue = next;
-
-                if (next) next->prev = prev;
-
-                free(node);
-            }
-            array_free(chosen_nodes);
+            /* queue から chosen_items を削除（= dequeue なのでフラグも0に戻る） */
+            for (int i = 0; i < array_len(chosen_items); i++)
+                group_add_queue_remove(group_add_queue, array_get(chosen_items, i));
+            array_free(chosen_items);
 
             /* edge 側の join 初期化 & join ログ */
             for (int i = 0; i < array_len(group->edges); i++) {
                 struct edge* ge = array_get(group->edges, i);
-                ge->group = group;
+                edge_set_group(ge, group);
 
-                ge->join_time     = simulation->current_time;
-                ge->flows_at_join = ge->tot_flows;
-                ge->tolerance_tau = net_params.tau_randomize
+                edge_cold(ge)->join_time     = simulation->current_time;
+                edge_cold(ge)->flows_at_join = edge_get_tot_flows(ge);
+                edge_cold(ge)->tolerance_tau = net_params.tau_randomize
                     ? (gsl_rng_uniform(simulation->random_generator) *
                        (net_params.tau_max - net_params.tau_min) + net_params.tau_min)
                     : net_params.tau_default;
@@ -1340,8 +1330,7 @@ struct element* construct_groups(struct simulation* simulation,
             rotations = 0;
 
             /* queue 長が変わったので 1周上限を再計算 */
-            max_rotations = 0;
-            for (struct element* t = group_add_queue; t != NULL; t = t->next) max_rotations++;
+            max_rotations = group_add_queue->len;
 
             continue;
         }
@@ -1357,21 +1346,21 @@ struct element* construct_groups(struct simulation* simulation,
 
         array_free(group->edges);
         free(group);
-        array_free(chosen_nodes);
+        array_free(chosen_items);
 
         /*
          * A/Bの核心：
-         * pop()+enqueue は禁止（in_group_add_queue と衝突して seed が消えるため）。
-         * ノードをfreeせず「先頭ノードを末尾へ回す」だけにする。
+         * remove+push は禁止（seed が末尾に回らず新しい edge と同じ扱いになるため）。
+         * item を残したまま「先頭を末尾へ回す」だけにする。
          */
-        group_add_queue = rotate_queue_head_to_tail(group_add_queue);
+        group_add_queue_rotate(group_add_queue);
         rotations++;
     }
 
-    /* ===== C/D: 既存グループ補充フェーズ（新規構築の後にまとめて） ===== */
-    group_add_queue = fill_existing_groups(simulation, group_add_queue, network, net_params);
+    array_free(candidates);
 
-    return group_add_queue;
+    /* ===== C/D: 既存グループ補充フェーズ（新規構築の後にまとめて） ===== */
+    fill_existing_groups(simulation, group_add_queue, network, net_params);
 }
 
 void channel_update_success(struct event* event, struct simulation* simulation, struct network* network){
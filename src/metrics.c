@@ -0,0 +1,345 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "../include/metrics.h"
+#include "../include/array.h"
+#include "../include/list.h"
+
+/* Functions in this file accumulate the metrics of the simulation online and write them in a one-line summary (see `struct metrics`) */
+
+static const double metrics_percentiles[N_METRICS_PERCENTILES] = {5, 25, 50, 75, 95};
+
+/* P-SQUARE QUANTILE ESTIMATION */
+
+static void p2_initialize(struct p2_quantile* q, double p) {
+  q->p = p;
+  q->n = 0;
+  q->increment[0] = 0.0;
+  q->increment[1] = p/2;
+  q->increment[2] = p;
+  q->increment[3] = (1 + p)/2;
+  q->increment[4] = 1.0;
+}
+
+static int compare_double(const void* a, const void* b) {
+  double x = *(const double*)a, y = *(const double*)b;
+  return (x > y) - (x < y);
+}
+
+static double p2_parabolic(struct p2_quantile* q, int i, double d) {
+  double* h = q->height, *n = q->position;
+  return h[i] + d/(n[i+1] - n[i-1]) * ((n[i] - n[i-1] + d)*(h[i+1] - h[i])/(n[i+1] - n[i]) + (n[i+1] - n[i] - d)*(h[i] - h[i-1])/(n[i] - n[i-1]));
+}
+
+static double p2_linear(struct p2_quantile* q, int i, int d) {
+  return q->height[i] + d*(q->height[i+d] - q->height[i])/(q->position[i+d] - q->position[i]);
+}
+
+static void p2_add(struct p2_quantile* q, double x) {
+  int i, k, d;
+  double delta, height;
+
+  if(q->n < 5) {
+    q->height[q->n++] = x;
+    if(q->n == 5) {
+      qsort(q->height, 5, sizeof(double), compare_double);
+      for(i = 0; i < 5; i++) {
+        q->position[i] = i + 1;
+        q->desired[i] = 1 + 4*q->increment[i];
+      }
+    }
+    return;
+  }
+
+  /* cell of the new observation, extending the extreme markers if needed */
+  if(x < q->height[0]) {
+    q->height[0] = x;
+    k = 0;
+  }
+  else if(x >= q->height[4]) {
+    q->height[4] = x;
+    k = 3;
+  }
+  else
+    for(k = 0; k < 3 && x >= q->height[k+1]; k++);
+  for(i = k + 1; i < 5; i++)
+    q->position[i]++;
+  for(i = 0; i < 5; i++)
+    q->desired[i] += q->increment[i];
+  q->n++;
+
+  /* move the middle markers towards their desired positions */
+  for(i = 1; i < 4; i++) {
+    delta = q->desired[i] - q->position[i];
+    if((delta >= 1 && q->position[i+1] - q->position[i] > 1) || (delta <= -1 && q->position[i-1] - q->position[i] < -1)) {
+      d = delta >= 0 ? 1 : -1;
+      height = p2_parabolic(q, i, d);
+      if(q->height[i-1] < height && height < q->height[i+1])
+        q->height[i] = height;
+      else
+        q->height[i] = p2_linear(q, i, d);
+      q->position[i] += d;
+    }
+  }
+}
+
+/* the estimated quantile; with at most five observations, the exact one (linearly interpolated, as numpy.percentile) */
+static double p2_result(struct p2_quantile* q) {
+  double sorted[5], index;
+  long lower;
+
+  if(q->n == 0)
+    return NAN;
+  if(q->n > 5)
+    return q->height[2];
+  memcpy(sorted, q->height, sizeof(double)*q->n);
+  qsort(sorted, q->n, sizeof(double), compare_double);
+  index = q->p*(q->n - 1);
+  lower = (long)floor(index);
+  if(lower >= q->n - 1)
+    return sorted[q->n - 1];
+  return sorted[lower] + (index - lower)*(sorted[lower+1] - sorted[lower]);
+}
+
+/* ONLINE STATISTICS */
+
+void online_stat_initialize(struct online_stat* stat) {
+  int i;
+  stat->n = 0;
+  stat->mean = 0.0;
+  stat->m2 = 0.0;
+  stat->min = INFINITY;
+  stat->max = -INFINITY;
+  for(i = 0; i < N_METRICS_PERCENTILES; i++)
+    p2_initialize(&(stat->percentiles[i]), metrics_percentiles[i]/100.0);
+}
+
+void online_stat_add(struct online_stat* stat, double value) {
+  double delta;
+  int i;
+  stat->n++;
+  delta = value - stat->mean;
+  stat->mean += delta/stat->n;
+  stat->m2 += delta*(value - stat->mean);
+  if(value < stat->min) stat->min = value;
+  if(value > stat->max) stat->max = value;
+  for(i = 0; i < N_METRICS_PERCENTILES; i++)
+    p2_add(&(stat->percentiles[i]), value);
+}
+
+double online_stat_percentile(struct online_stat* stat, int i) {
+  return p2_result(&(stat->percentiles[i]));
+}
+
+/* PAYMENT METRICS */
+
+struct metrics* metrics_initialize(void) {
+  struct metrics* metrics;
+  metrics = malloc(sizeof(struct metrics));
+  memset(metrics, 0, sizeof(struct metrics));
+  online_stat_initialize(&(metrics->time));
+  online_stat_initialize(&(metrics->time_success));
+  online_stat_initialize(&(metrics->time_fail));
+  online_stat_initialize(&(metrics->retry));
+  online_stat_initialize(&(metrics->fee));
+  online_stat_initialize(&(metrics->fee_per_satoshi));
+  online_stat_initialize(&(metrics->route_len));
+  return metrics;
+}
+
+/* account a completed payment */
+void metrics_add_payment(struct metrics* metrics, struct payment* payment) {
+  uint64_t time;
+  int retry;
+
+  time = payment->end_time - payment->start_time;
+  retry = payment->attempts - 1;
+  if(payment->end_time > metrics->simulation_time)
+    metrics->simulation_time = payment->end_time;
+
+  if(payment->is_success) {
+    metrics->n_success++;
+    online_stat_add(&(metrics->time_success), time);
+    online_stat_add(&(metrics->retry), retry);
+    online_stat_add(&(metrics->fee), payment->route->total_fee);
+    online_stat_add(&(metrics->fee_per_satoshi), (double)payment->route->total_fee/payment->amount);
+    online_stat_add(&(metrics->route_len), array_len(payment->route->route_hops));
+  }
+  else {
+    online_stat_add(&(metrics->time_fail), time);
+    if(payment->route == NULL && payment->attempts == 1)
+      metrics->n_fail_no_path++;
+    else if(payment->is_timeout)
+      metrics->n_fail_timeout++;
+    else
+      metrics->n_fail_no_alternative_path++;
+  }
+
+  metrics->n_payments++;
+  metrics->n_attempts += payment->attempts;
+  metrics->n_retries += retry;
+  metrics->n_retries_no_balance += payment->no_balance_count;
+  online_stat_add(&(metrics->time), time);
+}
+
+/* SUMMARY */
+
+static void write_value(FILE* file, double value) {
+  if(isnan(value))
+    fprintf(file, ",");
+  else
+    fprintf(file, ",%.17g", value);
+}
+
+static void write_rate(FILE* file, long count, long total) {
+  write_value(file, total > 0 ? (double)count/total : NAN);
+}
+
+static void write_empty_stat(FILE* file) {
+  int i;
+  fprintf(file, ",,,,");
+  for(i = 0; i < N_METRICS_PERCENTILES; i++)
+    fprintf(file, ",");
+}
+
+/* average, variance, max, min and percentiles (empty if there are no values) */
+static void write_stat(FILE* file, struct online_stat* stat) {
+  int i;
+  if(stat->n == 0) {
+    write_empty_stat(file);
+    return;
+  }
+  write_value(file, stat->mean);
+  write_value(file, stat->m2/stat->n);
+  write_value(file, stat->max);
+  write_value(file, stat->min);
+  for(i = 0; i < N_METRICS_PERCENTILES; i++)
+    write_value(file, online_stat_percentile(stat, i));
+}
+
+static void write_stat_header(FILE* file, const char* name, const char* variance_name) {
+  int i;
+  fprintf(file, ",%s/average,%s/%s,%s/max,%s/min", name, name, variance_name, name, name);
+  for(i = 0; i < N_METRICS_PERCENTILES; i++)
+    fprintf(file, ",%s/%g-percentile", name, metrics_percentiles[i]);
+}
+
+/* capacity and cul of the latest snapshot of a group, as in groups_output.csv */
+static void get_group_capacity_and_cul(struct group* group, uint64_t* capacity, float* cul) {
+  struct group_update* group_update = NULL;
+  struct edge* edge;
+  long j, n_members;
+  uint64_t balance;
+  float sum_cul = 0.0f;
+
+  if(group->history != NULL)
+    group_update = group->history->data;
+  *capacity = group_update != NULL ? group_update->group_cap : group->group_cap;
+  n_members = array_len(group->edges);
+  for(j = 0; j < n_members; j++) {
+    if(group_update != NULL)
+      balance = group_update->edge_balances[j];
+    else {
+      edge = array_get(group->edges, j);
+      balance = edge != NULL ? edge_get_balance(edge) : 0;
+    }
+    if(balance > 0)
+      sum_cul += (1.0f - ((float)*capacity / (float)balance));
+  }
+  *cul = n_members > 0 ? sum_cul / (float)n_members : 0.0f;
+}
+
+/* metrics_summary.csv: the header and a single row with the metrics of the payments and of the final state of edges and groups */
+void write_metrics_summary(struct metrics* metrics, struct network* network, double request_amt_rate, char output_dir_name[]) {
+  struct online_stat locked_balance_duration, group_survival_time, group_capacity, cul;
+  struct edge* edge;
+  struct group* group;
+  long i, n_edges_in_group;
+  uint64_t capacity;
+  float group_cul;
+  char output_filename[512];
+  FILE* file;
+
+  n_edges_in_group = 0;
+  online_stat_initialize(&locked_balance_duration);
+  for(i = 0; i < array_len(network->edges); i++) {
+    edge = array_get(network->edges, i);
+    if(edge_get_group(edge) != NULL)
+      n_edges_in_group++;
+    if(edge_cold(edge)->locked_stats.count > 0)
+      online_stat_add(&locked_balance_duration, edge_cold(edge)->locked_stats.sum_balance_duration);
+  }
+
+  online_stat_initialize(&group_survival_time);
+  online_stat_initialize(&group_capacity);
+  online_stat_initialize(&cul);
+  for(i = 0; i < array_len(network->groups); i++) {
+    group = array_get(network->groups, i);
+    if(group == NULL) continue;
+    get_group_capacity_and_cul(group, &capacity, &group_cul);
+    online_stat_add(&group_capacity, capacity);
+    if(group->is_closed != GROUP_NOT_CLOSED)
+      online_stat_add(&group_survival_time, (double)group->is_closed - (double)group->constructed_time);
+    else
+      online_stat_add(&cul, group_cul);
+  }
+
+  strcpy(output_filename, output_dir_name);
+  strcat(output_filename, "metrics_summary.csv");
+  file = fopen(output_filename, "w");
+  if(file == NULL) {
+    printf("ERROR cannot open metrics_summary.csv\n");
+    exit(-1);
+  }
+
+  fprintf(file, "request_amt_rate,simulation_time,success_rate,fail_no_path_rate,fail_timeout_rate,fail_no_alternative_path_rate,retry_rate,retry_no_balance_rate");
+  write_stat_header(file, "time", "variance");
+  write_stat_header(file, "time_success", "variance");
+  write_stat_header(file, "time_fail", "variance");
+  write_stat_header(file, "retry", "variance");
+  write_stat_header(file, "fee", "variance");
+  write_stat_header(file, "fee_per_satoshi", "variance");
+  write_stat_header(file, "route_len", "variance");
+  fprintf(file, ",group_cover_rate");
+  write_stat_header(file, "total_locked_balance_duration", "variance");
+  write_stat_header(file, "group_survival_time", "var");
+  write_stat_header(file, "group_capacity", "var");
+  write_stat_header(file, "cul", "var");
+  fprintf(file, "\n");
+
+  fprintf(file, "%.17g", request_amt_rate);
+  write_value(file, metrics->simulation_time);
+  write_rate(file, metrics->n_success, metrics->n_payments);
+  write_rate(file, metrics->n_fail_no_path, metrics->n_payments);
+  write_rate(file, metrics->n_fail_timeout, metrics->n_payments);
+  write_rate(file, metrics->n_fail_no_alternative_path, metrics->n_payments);
+  write_rate(file, metrics->n_retries, metrics->n_attempts);
+  write_rate(file, metrics->n_retries_no_balance, metrics->n_attempts);
+  write_stat(file, &(metrics->time));
+  write_stat(file, &(metrics->time_success));
+  write_stat(file, &(metrics->time_fail));
+  write_stat(file, &(metrics->retry));
+  write_stat(file, &(metrics->fee));
+  write_stat(file, &(metrics->fee_per_satoshi));
+  write_stat(file, &(metrics->route_len));
+  write_rate(file, n_edges_in_group, array_len(network->edges));
+  write_stat(file, &locked_balance_duration);
+  write_stat(file, &group_survival_time);
+  /* as in analyze_output.py, the group capacity and the cul are empty if no group closed */
+  if(group_survival_time.n > 0) {
+    write_stat(file, &group_capacity);
+    write_stat(file, &cul);
+  }
+  else {
+    write_empty_stat(file);
+    write_empty_stat(file);
+  }
+  fprintf(file, "\n");
+
+  fclose(file);
+}
+
+void metrics_free(struct metrics* metrics) {
+  free(metrics);
+}
@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "../include/mission_control.h"
+
+/* Functions in this file implement the store of the node pair results of a sender node (see `struct mission_control`) */
+
+static unsigned long hash_node_pair(long from_node_id, long to_node_id) {
+  uint64_t h;
+  h = (uint64_t)from_node_id * 0x9E3779B97F4A7C15ULL;
+  h ^= (uint64_t)to_node_id + 0x7F4A7C159E3779B9ULL + (h << 6) + (h >> 2);
+  h ^= h >> 29;
+  return (unsigned long)h;
+}
+
+static unsigned long hash_node(long node_id) {
+  uint64_t h;
+  h = (uint64_t)node_id * 0x9E3779B97F4A7C15ULL;
+  h ^= h >> 29;
+  return (unsigned long)h;
+}
+
+static void* mission_control_malloc(size_t size) {
+  void* p = malloc(size);
+  if(p == NULL) {
+    fprintf(stderr, "ERROR: malloc failed for mission control\n");
+    exit(-1);
+  }
+  return p;
+}
+
+static long* new_hash_table(long size) {
+  long i, *table;
+  table = mission_control_malloc(sizeof(long)*size);
+  for(i=0; i<size; i++)
+    table[i] = -1;
+  return table;
+}
+
+/* sizes are powers of two so that the position in the tables is a mask of the hash */
+struct mission_control* mission_control_initialize(long size) {
+  struct mission_control* mc;
+  long table_size;
+
+  table_size = 8;
+  while(table_size < 2*size) table_size *= 2;
+
+  mc = mission_control_malloc(sizeof(struct mission_control));
+  mc->results_size = size;
+  mc->n_results = 0;
+  mc->results = mission_control_malloc(sizeof(struct node_pair_result)*size);
+  mc->next_result = mission_control_malloc(sizeof(long)*size);
+  mc->pairs_size = table_size;
+  mc->pairs = new_hash_table(table_size);
+  mc->from_nodes_size = table_size;
+  mc->n_from_nodes = 0;
+  mc->from_nodes = new_hash_table(table_size);
+  mc->from_heads = new_hash_table(table_size);
+  return mc;
+}
+
+static long find_pair_slot(struct mission_control* mc, long from_node_id, long to_node_id) {
+  long slot, mask, result_index;
+  mask = mc->pairs_size - 1;
+  slot = hash_node_pair(from_node_id, to_node_id) & mask;
+  while((result_index = mc->pairs[slot]) != -1) {
+    if(mc->results[result_index].from_node_id == from_node_id && mc->results[result_index].to_node_id == to_node_id)
+      break;
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+static long find_from_node_slot(struct mission_control* mc, long from_node_id) {
+  long slot, mask;
+  mask = mc->from_nodes_size - 1;
+  slot = hash_node(from_node_id) & mask;
+  while(mc->from_nodes[slot] != -1 && mc->from_nodes[slot] != from_node_id)
+    slot = (slot + 1) & mask;
+  return slot;
+}
+
+static void resize_pairs(struct mission_control* mc) {
+  long i;
+  free(mc->pairs);
+  mc->pairs_size *= 2;
+  mc->pairs = new_hash_table(mc->pairs_size);
+  for(i=0; i<mc->n_results; i++)
+    mc->pairs[find_pair_slot(mc, mc->results[i].from_node_id, mc->results[i].to_node_id)] = i;
+}
+
+static void resize_from_nodes(struct mission_control* mc) {
+  long i, slot, old_size, *old_from_nodes, *old_from_heads;
+  old_size = mc->from_nodes_size;
+  old_from_nodes = mc->from_nodes;
+  old_from_heads = mc->from_heads;
+  mc->from_nodes_size *= 2;
+  mc->from_nodes = new_hash_table(mc->from_nodes_size);
+  mc->from_heads = new_hash_table(mc->from_nodes_size);
+  for(i=0; i<old_size; i++) {
+    if(old_from_nodes[i] == -1) continue;
+    slot = find_from_node_slot(mc, old_from_nodes[i]);
+    mc->from_nodes[slot] = old_from_nodes[i];
+    mc->from_heads[slot] = old_from_heads[i];
+  }
+  free(old_from_nodes);
+  free(old_from_heads);
+}
+
+/* return the result of the node pair, NULL if the sender never observed it.
+   The returned pointer is valid until the next `mission_control_add` */
+struct node_pair_result* mission_control_get(struct mission_control* mc, long from_node_id, long to_node_id) {
+  long result_index;
+  if(mc == NULL) return NULL;
+  result_index = mc->pairs[find_pair_slot(mc, from_node_id, to_node_id)];
+  return result_index == -1 ? NULL : &(mc->results[result_index]);
+}
+
+/* add a new (zeroed) result for a node pair which is not yet in the store */
+struct node_pair_result* mission_control_add(struct mission_control* mc, long from_node_id, long to_node_id) {
+  long result_index, slot;
+  struct node_pair_result* result;
+
+  if(mc->n_results >= mc->results_size) {
+    mc->results_size *= 2;
+    mc->results = realloc(mc->results, sizeof(struct node_pair_result)*mc->results_size);
+    mc->next_result = realloc(mc->next_result, sizeof(long)*mc->results_size);
+    if(mc->results == NULL || mc->next_result == NULL) {
+      fprintf(stderr, "ERROR: realloc failed for mission control\n");
+      exit(-1);
+    }
+  }
+  if(2*(mc->n_results+1) > mc->pairs_size)
+    resize_pairs(mc);
+  if(2*(mc->n_from_nodes+1) > mc->from_nodes_size)
+    resize_from_nodes(mc);
+
+  result_index = mc->n_results++;
+  result = &(mc->results[result_index]);
+  result->from_node_id = from_node_id;
+  result->to_node_id = to_node_id;
+  result->fail_time = 0;
+  result->fail_amount = 0;
+  result->success_time = 0;
+  result->success_amount = 0;
+  mc->pairs[find_pair_slot(mc, from_node_id, to_node_id)] = result_index;
+
+  slot = find_from_node_slot(mc, from_node_id);
+  if(mc->from_nodes[slot] == -1) {
+    mc->from_nodes[slot] = from_node_id;
+    mc->n_from_nodes++;
+  }
+  mc->next_result[result_index] = mc->from_heads[slot];
+  mc->from_heads[slot] = result_index;
+
+  return result;
+}
+
+/* index of the most recently added result of `from_node_id` (-1 if none); the others follow through `next_result` */
+long mission_control_first(struct mission_control* mc, long from_node_id) {
+  if(mc == NULL) return -1;
+  return mc->from_heads[find_from_node_slot(mc, from_node_id)];
+}
+
+void mission_control_free(struct mission_control* mc) {
+  if(mc == NULL) return;
+  free(mc->results);
+  free(mc->next_result);
+  free(mc->pairs);
+  free(mc->from_nodes);
+  free(mc->from_heads);
+  free(mc);
+}
@@ -6,14 +6,24 @@
 #include "../include/array.h"
 #include "../include/utils.h"
 #include "../include/event.h"
+#include "../include/output.h"
+#include "../include/snapshot.h"
+#include "../include/csv_reader.h"
+#include "../include/thread_pool.h"
 
 /* Functions in this file generate a payment-channel network where to simulate the execution of payments */
 
+uint64_t network_version=0;
+long channel_update_history_size=16;
+
+/* raw trace of the locked balances (see `locked_balance_trace` in cloth_input.txt), NULL if disabled */
+static struct output_file* csv_locked_balance_trace = NULL;
+
 struct node* new_node(long id) {
   struct node* node = (struct node*)malloc(sizeof(struct node));
   node->id = id;
   node->open_edges = array_initialize(10);
-  node->results = NULL;
+  node->mission_control = NULL;
   node->explored = 0;
   return node;
 }
@@ -30,39 +40,84 @@ struct channel* new_channel(long id, long direction1, long direction2, long node
   return channel;
 }
 
+/* storage of the hot and cold fields of the edges (see `struct edge_store`); it grows as edges are created */
+struct edge_store* new_edge_store(long size) {
+  struct edge_store* store = (struct edge_store*)malloc(sizeof(struct edge_store));
+  store->size = size;
+  store->balance = (uint64_t*)malloc(sizeof(uint64_t)*size);
+  store->group = (struct group**)malloc(sizeof(struct group*)*size);
+  store->tot_flows = (uint64_t*)malloc(sizeof(uint64_t)*size);
+  store->htlc_maximum_msat = (uint64_t*)malloc(sizeof(uint64_t)*size);
+  store->cold = (struct edge_cold*)malloc(sizeof(struct edge_cold)*size);
+  return store;
+}
+
+void resize_edge_store(struct edge_store* store, long min_size) {
+  long size = store->size;
+  while(size < min_size) size *= 2;
+  store->size = size;
+  store->balance = (uint64_t*)realloc(store->balance, sizeof(uint64_t)*size);
+  store->group = (struct group**)realloc(store->group, sizeof(struct group*)*size);
+  store->tot_flows = (uint64_t*)realloc(store->tot_flows, sizeof(uint64_t)*size);
+  store->htlc_maximum_msat = (uint64_t*)realloc(store->htlc_maximum_msat, sizeof(uint64_t)*size);
+  store->cold = (struct edge_cold*)realloc(store->cold, sizeof(struct edge_cold)*size);
+  if(store->balance == NULL || store->group == NULL || store->tot_flows == NULL || store->htlc_maximum_msat == NULL || store->cold == NULL) {
+    fprintf(stderr, "ERROR: realloc failed for edge store\n");
+    exit(-1);
+  }
+}
+
+void free_edge_store(struct edge_store* store) {
+  if(store == NULL) return;
+  free(store->balance);
+  free(store->group);
+  free(store->tot_flows);
+  free(store->htlc_maximum_msat);
+  free(store->cold);
+  free(store);
+}
+
 /* one directional edge of a channel */
-struct edge* new_edge(long id, long channel_id, long counter_edge_id,
+struct edge* new_edge(struct edge_store* store, long id, long channel_id, long counter_edge_id,
                       long from_node_id, long to_node_id,
                       uint64_t balance, struct policy policy,
                       uint64_t channel_capacity){
   struct edge* edge = (struct edge*)malloc(sizeof(struct edge));
+  struct edge_cold* cold;
   edge->id = id;
+  edge->store = store;
   edge->channel_id = channel_id;
   edge->from_node_id = from_node_id;
   edge->to_node_id = to_node_id;
   edge->counter_edge_id = counter_edge_id;
   edge->policy = policy;
-  edge->balance = balance;
   edge->is_closed = 0;
-  edge->tot_flows = 0;
-  edge->group = NULL;
 
-  struct channel_update* channel_update = (struct channel_update*)malloc(sizeof(struct channel_update));
-  channel_update->htlc_maximum_msat = channel_capacity;
-  channel_update->edge_id = edge->id;
-  channel_update->time = 0;
-  edge->channel_updates = push(NULL, channel_update);
-  edge->edge_locked_balance_and_durations = NULL;
+  if(id >= store->size)
+    resize_edge_store(store, id + 1);
+  store->balance[id] = balance;
+  store->group[id] = NULL;
+  store->tot_flows[id] = 0;
+
+  cold = &(store->cold[id]);
+  cold->channel_updates.initial.htlc_maximum_msat = channel_capacity;
+  cold->channel_updates.initial.edge_id = edge->id;
+  cold->channel_updates.initial.time = 0;
+  cold->channel_updates.ring = NULL;
+  cold->channel_updates.n_updates = 0;
+  store->htlc_maximum_msat[id] = channel_capacity;
+  memset(&(cold->locked_stats), 0, sizeof(struct edge_locked_stats));
+  cold->version = 0;
 
   /* initialize leave/rejoin related fields */
-  edge->join_time       = 0;     /* set when the edge actually joins a group */
-  edge->flows_at_join   = 0;     /* snapshot of tot_flows at join_time */
-  edge->tolerance_tau   = 0.10;  /* default tolerance */
-  edge->last_leave_time = 0;     /* updated when leaving a group */
+  cold->join_time       = 0;     /* set when the edge actually joins a group */
+  cold->flows_at_join   = 0;     /* snapshot of tot_flows at join_time */
+  cold->tolerance_tau   = 0.10;  /* default tolerance */
+  cold->last_leave_time = 0;     /* updated when leaving a group */
 
   /* initialize min-cap usage counter */
-  edge->min_cap_use_count = 0;
-  edge->in_group_add_queue = 0;
+  cold->min_cap_use_count = 0;
+  cold->in_group_add_queue = 0;
 
   return edge;
 }
@@ -115,7 +170,7 @@ void write_network_files(struct network* network){
     edge = array_get(network->edges, i);
     fprintf(edges_output_file, "%ld,%ld,%ld,%ld,%ld,%" PRIu64 ",%ld,%ld,%" PRIu64 ",%d\n",
             edge->id, edge->channel_id, edge->counter_edge_id, edge->from_node_id, edge->to_node_id,
-            (uint64_t)edge->balance,
+            (uint64_t)edge_get_balance(edge),
             (long)(edge->policy).fee_base, (long)(edge->policy).fee_proportional,
             (uint64_t)(edge->policy).min_htlc, (int)(edge->policy).timelock);
   }
@@ -168,9 +223,9 @@ void generate_random_channel(struct channel channel_data, uint64_t mean_channel_
   edge2_policy.min_htlc = gsl_pow_int(10, gsl_ran_discrete(random_generator, min_htlc_discrete));
   edge2_policy.min_htlc = edge2_policy.min_htlc == 1 ? 0 : edge2_policy.min_htlc;
 
-  edge1 = new_edge(channel_data.edge1, channel_data.id, channel_data.edge2,
+  edge1 = new_edge(network->edge_store, channel_data.edge1, channel_data.id, channel_data.edge2,
                    channel_data.node1, channel_data.node2, edge1_balance, edge1_policy, channel_data.capacity);
-  edge2 = new_edge(channel_data.edge2, channel_data.id, channel_data.edge1,
+  edge2 = new_edge(network->edge_store, channel_data.edge2, channel_data.id, channel_data.edge1,
                    channel_data.node2, channel_data.node1, edge2_balance, edge2_policy, channel_data.capacity);
 
   network->channels = array_insert(network->channels, channel);
@@ -210,9 +265,11 @@ struct network* generate_random_network(struct network_params net_params, gsl_rn
   }
 
   network = (struct network*) malloc(sizeof(struct network));
+  network->faulty_node_prob = NULL;
   network->nodes = array_initialize(1000);
   network->channels = array_initialize(1000);
   network->edges = array_initialize(2000);
+  network->edge_store = new_edge_store(2000);
 
   fgets(row, 256, nodes_input_file);
   while(fgets(row, 256, nodes_input_file)!=NULL) {
@@ -287,97 +344,118 @@ struct network* generate_random_network(struct network_params net_params, gsl_rn
   return network;
 }
 
-/* generate a payment-channel network from input files */
-struct network* generate_network_from_files(char nodes_filename[256], char channels_filename[256], char edges_filename[256]) {
-  char row[2048];
+/* the id in a column of a row of the network csv files must be the id of an existing node, channel or edge */
+static void check_csv_id(struct csv_table* table, long row, long column, long n, char filename[], const char* what) {
+  long id = csv_get_long(table, row, column);
+  if(id < 0 || id >= n) {
+    fprintf(stderr, "ERROR: wrong %s <%ld> at line %ld of file <%s>, it does not exist\n", what, id, table->lines[row], filename);
+    exit(-1);
+  }
+}
+
+/* generate a payment-channel network from input files, which are parsed in parallel by `n_threads` threads */
+struct network* generate_network_from_files(char nodes_filename[256], char channels_filename[256], char edges_filename[256], long n_threads) {
   struct node* node;
-  long id, direction1, direction2, node_id1, node_id2, channel_id, other_direction;
+  long i, row, channel_id, *node_rows, *channel_rows, *edge_rows, *n_open_edges;
   struct policy policy;
-  uint64_t capacity, balance;
   struct channel* channel;
   struct edge* edge;
   struct network* network;
-  FILE *nodes_file, *channels_file, *edges_file;
+  struct csv_table *nodes_table, *channels_table, *edges_table;
 
-  nodes_file = fopen(nodes_filename, "r");
-  if(nodes_file==NULL) {
-    fprintf(stderr, "ERROR: cannot open file <%s>\n", nodes_filename);
-    exit(-1);
-  }
-  channels_file = fopen(channels_filename, "r");
-  if(channels_file==NULL) {
-    fprintf(stderr, "ERROR: cannot open file <%s>\n", channels_filename);
-    fclose(nodes_file);
-    exit(-1);
-  }
-  edges_file = fopen(edges_filename, "r");
-  if(edges_file==NULL) {
-    fprintf(stderr, "ERROR: cannot open file <%s>\n", edges_filename);
-    fclose(nodes_file);
-    fclose(channels_file);
-    exit(-1);
-  }
+  nodes_table = read_csv_file(nodes_filename, 1, n_threads);
+  channels_table = read_csv_file(channels_filename, 6, n_threads);
+  edges_table = read_csv_file(edges_filename, 10, n_threads);
+  node_rows = csv_rows_in_id_order(nodes_table, nodes_filename);
+  channel_rows = csv_rows_in_id_order(channels_table, channels_filename);
+  edge_rows = csv_rows_in_id_order(edges_table, edges_filename);
 
   network = (struct network*) malloc(sizeof(struct network));
-  network->nodes = array_initialize(1000);
-  network->channels = array_initialize(1000);
-  network->edges = array_initialize(2000);
+  network->faulty_node_prob = NULL;
+  network->nodes = array_initialize(nodes_table->n_rows > 0 ? nodes_table->n_rows : 1);
+  network->channels = array_initialize(channels_table->n_rows > 0 ? channels_table->n_rows : 1);
+  network->edges = array_initialize(edges_table->n_rows > 0 ? edges_table->n_rows : 1);
+  network->edge_store = new_edge_store(edges_table->n_rows > 0 ? edges_table->n_rows : 1);
+
+  /* the open edges of each node are allocated at their final size */
+  n_open_edges = calloc(nodes_table->n_rows > 0 ? nodes_table->n_rows : 1, sizeof(long));
+  for(i = 0; i < edges_table->n_rows; i++) {
+    check_csv_id(edges_table, i, 1, channels_table->n_rows, edges_filename, "channel");
+    check_csv_id(edges_table, i, 2, edges_table->n_rows, edges_filename, "edge");
+    check_csv_id(edges_table, i, 3, nodes_table->n_rows, edges_filename, "node");
+    check_csv_id(edges_table, i, 4, nodes_table->n_rows, edges_filename, "node");
+    n_open_edges[csv_get_long(edges_table, i, 3)]++;
+  }
 
-  fgets(row, 2048, nodes_file);
-  while(fgets(row, 2048, nodes_file)!=NULL) {
-    sscanf(row, "%ld", &id);
-    node = new_node(id);
+  for(i = 0; i < nodes_table->n_rows; i++) {
+    node = new_node(i);
+    array_free(node->open_edges);
+    node->open_edges = array_initialize(n_open_edges[i] > 0 ? n_open_edges[i] : 1);
     network->nodes = array_insert(network->nodes, node);
   }
-  fclose(nodes_file);
-
-  fgets(row, 2048, channels_file);
-  while(fgets(row, 2048, channels_file)!=NULL) {
-    sscanf(row, "%ld,%ld,%ld,%ld,%ld,%" SCNu64, &id, &direction1, &direction2, &node_id1, &node_id2, &capacity);
-    channel = new_channel(id, direction1, direction2, node_id1, node_id2, capacity);
+  free(n_open_edges);
+
+  for(i = 0; i < channels_table->n_rows; i++) {
+    row = channel_rows[i];
+    check_csv_id(channels_table, row, 1, edges_table->n_rows, channels_filename, "edge");
+    check_csv_id(channels_table, row, 2, edges_table->n_rows, channels_filename, "edge");
+    check_csv_id(channels_table, row, 3, nodes_table->n_rows, channels_filename, "node");
+    check_csv_id(channels_table, row, 4, nodes_table->n_rows, channels_filename, "node");
+    channel = new_channel(i, csv_get_long(channels_table, row, 1), csv_get_long(channels_table, row, 2), csv_get_long(channels_table, row, 3),
+                          csv_get_long(channels_table, row, 4), csv_get(channels_table, row, 5));
     network->channels = array_insert(network->channels, channel);
   }
-  fclose(channels_file);
 
-  fgets(row, 2048, edges_file);
-  while(fgets(row, 2048, edges_file)!=NULL) {
-    sscanf(row, "%ld,%ld,%ld,%ld,%ld,%" SCNu64 ",%ld,%ld,%" SCNu64 ",%d",
-           &id, &channel_id, &other_direction, &node_id1, &node_id2, &balance,
-           &policy.fee_base, &policy.fee_proportional, &policy.min_htlc, &policy.timelock);
+  for(i = 0; i < edges_table->n_rows; i++) {
+    row = edge_rows[i];
+    channel_id = csv_get_long(edges_table, row, 1);
+    policy.fee_base = csv_get(edges_table, row, 6);
+    policy.fee_proportional = csv_get(edges_table, row, 7);
+    policy.min_htlc = csv_get(edges_table, row, 8);
+    policy.timelock = (uint32_t) csv_get(edges_table, row, 9);
     channel = array_get(network->channels, channel_id);
-    edge = new_edge(id, channel_id, other_direction, node_id1, node_id2, balance, policy, channel->capacity);
+    edge = new_edge(network->edge_store, i, channel_id, csv_get_long(edges_table, row, 2), csv_get_long(edges_table, row, 3),
+                    csv_get_long(edges_table, row, 4), csv_get(edges_table, row, 5), policy, channel->capacity);
     network->edges = array_insert(network->edges, edge);
-    node = array_get(network->nodes, node_id1);
+    node = array_get(network->nodes, edge->from_node_id);
     node->open_edges = array_insert(node->open_edges, &(edge->id));
   }
-  fclose(edges_file);
+
+  free(node_rows);
+  free(channel_rows);
+  free(edge_rows);
+  free_csv_table(nodes_table);
+  free_csv_table(channels_table);
+  free_csv_table(edges_table);
 
   return network;
 }
 
-struct network* initialize_network(struct network_params net_params, gsl_rng* random_generator) {
-  struct network* network;
+/* set the parameters of the simulation which do not change the generated network */
+void set_network_params(struct network* network, struct network_params net_params) {
   double faulty_prob[2];
-  long n_nodes;
-  long i, j;
-  struct node* node;
 
-  if(net_params.network_from_file)
-    network = generate_network_from_files(net_params.nodes_filename, net_params.channels_filename, net_params.edges_filename);
-  else
-    network = generate_random_network(net_params, random_generator);
+  channel_update_history_size = net_params.channel_update_history > 0 ? net_params.channel_update_history : 1;
 
+  /* the table of a previous simulation of the same network (parameter sweep) is replaced */
+  if(network->faulty_node_prob != NULL)
+    gsl_ran_discrete_free(network->faulty_node_prob);
   faulty_prob[0] = 1 - net_params.faulty_node_prob;
   faulty_prob[1] = net_params.faulty_node_prob;
   network->faulty_node_prob = gsl_ran_discrete_preproc(2, faulty_prob);
+}
 
-  n_nodes = array_len(network->nodes);
-  for(i = 0; i < n_nodes; i++){
-    node = array_get(network->nodes, i);
-    node->results = (struct element**) malloc(n_nodes * sizeof(struct element*));
-    for(j = 0; j < n_nodes; j++)
-      node->results[j] = NULL;
-  }
+struct network* initialize_network(struct network_params net_params, gsl_rng* random_generator) {
+  struct network* network;
+
+  if(net_params.network_from_file && net_params.network_snapshot_filename[0] != '\0')
+    network = load_network_snapshot(net_params.network_snapshot_filename);
+  else if(net_params.network_from_file)
+    network = generate_network_from_files(net_params.nodes_filename, net_params.channels_filename, net_params.edges_filename, get_n_threads(net_params.n_threads));
+  else
+    network = generate_random_network(net_params, random_generator);
+
+  set_network_params(network, net_params);
 
   network->groups = array_initialize(1000);
 
@@ -416,11 +494,12 @@ int update_group(struct group* group, struct network_params net_params, uint64_t
     struct edge* e = array_get(group->edges, i);
     if (!e) { close_flg = 1; continue; }
 
-    if (e->balance < min) min = e->balance;
-    if (e->balance > max) max = e->balance;
+    uint64_t balance = edge_get_balance(e);
+    if (balance < min) min = balance;
+    if (balance > max) max = balance;
 
-    if (e->balance < group->min_cap_limit) rv_lo++;
-    if (e->balance > group->max_cap_limit) rv_hi++;
+    if (balance < group->min_cap_limit) rv_lo++;
+    if (balance > group->max_cap_limit) rv_hi++;
   }
 
   /* 異常系（空など） */
@@ -460,6 +539,7 @@ int update_group(struct group* group, struct network_params net_params, uint64_t
   } else {
     group->group_cap = group->min_cap_limit;
   }
+  group->version = ++network_version;
 
   /* update_group ログ（レンジ逸脱は reason に記録するだけ。close はしない） */
   if (net_params.enable_group_event_csv && csv_group_events && group->id >= 0) {
@@ -477,10 +557,11 @@ int update_group(struct group* group, struct network_params net_params, uint64_t
   struct group_update* group_update = (struct group_update*)malloc(sizeof(struct group_update));
   group_update->group_cap = group->group_cap;
   group_update->time = current_time;
+  group_update->n_edges = m;
   group_update->edge_balances = (uint64_t*)malloc(sizeof(uint64_t) * (m > 0 ? m : 1));
   for (long i = 0; i < m; i++) {
     struct edge* e = array_get(group->edges, i);
-    group_update->edge_balances[i] = e ? e->balance : 0;
+    group_update->edge_balances[i] = e ? edge_get_balance(e) : 0;
   }
   group->history = push(group->history, group_update);
 
@@ -488,7 +569,7 @@ int update_group(struct group* group, struct network_params net_params, uint64_t
 }
 
 long get_edge_balance(struct edge* e){
-    return (long)e->balance;
+    return (long)edge_get_balance(e);
 }
 
 /* safely remove an edge from a group's member list */
@@ -509,12 +590,12 @@ void remove_edge_from_group(struct group* g, struct edge* e){
 struct edge_snapshot* take_edge_snapshot(struct edge* e, uint64_t sent_amt, short is_in_group, uint64_t group_cap) {
     struct edge_snapshot* snapshot = (struct edge_snapshot*)malloc(sizeof(struct edge_snapshot));
     snapshot->id = e->id;
-    snapshot->balance = e->balance;
+    snapshot->balance = edge_get_balance(e);
     snapshot->sent_amt = sent_amt;
     snapshot->is_in_group = is_in_group;
     snapshot->group_cap = group_cap;
-    if(e->channel_updates != NULL) {
-        struct channel_update* cu = e->channel_updates->data;
+    if(channel_updates_len(e) > 0) {
+        struct channel_update* cu = get_channel_update(e, channel_updates_len(e) - 1);
         snapshot->does_channel_update_exist = 1;
         snapshot->last_channle_update_value = cu->htlc_maximum_msat;
     } else {
@@ -532,9 +613,7 @@ void free_network(struct network* network){
         struct node* n = array_get(network->nodes, i);
         if(!n) continue;
         array_free(n->open_edges);
-        for(struct element* iterator = (struct element *) n->results; iterator != NULL; iterator = iterator->next){
-            list_free(iterator->data);
-        }
+        mission_control_free(n->mission_control);
         free(n);
     }
 
@@ -542,10 +621,10 @@ void free_network(struct network* network){
     for(uint64_t i = 0; i < (uint64_t)array_len(network->edges); i++){
         struct edge* e = array_get(network->edges, i);
         if(!e) continue;
-        list_free(e->channel_updates);
-        list_free(e->edge_locked_balance_and_durations);
+        free(edge_cold(e)->channel_updates.ring);
         free(e);
     }
+    free_edge_store(network->edge_store);
 
     /* channels */
     for(uint64_t i = 0; i < (uint64_t)array_len(network->channels); i++){
@@ -568,6 +647,8 @@ void free_network(struct network* network){
     array_free(network->channels);
     array_free(network->groups);
 
+    if(network->faulty_node_prob != NULL)
+        gsl_ran_discrete_free(network->faulty_node_prob);
     free(network);
 }
 
@@ -594,4 +675,89 @@ void group_close_once(struct simulation* sim,struct group* g,const char* reason)
 
   /* 状態を close 済みにマーク（以降の重複発火を抑止） */
   g->is_closed = sim->current_time;
-}
\ No newline at end of file
+  g->version = ++network_version;
+}
+
+
+/* CHANNEL UPDATES */
+
+/* record a channel update of an edge and update the capacity estimated for it by the channel_update routing method:
+   the newest update lower than the channel capacity (the initial update) or, if there is none, the first update received */
+void add_channel_update(struct edge* edge, uint64_t htlc_maximum_msat, uint64_t time) {
+  struct channel_update_history* history;
+  struct channel_update* channel_update;
+
+  history = &(edge_cold(edge)->channel_updates);
+  if(history->ring == NULL) {
+    history->ring = malloc(sizeof(struct channel_update)*channel_update_history_size);
+    if(history->ring == NULL) {
+      fprintf(stderr, "ERROR: malloc failed for channel updates\n");
+      exit(-1);
+    }
+  }
+  channel_update = &(history->ring[history->n_updates % channel_update_history_size]);
+  channel_update->edge_id = edge->id;
+  channel_update->time = time;
+  channel_update->htlc_maximum_msat = htlc_maximum_msat;
+
+  if(htlc_maximum_msat < history->initial.htlc_maximum_msat || history->n_updates == 0)
+    edge->store->htlc_maximum_msat[edge->id] = htlc_maximum_msat;
+  history->n_updates++;
+  edge_cold(edge)->version = ++network_version;
+}
+
+/* number of channel updates of an edge which are kept: the initial one and the most recent ones */
+long channel_updates_len(struct edge* edge) {
+  struct channel_update_history* history = &(edge_cold(edge)->channel_updates);
+  return 1 + (history->n_updates < channel_update_history_size ? history->n_updates : channel_update_history_size);
+}
+
+/* the i-th channel update of an edge which is kept, from the oldest (the initial one) to the newest */
+struct channel_update* get_channel_update(struct edge* edge, long i) {
+  struct channel_update_history* history = &(edge_cold(edge)->channel_updates);
+  long first;
+  if(i == 0)
+    return &(history->initial);
+  first = history->n_updates < channel_update_history_size ? 0 : history->n_updates - channel_update_history_size;
+  return &(history->ring[(first + i - 1) % channel_update_history_size]);
+}
+
+/* LOCKED BALANCE STATISTICS */
+
+void locked_balance_trace_open(const char* dirpath) {
+  char path[1024];
+  if(csv_locked_balance_trace) return;
+  snprintf(path, sizeof(path), "%s/locked_balance_trace.csv", (dirpath && dirpath[0] != '\0') ? dirpath : ".");
+  csv_locked_balance_trace = output_open(path, output_writer);
+  if(csv_locked_balance_trace == NULL) {
+    fprintf(stderr, "ERROR: cannot open locked_balance_trace.csv\n");
+    exit(-1);
+  }
+  output_printf(csv_locked_balance_trace, "edge_id,locked_balance,locked_start_time,locked_end_time\n");
+}
+
+void locked_balance_trace_close(void) {
+  if(csv_locked_balance_trace == NULL) return;
+  output_close(csv_locked_balance_trace);
+  csv_locked_balance_trace = NULL;
+}
+
+/* account the balance locked in an edge by an HTLC from its forwarding to its settlement:
+   the statistics of the edge are updated in place and, if the raw trace is enabled, the lock is appended to it */
+void record_locked_balance(struct edge* edge, uint64_t locked_balance, uint64_t locked_start_time, uint64_t locked_end_time) {
+  struct edge_locked_stats* stats;
+  uint64_t balance_duration;
+  int bucket;
+
+  balance_duration = locked_balance * (locked_end_time - locked_start_time);
+  stats = &(edge_cold(edge)->locked_stats);
+  stats->count++;
+  stats->sum_balance_duration += balance_duration;
+  if(balance_duration > stats->max_balance_duration)
+    stats->max_balance_duration = balance_duration;
+  for(bucket = 0; bucket < LOCKED_HISTOGRAM_BUCKETS-1 && (balance_duration >> (4*(bucket+1))) != 0; bucket++);
+  stats->histogram[bucket]++;
+
+  if(csv_locked_balance_trace)
+    output_printf(csv_locked_balance_trace, "%ld,%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n", edge->id, locked_balance, locked_start_time, locked_end_time);
+}
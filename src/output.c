@@ -0,0 +1,235 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <sched.h>
+#include "../include/output.h"
+
+/* Functions in this file implement the buffered output files and the thread writing them (see `struct output_writer`) */
+
+struct output_writer* output_writer=NULL;
+
+/* the running writer and the files not closed yet, written by `output_flush_at_exit` */
+static struct output_writer* running_writer = NULL;
+static struct output_file* open_files = NULL;
+static pthread_mutex_t open_files_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int is_exit_flush_registered = 0;
+
+static void write_chunk(struct output_file* out, char* data, size_t len) {
+  if(len > 0 && fwrite(data, 1, len, out->file) != len) {
+    fprintf(stderr, "ERROR: cannot write an output file\n");
+    exit(-1);
+  }
+}
+
+static void close_file(struct output_file* out) {
+  fclose(out->file);
+  free(out);
+}
+
+static void* output_writer_thread(void* arg) {
+  struct output_writer* writer = (struct output_writer*) arg;
+  struct output_chunk* next;
+
+  while(1) {
+    sem_wait(&(writer->available));
+    /* a chunk was pushed: its producer may have not linked it to the queue yet */
+    while((next = atomic_load(&(writer->head->next))) == NULL)
+      sched_yield();
+    free(writer->head);
+    writer->head = next;
+
+    if(next->file == NULL)
+      break;
+    write_chunk(next->file, next->data, next->len);
+    free(next->data);
+    next->data = NULL;
+    if(next->close)
+      close_file(next->file);
+    sem_post(&(writer->free_slots));
+  }
+
+  return NULL;
+}
+
+static void push_chunk(struct output_writer* writer, struct output_file* file, char* data, size_t len, int close) {
+  struct output_chunk* chunk, *prev;
+
+  sem_wait(&(writer->free_slots));
+  chunk = malloc(sizeof(struct output_chunk));
+  if(chunk == NULL) {
+    fprintf(stderr, "ERROR: malloc failed for output chunk\n");
+    exit(-1);
+  }
+  chunk->file = file;
+  chunk->data = data;
+  chunk->len = len;
+  chunk->close = close;
+  atomic_init(&(chunk->next), NULL);
+
+  prev = atomic_exchange(&(writer->tail), chunk);
+  atomic_store(&(prev->next), chunk);
+  sem_post(&(writer->available));
+}
+
+struct output_writer* output_writer_initialize(void) {
+  struct output_writer* writer;
+  struct output_chunk* stub;
+
+  writer = malloc(sizeof(struct output_writer));
+  stub = malloc(sizeof(struct output_chunk));
+  if(writer == NULL || stub == NULL) {
+    fprintf(stderr, "ERROR: malloc failed for output writer\n");
+    exit(-1);
+  }
+  stub->file = NULL;
+  stub->data = NULL;
+  stub->len = 0;
+  stub->close = 0;
+  atomic_init(&(stub->next), NULL);
+  writer->head = stub;
+  atomic_init(&(writer->tail), stub);
+  sem_init(&(writer->available), 0, 0);
+  sem_init(&(writer->free_slots), 0, OUTPUT_MAX_PENDING_CHUNKS);
+
+  if(pthread_create(&(writer->tid), NULL, output_writer_thread, writer) != 0) {
+    fprintf(stderr, "ERROR: cannot create the output writer thread\n");
+    exit(-1);
+  }
+  running_writer = writer;
+  return writer;
+}
+
+/* wait for the chunks already pushed to be written and stop the writer */
+void output_writer_free(struct output_writer* writer) {
+  if(writer == NULL) return;
+  if(writer == running_writer)
+    running_writer = NULL;
+  push_chunk(writer, NULL, NULL, 0, 0);
+  pthread_join(writer->tid, NULL);
+  free(writer->head);
+  sem_destroy(&(writer->available));
+  sem_destroy(&(writer->free_slots));
+  free(writer);
+}
+
+static char* new_buffer(size_t size) {
+  char* buffer = malloc(size);
+  if(buffer == NULL) {
+    fprintf(stderr, "ERROR: malloc failed for output buffer\n");
+    exit(-1);
+  }
+  return buffer;
+}
+
+/* write the output not written yet when the program exits without closing its output files (e.g. after an error):
+   the writer writes its pending chunks and stops, then the buffers of the open files are written directly */
+static void output_flush_at_exit(void) {
+  struct output_file* out;
+
+  /* an error of the writer thread itself: its queue cannot be drained */
+  if(running_writer != NULL && pthread_equal(pthread_self(), running_writer->tid))
+    return;
+  output_writer_free(running_writer);
+
+  pthread_mutex_lock(&open_files_mutex);
+  for(out = open_files; out != NULL; out = out->next_open) {
+    if(out->len > 0)
+      fwrite(out->buffer, 1, out->len, out->file);
+    fclose(out->file);
+  }
+  open_files = NULL;
+  pthread_mutex_unlock(&open_files_mutex);
+}
+
+static void remove_open_file(struct output_file* out) {
+  pthread_mutex_lock(&open_files_mutex);
+  if(out->prev_open != NULL)
+    out->prev_open->next_open = out->next_open;
+  else
+    open_files = out->next_open;
+  if(out->next_open != NULL)
+    out->next_open->prev_open = out->prev_open;
+  pthread_mutex_unlock(&open_files_mutex);
+}
+
+struct output_file* output_open(const char* filename, struct output_writer* writer) {
+  struct output_file* out;
+  FILE* file;
+
+  file = fopen(filename, "w");
+  if(file == NULL)
+    return NULL;
+  out = malloc(sizeof(struct output_file));
+  out->file = file;
+  out->writer = writer;
+  out->size = OUTPUT_BUFFER_SIZE;
+  out->buffer = new_buffer(out->size);
+  out->len = 0;
+
+  pthread_mutex_lock(&open_files_mutex);
+  if(!is_exit_flush_registered) {
+    atexit(output_flush_at_exit);
+    is_exit_flush_registered = 1;
+  }
+  out->prev_open = NULL;
+  out->next_open = open_files;
+  if(open_files != NULL)
+    open_files->prev_open = out;
+  open_files = out;
+  pthread_mutex_unlock(&open_files_mutex);
+  return out;
+}
+
+/* hand the text of the buffer to the writer (or write it) and start a new buffer of at least `min_size` bytes */
+static void output_flush_buffer(struct output_file* out, size_t min_size) {
+  if(out->writer != NULL) {
+    push_chunk(out->writer, out, out->buffer, out->len, 0);
+    out->size = min_size > OUTPUT_BUFFER_SIZE ? min_size : OUTPUT_BUFFER_SIZE;
+    out->buffer = new_buffer(out->size);
+  }
+  else {
+    write_chunk(out, out->buffer, out->len);
+    if(min_size > out->size) {
+      free(out->buffer);
+      out->size = min_size;
+      out->buffer = new_buffer(out->size);
+    }
+  }
+  out->len = 0;
+}
+
+int output_printf(struct output_file* out, const char* format, ...) {
+  va_list args, args_copy;
+  int n;
+
+  va_start(args, format);
+  va_copy(args_copy, args);
+  n = vsnprintf(out->buffer + out->len, out->size - out->len, format, args);
+  if(n >= 0 && out->len + n >= out->size) {
+    /* the text does not fit: it is formatted again at the beginning of a new buffer */
+    output_flush_buffer(out, n + 1);
+    n = vsnprintf(out->buffer, out->size, format, args_copy);
+  }
+  va_end(args_copy);
+  va_end(args);
+
+  if(n < 0) {
+    fprintf(stderr, "ERROR: cannot format an output line\n");
+    exit(-1);
+  }
+  out->len += n;
+  return n;
+}
+
+/* the file is closed by the writer after its last chunk, the caller must not use `out` afterwards */
+void output_close(struct output_file* out) {
+  if(out == NULL) return;
+  remove_open_file(out);
+  if(out->writer != NULL)
+    push_chunk(out->writer, out, out->buffer, out->len, 1);
+  else {
+    write_chunk(out, out->buffer, out->len);
+    free(out->buffer);
+    close_file(out);
+  }
+}
@@ -12,6 +12,7 @@
 #include "../include/htlc.h"
 #include "../include/payments.h"
 #include "../include/network.h"
+#include "../include/csv_reader.h"
 
 /* Functions in this file generate the payments that are exchanged in the payment-channel network during the simulation */
 
@@ -38,83 +39,121 @@ struct payment* new_payment(long id, long sender, long receiver, uint64_t amount
   p->shards_id[0] = p->shards_id[1] = -1;
   p->history = NULL;
   p->min_cap_used_edges = NULL;
+  p->speculated_path = NULL;
   p->max_fee_limit = max_fee_limit;
   return p;
 }
 
 
-/* generate random payments and store them in "payments.csv" */
-void generate_random_payments(struct payments_params pay_params, long n_nodes, gsl_rng * random_generator) {
-  long i, sender_id, receiver_id;
-  uint64_t  payment_amount=0, payment_time=1, next_payment_interval, max_fee_limit=UINT64_MAX;
-  long payment_idIndex=0;
-  FILE* payments_file;
+struct payment_generator* new_payment_generator(struct payments_params pay_params, long n_nodes, gsl_rng* random_generator) {
+  struct payment_generator* generator;
 
-  payments_file = fopen("payments.csv", "w");
-  if(payments_file==NULL) {
-    fprintf(stderr, "ERROR: cannot open file payments.csv\n");
-    exit(-1);
-  }
-  fprintf(payments_file, "id,sender_id,receiver_id,amount,start_time,max_fee_limit\n");
-
-  for(i=0;i<pay_params.n_payments;i++) {
-    do{
-      sender_id = gsl_rng_uniform_int(random_generator,n_nodes);
-      receiver_id = gsl_rng_uniform_int(random_generator, n_nodes);
-    } while(sender_id==receiver_id);
-    payment_amount = fabs(pay_params.amount_mu + gsl_ran_ugaussian(random_generator) * pay_params.amount_sigma)*1000.0; // convert satoshi to millisatoshi
-    /* payment interarrival time is an exponential (Poisson process) whose mean is the inverse of payment rate
-       (expressed in payments per second, then multiplied to convert in milliseconds)
-     */
-    next_payment_interval = 1000*gsl_ran_exponential(random_generator, pay_params.inverse_payment_rate);
-    payment_time += next_payment_interval;
-    if(pay_params.max_fee_limit_sigma != -1 && pay_params.max_fee_limit_mu != -1) {
-        max_fee_limit = fabs(pay_params.max_fee_limit_mu + gsl_ran_ugaussian(random_generator) * pay_params.max_fee_limit_sigma)*1000.0; // convert satoshi to millisatoshi
+  generator = malloc(sizeof(struct payment_generator));
+  generator->pay_params = pay_params;
+  generator->n_nodes = n_nodes;
+  generator->random_generator = random_generator;
+  generator->n_generated = 0;
+  generator->payment_time = 1;
+  generator->last_payment = NULL;
+  generator->payments_file = NULL;
+
+  if(pay_params.payments_csv_export) {
+    generator->payments_file = fopen("payments.csv", "w");
+    if(generator->payments_file==NULL) {
+      fprintf(stderr, "ERROR: cannot open file payments.csv\n");
+      exit(-1);
     }
-    fprintf(payments_file, "%ld,%ld,%ld,%ld,%ld,%ld\n", payment_idIndex++, sender_id, receiver_id, payment_amount, payment_time, max_fee_limit);
+    fprintf(generator->payments_file, "id,sender_id,receiver_id,amount,start_time,max_fee_limit\n");
   }
 
-  fclose(payments_file);
+  return generator;
 }
 
-/* generate payments from file */
-struct array* generate_payments(struct payments_params pay_params) {
+/* generate the next random payment, NULL when `n_payments` payments have been generated */
+struct payment* generate_next_payment(struct payment_generator* generator, long id) {
+  long sender_id, receiver_id;
+  uint64_t payment_amount, next_payment_interval, max_fee_limit=UINT64_MAX;
+  struct payments_params pay_params = generator->pay_params;
+  gsl_rng* random_generator = generator->random_generator;
   struct payment* payment;
-  char row[256], payments_filename[256];
-  long id, sender, receiver;
-  uint64_t amount, time, max_fee_limit;
-  struct array* payments;
-  FILE* payments_file;
 
-  if(!(pay_params.payments_from_file))
-    strcpy(payments_filename, "payments.csv");
-  else
-    strcpy(payments_filename, pay_params.payments_filename);
-
-  payments_file = fopen(payments_filename, "r");
-  if(payments_file==NULL) {
-    printf("ERROR: cannot open file <%s>\n", payments_filename);
-    exit(-1);
+  if(generator->n_generated >= pay_params.n_payments)
+    return NULL;
+
+  do{
+    sender_id = gsl_rng_uniform_int(random_generator, generator->n_nodes);
+    receiver_id = gsl_rng_uniform_int(random_generator, generator->n_nodes);
+  } while(sender_id==receiver_id);
+  payment_amount = fabs(pay_params.amount_mu + gsl_ran_ugaussian(random_generator) * pay_params.amount_sigma)*1000.0; // convert satoshi to millisatoshi
+  /* payment interarrival time is an exponential (Poisson process) whose mean is the inverse of payment rate
+     (expressed in payments per second, then multiplied to convert in milliseconds)
+   */
+  next_payment_interval = 1000*gsl_ran_exponential(random_generator, pay_params.inverse_payment_rate);
+  generator->payment_time += next_payment_interval;
+  if(pay_params.max_fee_limit_sigma != -1 && pay_params.max_fee_limit_mu != -1) {
+      max_fee_limit = fabs(pay_params.max_fee_limit_mu + gsl_ran_ugaussian(random_generator) * pay_params.max_fee_limit_sigma)*1000.0; // convert satoshi to millisatoshi
   }
 
-  payments = array_initialize(1000);
+  if(generator->payments_file != NULL)
+    fprintf(generator->payments_file, "%ld,%ld,%ld,%ld,%ld,%ld\n", id, sender_id, receiver_id, payment_amount, generator->payment_time, max_fee_limit);
+
+  payment = new_payment(id, sender_id, receiver_id, payment_amount, generator->payment_time, max_fee_limit);
+  generator->n_generated++;
+  generator->last_payment = payment;
+  return payment;
+}
+
+void free_payment_generator(struct payment_generator* generator) {
+  if(generator == NULL) return;
+  if(generator->payments_file != NULL)
+    fclose(generator->payments_file);
+  free(generator);
+}
+
+/* generate all the random payments before the simulation starts */
+struct array* generate_random_payments(struct payments_params pay_params, long n_nodes, gsl_rng * random_generator) {
+  struct payment_generator* generator;
+  struct payment* payment;
+  struct array* payments;
 
-  fgets(row, 256, payments_file);
-  while(fgets(row, 256, payments_file) != NULL) {
-    sscanf(row, "%ld,%ld,%ld,%"SCNu64",%"SCNu64",%"SCNu64"", &id, &sender, &receiver, &amount, &time, &max_fee_limit);
-    payment = new_payment(id, sender, receiver, amount, time, max_fee_limit);
+  payments = array_initialize(pay_params.n_payments > 0 ? pay_params.n_payments : 1000);
+  generator = new_payment_generator(pay_params, n_nodes, random_generator);
+  while((payment = generate_next_payment(generator, array_len(payments))) != NULL)
+    payments = array_insert(payments, payment);
+  free_payment_generator(generator);
+
+  return payments;
+}
+
+/* read the payments from the input file, which is parsed in parallel by `n_threads` threads */
+struct array* generate_payments(struct payments_params pay_params, long n_threads) {
+  struct payment* payment;
+  long i, row, *payment_rows;
+  struct array* payments;
+  struct csv_table* payments_table;
+
+  payments_table = read_csv_file(pay_params.payments_filename, 6, n_threads);
+  payment_rows = csv_rows_in_id_order(payments_table, pay_params.payments_filename);
+
+  payments = array_initialize(payments_table->n_rows > 0 ? payments_table->n_rows : 1);
+  for(i = 0; i < payments_table->n_rows; i++) {
+    row = payment_rows[i];
+    payment = new_payment(i, csv_get_long(payments_table, row, 1), csv_get_long(payments_table, row, 2), csv_get(payments_table, row, 3),
+                          csv_get(payments_table, row, 4), csv_get(payments_table, row, 5));
     payments = array_insert(payments, payment);
   }
-  fclose(payments_file);
+
+  free(payment_rows);
+  free_csv_table(payments_table);
 
   return payments;
 }
 
 
-struct array* initialize_payments(struct payments_params pay_params, long n_nodes, gsl_rng* random_generator) {
+struct array* initialize_payments(struct payments_params pay_params, long n_nodes, gsl_rng* random_generator, long n_threads) {
   if(!(pay_params.payments_from_file))
-    generate_random_payments(pay_params, n_nodes, random_generator);
-  return generate_payments(pay_params);
+    return generate_random_payments(pay_params, n_nodes, random_generator);
+  return generate_payments(pay_params, n_threads);
 }
 
 void add_attempt_history(struct payment* pmt, struct network* network, uint64_t time, short is_succeeded){
@@ -136,7 +175,7 @@ void add_attempt_history(struct payment* pmt, struct network* network, uint64_t
     struct route_hop* route_hop = array_get(pmt->route->route_hops, i);
     struct edge* edge = array_get(network->edges, route_hop->edge_id);
     short is_in_group = 0;
-    if(edge->group != NULL) is_in_group = 1;
+    if(edge_get_group(edge) != NULL) is_in_group = 1;
     attempt->route = array_insert(attempt->route, take_edge_snapshot(edge, route_hop->amount_to_forward, is_in_group, route_hop->group_cap));
   }
 
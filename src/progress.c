@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "../include/progress.h"
+
+/* Functions in this file report the progress of the simulation (see `struct progress_reporter`) */
+
+#define PROGRESS_TEXT_LEN 9 // "%8.6f\n": the value is in [0,1], so the text has always the same length
+
+static void format_progress(char* text, long completed_payments, long n_payments) {
+  char buffer[32];
+  double value;
+  value = n_payments > 0 ? (double)completed_payments / (double)n_payments : 0.0;
+  if(value > 1.0) value = 1.0;
+  snprintf(buffer, sizeof(buffer), "%8.6f\n", value);
+  memcpy(text, buffer, PROGRESS_TEXT_LEN);
+}
+
+static void map_progress_file(struct progress_reporter* progress) {
+  int fd;
+  fd = open(progress->filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if(fd == -1 || ftruncate(fd, PROGRESS_TEXT_LEN) == -1) {
+    fprintf(stderr, "WARNING: cannot map <%s>, progress is written with fopen\n", progress->filename);
+    if(fd != -1) close(fd);
+    progress->use_mmap = 0;
+    return;
+  }
+  progress->mapped = mmap(NULL, PROGRESS_TEXT_LEN, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(progress->mapped == MAP_FAILED) {
+    fprintf(stderr, "WARNING: cannot map <%s>, progress is written with fopen\n", progress->filename);
+    progress->mapped = NULL;
+    progress->use_mmap = 0;
+  }
+}
+
+struct progress_reporter* progress_initialize(const char* output_dir_name, long every_events, double every_seconds, int use_mmap) {
+  struct progress_reporter* progress;
+  progress = malloc(sizeof(struct progress_reporter));
+  snprintf(progress->filename, sizeof(progress->filename), "%sprogress.tmp", output_dir_name);
+  progress->every_events = every_events;
+  progress->every_seconds = every_seconds;
+  progress->n_events = 0;
+  progress->n_events_since_report = 0;
+  clock_gettime(CLOCK_MONOTONIC, &(progress->last_report));
+  progress->use_mmap = use_mmap;
+  progress->mapped = NULL;
+  if(use_mmap)
+    map_progress_file(progress);
+  progress_write(progress, 0, 1);
+  return progress;
+}
+
+/* to be called after each event of the simulation: the progress is written only when one of the two cadences is reached */
+void progress_event(struct progress_reporter* progress, long completed_payments, long n_payments) {
+  struct timespec now;
+  double elapsed;
+
+  progress->n_events++;
+  progress->n_events_since_report++;
+
+  if(progress->every_events > 0 && progress->n_events_since_report >= progress->every_events) {
+    progress_write(progress, completed_payments, n_payments);
+    return;
+  }
+
+  if(progress->every_seconds > 0 && progress->n_events % PROGRESS_CLOCK_CHECK_EVENTS == 0) {
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    elapsed = (double)(now.tv_sec - progress->last_report.tv_sec) + (double)(now.tv_nsec - progress->last_report.tv_nsec) / 1E9;
+    if(elapsed >= progress->every_seconds)
+      progress_write(progress, completed_payments, n_payments);
+  }
+}
+
+void progress_write(struct progress_reporter* progress, long completed_payments, long n_payments) {
+  char text[PROGRESS_TEXT_LEN];
+  FILE* progress_file;
+
+  format_progress(text, completed_payments, n_payments);
+  if(progress->mapped != NULL) {
+    memcpy(progress->mapped, text, PROGRESS_TEXT_LEN);
+  }
+  else {
+    progress_file = fopen(progress->filename, "w");
+    if(progress_file != NULL) {
+      fwrite(text, 1, PROGRESS_TEXT_LEN, progress_file);
+      fclose(progress_file);
+    }
+  }
+
+  progress->n_events_since_report = 0;
+  if(progress->every_seconds > 0)
+    clock_gettime(CLOCK_MONOTONIC, &(progress->last_report));
+}
+
+void progress_free(struct progress_reporter* progress) {
+  if(progress == NULL) return;
+  if(progress->mapped != NULL)
+    munmap(progress->mapped, PROGRESS_TEXT_LEN);
+  free(progress);
+}
@@ -29,11 +29,16 @@
 
 
 struct distance **distance;
+uint64_t *distance_generation;
+uint64_t **exclude_mark; // exclude_mark[p][edge_id] == exclude_generation[p] if the edge is excluded in the current execution of slot p
+uint64_t *exclude_generation;
 struct heap** distance_heap;
-pthread_mutex_t data_mutex;
-pthread_mutex_t jobs_mutex;
 struct array** paths;
-struct element* jobs=NULL;
+long n_paths=0;
+long n_dijkstra_slots=0;
+struct thread_pool* thread_pool=NULL;
+struct routing_graph* routing_graph=NULL;
+struct route_cache* route_cache=NULL;
 static enum payment_error_type to_payment_error(enum pathfind_error e) {
   switch (e) {
     case NOLOCALBALANCE: return NOBALANCE;     // 送信元残高不足
@@ -43,90 +48,132 @@ static enum payment_error_type to_payment_error(enum pathfind_error e) {
 }
 
 
-/* intialize the data structures of dijkstra and the jobs to be executed by the dijkstra threads */
-void initialize_dijkstra(long n_nodes, long n_edges, struct array* payments) {
-  int i;
-  struct payment *payment;
+/* build the compressed-sparse-row snapshot of the network used by dijkstra;
+   the topology and the policies never change during the simulation, so it is built once */
+struct routing_graph* build_routing_graph(struct network* network) {
+  struct routing_graph* graph;
+  struct node* node;
+  struct edge* edge;
+  struct channel* channel;
+  long i, j, k, *open_edge_id;
 
-  distance = malloc(sizeof(struct distance*)*N_THREADS);
-  distance_heap = malloc(sizeof(struct heap*)*N_THREADS);
-  for(i=0; i<N_THREADS; i++) {
-    distance[i] = malloc(sizeof(struct distance)*n_nodes);
-    distance_heap[i] = heap_initialize(n_edges);
+  graph = malloc(sizeof(struct routing_graph));
+  graph->n_nodes = array_len(network->nodes);
+  graph->n_edges = array_len(network->edges);
+  graph->offsets = malloc(sizeof(long)*(graph->n_nodes+1));
+
+  graph->offsets[0] = 0;
+  for(i=0; i<graph->n_nodes; i++){
+    node = array_get(network->nodes, i);
+    graph->offsets[i+1] = graph->offsets[i] + array_len(node->open_edges);
+  }
+
+  graph->edge_id = malloc(sizeof(long)*graph->offsets[graph->n_nodes]);
+  graph->from_node_id = malloc(sizeof(long)*graph->offsets[graph->n_nodes]);
+  graph->fee_base = malloc(sizeof(uint64_t)*graph->offsets[graph->n_nodes]);
+  graph->fee_proportional = malloc(sizeof(uint64_t)*graph->offsets[graph->n_nodes]);
+  graph->min_htlc = malloc(sizeof(uint64_t)*graph->offsets[graph->n_nodes]);
+  graph->timelock = malloc(sizeof(uint32_t)*graph->offsets[graph->n_nodes]);
+  graph->channel_capacity = malloc(sizeof(uint64_t)*graph->offsets[graph->n_nodes]);
+
+  for(i=0; i<graph->n_nodes; i++){
+    node = array_get(network->nodes, i);
+    for(j=0; j<array_len(node->open_edges); j++){
+      k = graph->offsets[i] + j;
+      open_edge_id = array_get(node->open_edges, j);
+      edge = array_get(network->edges, *open_edge_id);
+      edge = array_get(network->edges, edge->counter_edge_id);
+      channel = array_get(network->channels, edge->channel_id);
+      graph->edge_id[k] = edge->id;
+      graph->from_node_id[k] = edge->from_node_id;
+      graph->fee_base[k] = edge->policy.fee_base;
+      graph->fee_proportional[k] = edge->policy.fee_proportional;
+      graph->min_htlc[k] = edge->policy.min_htlc;
+      graph->timelock[k] = edge->policy.timelock;
+      graph->channel_capacity[k] = channel->capacity;
+    }
   }
 
-  pthread_mutex_init(&data_mutex, NULL);
-  pthread_mutex_init(&jobs_mutex, NULL);
+  return graph;
+}
 
-  paths = malloc(sizeof(struct array*)*array_len(payments));
-  for(i=0; i<array_len(payments) ;i++){
-    paths[i] = NULL;
-    payment = array_get(payments, i);
-    jobs = push(jobs, &(payment->id));
+void free_routing_graph(struct routing_graph* graph) {
+  if(graph == NULL) return;
+  free(graph->offsets);
+  free(graph->edge_id);
+  free(graph->from_node_id);
+  free(graph->fee_base);
+  free(graph->fee_proportional);
+  free(graph->min_htlc);
+  free(graph->timelock);
+  free(graph->channel_capacity);
+  free(graph);
+}
+
+/* intialize the data structures of dijkstra and the pool of dijkstra threads:
+   slot 0 of the dijkstra data structures is used by the simulation thread, slot i+1 by the worker thread i of the pool */
+void initialize_dijkstra(struct network* network, struct array* payments, long n_threads) {
+  long i, n_nodes, n_edges;
+
+  n_nodes = array_len(network->nodes);
+  n_edges = array_len(network->edges);
+  routing_graph = build_routing_graph(network);
+
+  n_dijkstra_slots = n_threads + 1;
+  distance = malloc(sizeof(struct distance*)*n_dijkstra_slots);
+  distance_generation = malloc(sizeof(uint64_t)*n_dijkstra_slots);
+  distance_heap = malloc(sizeof(struct heap*)*n_dijkstra_slots);
+  exclude_mark = malloc(sizeof(uint64_t*)*n_dijkstra_slots);
+  exclude_generation = malloc(sizeof(uint64_t)*n_dijkstra_slots);
+  for(i=0; i<n_dijkstra_slots; i++) {
+    distance[i] = calloc(n_nodes, sizeof(struct distance));
+    distance_generation[i] = 0;
+    distance_heap[i] = heap_initialize(n_edges);
+    exclude_mark[i] = calloc(n_edges, sizeof(uint64_t));
+    exclude_generation[i] = 0;
   }
 
+  thread_pool = thread_pool_initialize(n_threads);
+
+  n_paths = array_len(payments);
+  paths = malloc(sizeof(struct array*)*n_paths);
+  for(i=0; i<n_paths; i++)
+    paths[i] = NULL;
 }
 
-/* a dijkstra thread finds a path for a payment by calling dijkstra */
-void* dijkstra_thread(void* arg) {
-  struct thread_args *thread_args = (struct thread_args*) arg;
+/* a job of the dijkstra threads: find the initial path of the payment with index `job_index` */
+void initial_path_job(long job_index, long thread_index, void* arg) {
+  struct initial_paths_args *args = (struct initial_paths_args*) arg;
   enum pathfind_error pf_err;
+  struct payment *payment;
+  struct array* hops;
 
-  while (1) {
-    void *data = NULL;
-
-    pthread_mutex_lock(&jobs_mutex);
-    if (jobs == NULL) { pthread_mutex_unlock(&jobs_mutex); break; }
-    jobs = pop(jobs, &data);
-    pthread_mutex_unlock(&jobs_mutex);
-    if (data == NULL) break;
-
-    long payment_id = *((long*)data);
-
-    pthread_mutex_lock(&data_mutex);
-    struct payment *payment = array_get(thread_args->payments, payment_id);
-    pthread_mutex_unlock(&data_mutex);
-
-    struct array* hops = dijkstra(
-        payment->sender,
-        payment->receiver,
-        payment->amount,
-        thread_args->network,
-        thread_args->current_time,
-        thread_args->data_index,
-        &pf_err,
-        thread_args->routing_method,
-        NULL,
-        payment->max_fee_limit
-    );
-
-    payment->error.type = to_payment_error(pf_err);
-    paths[payment->id] = hops;
-  }
-  return NULL;
+  payment = array_get(args->payments, job_index);
+  hops = dijkstra(payment->sender, payment->receiver, payment->amount, args->network, args->current_time,
+                  thread_index+1, &pf_err, args->routing_method, NULL, payment->max_fee_limit);
+
+  payment->error.type = to_payment_error(pf_err);
+  paths[payment->id] = hops;
 }
 
 
 /* run dijkstra threads to find the initial paths of the payments (before the simulation starts) */
 void run_dijkstra_threads(struct network*  network, struct array* payments, uint64_t current_time, enum routing_method routing_method) {
-  long i;
-  pthread_t tid[N_THREADS];
-  struct thread_args *thread_args;
-
-  for(i=0; i<N_THREADS; i++) {
-    thread_args = (struct thread_args*) malloc(sizeof(struct thread_args));
-    thread_args->network = network;
-    thread_args->payments = payments;
-    thread_args->current_time = current_time;
-    thread_args->data_index = i;
-    thread_args->routing_method = routing_method;
-    pthread_create(&(tid[i]), NULL, dijkstra_thread, (void*) thread_args);
-   }
-
-  for(i=0; i<N_THREADS; i++) {
-      pthread_join(tid[i], NULL);
-  }
-  free(thread_args);
+  struct initial_paths_args args;
+  long n_jobs, batch_size;
+
+  args.network = network;
+  args.payments = payments;
+  args.current_time = current_time;
+  args.routing_method = routing_method;
+
+  /* a few batches per thread: large enough to make the atomic increments negligible, small enough to balance the load */
+  n_jobs = array_len(payments);
+  batch_size = n_jobs / (thread_pool->n_threads * 8);
+  if(batch_size < 1) batch_size = 1;
+  if(batch_size > 64) batch_size = 64;
+
+  thread_pool_run(thread_pool, n_jobs, batch_size, initial_path_job, &args);
 }
 
 
@@ -149,12 +196,12 @@ double get_weight(double age){
   return pow(2, exp);
 }
 
-double calculate_probability(struct element* node_results, long to_node_id, uint64_t amount, double node_probability, uint64_t current_time){
+double calculate_probability(struct mission_control* mission_control, long from_node_id, long to_node_id, uint64_t amount, double node_probability, uint64_t current_time){
   struct node_pair_result* result;
   uint64_t time_since_last_failure;
   double weight, probability;
 
-  result = get_by_key(node_results, to_node_id, is_equal_key_result);
+  result = mission_control_get(mission_control, from_node_id, to_node_id);
 
   if(result == NULL)
     return node_probability;
@@ -177,20 +224,21 @@ double calculate_probability(struct element* node_results, long to_node_id, uint
 }
 
 
-double get_node_probability(struct element* node_results, uint64_t amount, uint64_t current_time){
+double get_node_probability(struct mission_control* mission_control, long from_node_id, uint64_t amount, uint64_t current_time){
   double apriori_factor, total_probabilities, total_weight;
-  struct element* iterator;
+  long i, first;
   struct node_pair_result* result;
   uint64_t age;
 
-  if(list_len(node_results) == 0)
+  first = mission_control_first(mission_control, from_node_id);
+  if(first == -1)
     return APRIORIHOPPROBABILITY;
 
   apriori_factor = 1.0 / (1.0 - APRIORIWEIGHT) - 1;
   total_probabilities = APRIORIHOPPROBABILITY*apriori_factor;
   total_weight = apriori_factor;
-  for(iterator = node_results; iterator != NULL; iterator = iterator->next){
-    result = (struct node_pair_result*) iterator->data;
+  for(i = first; i != -1; i = mission_control->next_result[i]){
+    result = &(mission_control->results[i]);
     if(amount <= result->success_amount){
       total_weight++;
       total_probabilities += PREVSUCCESSPROBABILITY;
@@ -208,18 +256,16 @@ double get_node_probability(struct element* node_results, uint64_t amount, uint6
 
 double get_probability(long from_node_id, long to_node_id, uint64_t amount, long sender_id, uint64_t current_time,  struct network* network){
   struct node* sender;
-  struct element* results;
   double node_probability;
 
   sender = array_get(network->nodes, sender_id);
-  results = sender->results[from_node_id];
 
   if(from_node_id == sender_id)
     node_probability = PREVSUCCESSPROBABILITY;
   else
-    node_probability = get_node_probability(results, amount, current_time);
+    node_probability = get_node_probability(sender->mission_control, from_node_id, amount, current_time);
 
-  return calculate_probability(results, to_node_id, MAXMILLISATOSHI, node_probability, current_time);
+  return calculate_probability(sender->mission_control, from_node_id, to_node_id, MAXMILLISATOSHI, node_probability, current_time);
 }
 
 // Based on paper "Comparing Lightning Routing Protocols to Routing Protocols with Splitting" section 2.1.
@@ -253,6 +299,28 @@ int compare_distance(struct distance* a, struct distance* b) {
     return 1;
 }
 
+/* position of a distance in the (indexed) distance heap */
+long* get_distance_heap_index(struct distance* d) {
+  return &(d->heap_index);
+}
+
+/* get the distance of a node in the current dijkstra execution of thread `p`;
+   a distance whose generation is older than the current one was not visited yet, so it is reset here (lazily) to INF */
+struct distance* get_distance(long p, long node) {
+  struct distance* d = &(distance[p][node]);
+  if(d->generation != distance_generation[p]) {
+    d->generation = distance_generation[p];
+    d->node = node;
+    d->distance = INF;
+    d->fee = 0;
+    d->amt_to_receive = 0;
+    d->probability = 0;
+    d->next_edge = -1;
+    d->heap_index = -1;
+  }
+  return d;
+}
+
 /* get maximum and total balance of the edges of a node */
 void get_balance(struct node* node, uint64_t *max_balance, uint64_t *total_balance){
   int i;
@@ -262,9 +330,9 @@ void get_balance(struct node* node, uint64_t *max_balance, uint64_t *total_balan
   *max_balance = 0;
   for(i=0; i<array_len(node->open_edges); i++){
     edge = array_get(node->open_edges, i);
-    *total_balance += edge->balance;
-    if(edge->balance > *max_balance)
-      *max_balance = edge->balance;
+    *total_balance += edge_get_balance(edge);
+    if(edge_get_balance(edge) > *max_balance)
+      *max_balance = edge_get_balance(edge);
   }
 }
 
@@ -307,9 +375,9 @@ struct array* get_best_edges(long to_node_id, uint64_t amount, long source_node_
       channel = array_get(network->channels, edge->channel_id);
 
       if(local_node){
-        if(edge->balance < amount || amount < edge->policy.min_htlc || edge->balance < max_balance)
+        if(edge_get_balance(edge) < amount || amount < edge->policy.min_htlc || edge_get_balance(edge) < max_balance)
           continue;
-        max_balance = edge->balance;
+        max_balance = edge_get_balance(edge);
         best_edge = edge;
       }
       else {
@@ -330,7 +398,9 @@ struct array* get_best_edges(long to_node_id, uint64_t amount, long source_node_
     if(!local_node){
       modified_policy = best_edge->policy;
       modified_policy.timelock = max_timelock;
-      new_best_edge = new_edge(best_edge->id, best_edge->channel_id, best_edge->counter_edge_id, best_edge->from_node_id, best_edge->to_node_id, best_edge->balance, modified_policy, channel->capacity);
+      new_best_edge = malloc(sizeof(struct edge));
+      *new_best_edge = *best_edge;
+      new_best_edge->policy = modified_policy;
     }
     else {
       new_best_edge = best_edge;
@@ -353,51 +423,39 @@ double get_edge_weight(uint64_t amount, uint64_t fee, uint32_t timelock){
 
 uint64_t estimate_capacity(struct edge* edge, struct network* network, enum routing_method routing_method){
     struct channel* channel = array_get(network->channels, edge->channel_id);
+    return estimate_edge_capacity(edge->store, edge->id, channel->capacity, routing_method);
+}
 
+/* same as `estimate_capacity`, for callers that already know the capacity of the channel of the edge (see `routing_graph`) */
+uint64_t estimate_edge_capacity(struct edge_store* store, long edge_id, uint64_t channel_capacity, enum routing_method routing_method){
     uint64_t estimated_capacity;
+    struct group* group = store->group[edge_id];
 
     // intermediate edges
     // judge edge has enough capacity by group_capacity (proposed method)
     if(routing_method == GROUP_ROUTING){
-        if(edge->group != NULL){
-            estimated_capacity = edge->group->group_cap;
+        if(group != NULL){
+            estimated_capacity = group->group_cap;
         }else{
-            estimated_capacity = channel->capacity;
+            estimated_capacity = channel_capacity;
         }
     }
 
     // judge by channel_update (conventional method)
     else if (routing_method == CHANNEL_UPDATE){
 
-        // search for valid channel_updates that is less than channel_capacity starting from the latest
-        struct channel_update* valid_channel_update = NULL;
-        if(edge->channel_updates != NULL) {
-            for(struct element* iterator = edge->channel_updates; iterator->next != NULL; iterator = iterator->next){
-                valid_channel_update = iterator->data;
-
-                // if the valid_channel_update value does not exceed channel_capacity
-                if(valid_channel_update->htlc_maximum_msat < channel->capacity) break;
-
-                // oldest channel_update
-                if(iterator->next == NULL) valid_channel_update = edge->channel_updates->data;
-            }
-        }
-
-        if(valid_channel_update != NULL){
-            estimated_capacity = valid_channel_update->htlc_maximum_msat;
-        }else{
-            estimated_capacity = channel->capacity;
-        }
+        // latest valid channel_update, maintained when the channel_updates are received (see `add_channel_update`)
+        estimated_capacity = store->htlc_maximum_msat[edge_id];
     }
 
     // judge by channel capacity (cloth method)
     else if (routing_method == CLOTH_ORIGINAL){
-        estimated_capacity = channel->capacity;
+        estimated_capacity = channel_capacity;
     }
 
     // judge by edge capacity (ideal for routing but no privacy)
     else if (routing_method == IDEAL){
-        estimated_capacity = edge->balance;
+        estimated_capacity = store->balance[edge_id];
     }
 
     else {
@@ -408,17 +466,28 @@ uint64_t estimate_capacity(struct edge* edge, struct network* network, enum rout
     return estimated_capacity;
 }
 
+/* policy of the edge stored in position `k` of the routing graph */
+static inline struct policy get_routing_graph_policy(struct routing_graph* graph, long k) {
+  struct policy policy;
+  policy.fee_base = graph->fee_base[k];
+  policy.fee_proportional = graph->fee_proportional[k];
+  policy.min_htlc = graph->min_htlc[k];
+  policy.timelock = graph->timelock[k];
+  return policy;
+}
+
 /* a modified version of dijkstra to find a path connecting the source (payment sender) to the target (payment receiver) */
 struct array* dijkstra(long source, long target, uint64_t amount, struct network* network, uint64_t current_time, long p, enum pathfind_error *error, enum routing_method routing_method, struct element* exclude_edges, uint64_t max_fee_limit) {
-  struct distance *d=NULL, to_node_dist;
-  long i, best_node_id, j, from_node_id, curr;
-  struct node *source_node, *best_node;
+  struct distance *d=NULL, *from_node_dist, to_node_dist;
+  long best_node_id, k, edge_id, from_node_id, curr;
+  struct node *source_node;
+  struct routing_graph* graph = routing_graph;
+  struct edge_store* store = network->edge_store;
   struct edge* edge=NULL;
+  struct element* iterator;
   uint64_t edge_timelock, tmp_timelock;
   uint64_t  amt_to_send, edge_fee, tmp_dist, amt_to_receive, total_balance, max_balance, current_dist;
   struct array* hops=NULL; // *best_edges = NULL;
-  struct path_hop* hop=NULL;
-  struct channel* channel;
 
   source_node = array_get(network->nodes, source);
   get_balance(source_node, &max_balance, &total_balance);
@@ -431,58 +500,58 @@ struct array* dijkstra(long source, long target, uint64_t amount, struct network
     return NULL;
   }
 
-  while(heap_len(distance_heap[p])!=0)
-    heap_pop(distance_heap[p], compare_distance);
-
-  for(i=0; i<array_len(network->nodes); i++){
-    distance[p][i].node = i;
-    distance[p][i].distance = INF;
-    distance[p][i].fee = 0;
-    distance[p][i].amt_to_receive = 0;
-    distance[p][i].next_edge = -1;
+  /* start a new generation: all the distances of the previous execution become INF without touching them */
+  heap_clear(distance_heap[p]);
+  ++distance_generation[p];
+
+  /* same for the excluded edges: the marks of the previous execution are stale, so the check in the loop is O(1) */
+  if(exclude_edges != NULL) {
+    ++exclude_generation[p];
+    for(iterator = exclude_edges; iterator != NULL; iterator = iterator->next) {
+      edge = iterator->data;
+      if(edge->id < graph->n_edges)
+        exclude_mark[p][edge->id] = exclude_generation[p];
+    }
   }
 
-  distance[p][target].node = target;
-  distance[p][target].amt_to_receive = amount;
-  distance[p][target].fee = 0;
-  distance[p][target].distance = 0;
-  distance[p][target].timelock = FINALTIMELOCK;
-  distance[p][target].weight = 0;
-  distance[p][target].probability = 1;
+  d = get_distance(p, target);
+  d->amt_to_receive = amount;
+  d->fee = 0;
+  d->distance = 0;
+  d->timelock = FINALTIMELOCK;
+  d->weight = 0;
+  d->probability = 1;
 
-  distance_heap[p] =  heap_insert_or_update(distance_heap[p], &distance[p][target], compare_distance, is_key_equal);
+  distance_heap[p] =  heap_insert_or_update_indexed(distance_heap[p], d, compare_distance, get_distance_heap_index);
 
   while(heap_len(distance_heap[p])!=0) {
 
-    d = heap_pop(distance_heap[p], compare_distance);
+    d = heap_pop_indexed(distance_heap[p], compare_distance, get_distance_heap_index);
     best_node_id = d->node;
     if(best_node_id==source) break;
 
-    to_node_dist = distance[p][best_node_id];
+    to_node_dist = *d;
     amt_to_send = to_node_dist.amt_to_receive;
 
-    best_node = array_get(network->nodes, best_node_id);
     /* best_edges = get_best_edges(best_node_id, amt_to_send, source, network); */
 
-    for(j=0; j<array_len(best_node->open_edges); j++) {
-      edge = array_get(best_node->open_edges, j);
-      edge = array_get(network->edges, edge->counter_edge_id);
+    for(k=graph->offsets[best_node_id]; k<graph->offsets[best_node_id+1]; k++) {
+      edge_id = graph->edge_id[k];
+      from_node_id = graph->from_node_id[k];
 
       if(routing_method == CLOTH_ORIGINAL){
           double edge_probability, tmp_probability, edge_weight, tmp_weight, current_prob;
-          from_node_id = edge->from_node_id;
 
           if(from_node_id == source){
-            if(edge->balance < amt_to_send)
+            if(store->balance[edge_id] < amt_to_send)
               continue;
           }
           else{
-            channel = array_get(network->channels, edge->channel_id);
-            if(channel->capacity < amt_to_send)
+            if(graph->channel_capacity[k] < amt_to_send)
               continue;
           }
 
-          if(amt_to_send < edge->policy.min_htlc)
+          if(amt_to_send < graph->min_htlc[k])
             continue;
 
 
@@ -494,8 +563,8 @@ struct array* dijkstra(long source, long target, uint64_t amount, struct network
           edge_fee = 0;
           edge_timelock = 0;
           if(from_node_id != source){
-            edge_fee = compute_fee(amt_to_send, edge->policy);
-            edge_timelock = edge->policy.timelock;
+            edge_fee = compute_fee(amt_to_send, get_routing_graph_policy(graph, k));
+            edge_timelock = graph->timelock[k];
           }
           uint64_t tmp_fee = to_node_dist.fee + edge_fee;
           if(tmp_fee > max_fee_limit) continue;
@@ -512,45 +581,43 @@ struct array* dijkstra(long source, long target, uint64_t amount, struct network
           tmp_weight = to_node_dist.weight + edge_weight;   // calc weight based on LND
           tmp_dist = get_probability_based_dist(tmp_weight, tmp_probability);   // calc dist based on LND
 
-          current_dist = distance[p][from_node_id].distance;
-          current_prob = distance[p][from_node_id].probability;
+          from_node_dist = get_distance(p, from_node_id);
+          current_dist = from_node_dist->distance;
+          current_prob = from_node_dist->probability;
           if(tmp_dist > current_dist) continue;
           if(tmp_dist == current_dist && tmp_probability <= current_prob) continue;
 
-          distance[p][from_node_id].node = from_node_id;
-          distance[p][from_node_id].distance = tmp_dist;    // calculated by fee, weight, timelock and probability
-          distance[p][from_node_id].weight = tmp_weight;
-          distance[p][from_node_id].amt_to_receive = amt_to_receive;
-          distance[p][from_node_id].timelock = tmp_timelock;
-          distance[p][from_node_id].probability = tmp_probability;  // calculated by edge_probability?
-          distance[p][from_node_id].next_edge = edge->id;
-          distance[p][from_node_id].fee = tmp_fee;
+          from_node_dist->node = from_node_id;
+          from_node_dist->distance = tmp_dist;    // calculated by fee, weight, timelock and probability
+          from_node_dist->weight = tmp_weight;
+          from_node_dist->amt_to_receive = amt_to_receive;
+          from_node_dist->timelock = tmp_timelock;
+          from_node_dist->probability = tmp_probability;  // calculated by edge_probability?
+          from_node_dist->next_edge = edge_id;
+          from_node_dist->fee = tmp_fee;
 
           // update edge weight comparing distance or probability in compare_distance()
-          distance_heap[p] = heap_insert_or_update(distance_heap[p], &distance[p][from_node_id], compare_distance, is_key_equal);
+          distance_heap[p] = heap_insert_or_update_indexed(distance_heap[p], from_node_dist, compare_distance, get_distance_heap_index);
       }
       else{
-          from_node_id = edge->from_node_id;
 
           if(from_node_id == source){   // first hop
-              if(edge->balance < amt_to_send) continue;   // exclude edge whose balance is not enough
+              if(store->balance[edge_id] < amt_to_send) continue;   // exclude edge whose balance is not enough
           }else{
-              uint64_t estimated_capacity = estimate_capacity(edge, network, routing_method);
+              uint64_t estimated_capacity = estimate_edge_capacity(store, edge_id, graph->channel_capacity[k], routing_method);
               if(estimated_capacity < amt_to_send) continue;
           }
 
           // if the edge excluded, skip
-          if(exclude_edges != NULL) {
-              if(is_in_list(exclude_edges, &(edge->id), is_equal_edge)) continue;
-          }
+          if(exclude_edges != NULL && exclude_mark[p][edge_id] == exclude_generation[p]) continue;
 
-          if(amt_to_send < edge->policy.min_htlc) continue;
+          if(amt_to_send < graph->min_htlc[k]) continue;
 
           edge_fee = 0;
           edge_timelock = 0;
           if(from_node_id != source){
-              edge_fee = compute_fee(amt_to_send, edge->policy);
-              edge_timelock = edge->policy.timelock;
+              edge_fee = compute_fee(amt_to_send, get_routing_graph_policy(graph, k));
+              edge_timelock = graph->timelock[k];
           }
           uint64_t tmp_fee = to_node_dist.fee + edge_fee;
           if(tmp_fee > max_fee_limit) continue;
@@ -562,21 +629,22 @@ struct array* dijkstra(long source, long target, uint64_t amount, struct network
 
           // dijkstra link weight update
           tmp_dist = to_node_dist.distance + edge_fee + PAYMENTATTEMPTPENALTY;
-          current_dist = distance[p][from_node_id].distance;
+          from_node_dist = get_distance(p, from_node_id);
+          current_dist = from_node_dist->distance;
           if(tmp_dist > current_dist) continue;
           if(tmp_dist == current_dist) continue;
 
-          distance[p][from_node_id].node = from_node_id;
-          distance[p][from_node_id].distance = tmp_dist;    // find the shortest path only by fee
-          distance[p][from_node_id].weight = 0; // unused
-          distance[p][from_node_id].amt_to_receive = amt_to_receive;
-          distance[p][from_node_id].timelock = tmp_timelock;
-          distance[p][from_node_id].probability = 0; // unused
-          distance[p][from_node_id].next_edge = edge->id;
-          distance[p][from_node_id].fee = tmp_fee;
+          from_node_dist->node = from_node_id;
+          from_node_dist->distance = tmp_dist;    // find the shortest path only by fee
+          from_node_dist->weight = 0; // unused
+          from_node_dist->amt_to_receive = amt_to_receive;
+          from_node_dist->timelock = tmp_timelock;
+          from_node_dist->probability = 0; // unused
+          from_node_dist->next_edge = edge_id;
+          from_node_dist->fee = tmp_fee;
 
           // update edge weight comparing distance or probability in compare_distance()
-          distance_heap[p] = heap_insert_or_update(distance_heap[p], &distance[p][from_node_id], compare_distance, is_key_equal);
+          distance_heap[p] = heap_insert_or_update_indexed(distance_heap[p], from_node_dist, compare_distance, get_distance_heap_index);
       }
     }
   }
@@ -584,14 +652,15 @@ struct array* dijkstra(long source, long target, uint64_t amount, struct network
   hops = array_initialize(5);
   curr = source;
   while(curr!=target) {
-    if(distance[p][curr].next_edge == -1) {
+    d = get_distance(p, curr);
+    if(d->next_edge == -1) {
       *error = NOPATH;
       return NULL;
     }
     struct path_hop* hop = malloc(sizeof(struct path_hop));
     hop->sender = curr;
-    hop->edge = distance[p][curr].next_edge;
-    edge = array_get(network->edges, distance[p][curr].next_edge);
+    hop->edge = d->next_edge;
+    edge = array_get(network->edges, d->next_edge);
     hop->receiver = edge->to_node_id;
     hops=array_insert(hops, hop);
     curr = edge->to_node_id;
@@ -643,8 +712,8 @@ struct route* transform_path_into_route(struct array* path_hops, uint64_t destin
     route_hop->edge_id = path_hop->edge;
     route_hop->edges_lock_start_time = time;
     route_hop->edges_lock_end_time = 0;
-    if(edge->group != NULL) {
-        route_hop->group_cap = edge->group->group_cap;
+    if(edge_get_group(edge) != NULL) {
+        route_hop->group_cap = edge_get_group(edge)->group_cap;
     }else{
         route_hop->group_cap = 0;
     }
@@ -688,3 +757,226 @@ void free_route(struct route* route){
     array_free(route->route_hops);
     free(route);
 }
+
+
+/* ROUTE CACHE */
+
+#define ROUTE_CACHE_BUCKETS_PER_OCTAVE 4
+
+/* amounts are grouped in buckets of a quarter of octave (the two bits after the most significant one) */
+static long get_amount_bucket(uint64_t amount) {
+  long msb;
+  if(amount < ROUTE_CACHE_BUCKETS_PER_OCTAVE) return (long) amount;
+  for(msb = 63; !(amount >> msb); msb--);
+  return msb*ROUTE_CACHE_BUCKETS_PER_OCTAVE + (long)((amount >> (msb-2)) & 3);
+}
+
+static unsigned long hash_route_key(long sender, long receiver, long bucket) {
+  uint64_t h;
+  h = (uint64_t)sender * 0x9E3779B97F4A7C15ULL;
+  h ^= (uint64_t)receiver + 0x7F4A7C159E3779B9ULL + (h << 6) + (h >> 2);
+  h ^= (uint64_t)bucket * 0xC2B2AE3D27D4EB4FULL;
+  h ^= h >> 29;
+  return (unsigned long)h;
+}
+
+static struct route_cache_entry* new_route_cache_entries(long size) {
+  struct route_cache_entry* entries;
+  long i;
+  entries = malloc(sizeof(struct route_cache_entry)*size);
+  if(entries == NULL) {
+    fprintf(stderr, "ERROR: malloc failed for route cache\n");
+    exit(-1);
+  }
+  for(i=0; i<size; i++)
+    entries[i].sender = -1;
+  return entries;
+}
+
+/* sizes are powers of two so that the position in the table is a mask of the hash */
+struct route_cache* route_cache_initialize(long size) {
+  struct route_cache* cache;
+  long table_size;
+  table_size = 8;
+  while(table_size < 2*size) table_size *= 2;
+  cache = malloc(sizeof(struct route_cache));
+  cache->size = table_size;
+  cache->n_entries = 0;
+  cache->entries = new_route_cache_entries(table_size);
+  cache->n_hits = 0;
+  cache->n_misses = 0;
+  cache->n_invalidations = 0;
+  cache->n_rejections = 0;
+  return cache;
+}
+
+static struct route_cache_entry* find_route_cache_entry(struct route_cache* cache, long sender, long receiver, long bucket) {
+  struct route_cache_entry* entry;
+  long slot, mask;
+  mask = cache->size - 1;
+  slot = hash_route_key(sender, receiver, bucket) & mask;
+  while(1) {
+    entry = &(cache->entries[slot]);
+    if(entry->sender == -1 || (entry->sender == sender && entry->receiver == receiver && entry->bucket == bucket))
+      return entry;
+    slot = (slot + 1) & mask;
+  }
+}
+
+static void resize_route_cache(struct route_cache* cache) {
+  struct route_cache_entry *old_entries, *entry;
+  long old_size, i;
+  old_entries = cache->entries;
+  old_size = cache->size;
+  cache->size *= 2;
+  cache->entries = new_route_cache_entries(cache->size);
+  for(i=0; i<old_size; i++) {
+    if(old_entries[i].sender == -1) continue;
+    entry = find_route_cache_entry(cache, old_entries[i].sender, old_entries[i].receiver, old_entries[i].bucket);
+    *entry = old_entries[i];
+  }
+  free(old_entries);
+}
+
+static struct array* copy_path(struct array* path) {
+  struct array* copy;
+  struct path_hop* hop;
+  long i;
+  copy = array_initialize(array_len(path));
+  for(i=0; i<array_len(path); i++) {
+    hop = malloc(sizeof(struct path_hop));
+    *hop = *((struct path_hop*) array_get(path, i));
+    copy = array_insert(copy, hop);
+  }
+  return copy;
+}
+
+static void free_route_cache_entry(struct route_cache_entry* entry) {
+  long i;
+  for(i=0; i<array_len(entry->path); i++)
+    free(array_get(entry->path, i));
+  array_free(entry->path);
+  free(entry->edge_versions);
+  free(entry->groups);
+  free(entry->group_versions);
+}
+
+/* the capacities estimated for the edges of the path did not change since the path was cached */
+static int is_route_cache_entry_valid(struct route_cache_entry* entry, struct network* network, enum routing_method routing_method) {
+  struct path_hop* hop;
+  struct edge* edge;
+  struct group* group;
+  long i;
+  for(i=0; i<array_len(entry->path); i++) {
+    hop = array_get(entry->path, i);
+    edge = array_get(network->edges, hop->edge);
+    if(edge_cold(edge)->version != entry->edge_versions[i])
+      return 0;
+    if(routing_method == GROUP_ROUTING) {
+      group = edge_get_group(edge);
+      if(group != entry->groups[i] || (group != NULL && group->version != entry->group_versions[i]))
+        return 0;
+    }
+  }
+  return 1;
+}
+
+/* check the constraints of dijkstra on the path for this amount: capacities, minimum htlcs and fee limit */
+static int is_path_feasible(struct array* path, uint64_t amount, uint64_t max_fee_limit, struct network* network, enum routing_method routing_method) {
+  struct path_hop* hop;
+  struct edge* edge;
+  uint64_t amt_to_send, fee, total_fee, capacity;
+  long i;
+
+  amt_to_send = amount;
+  total_fee = 0;
+  for(i=array_len(path)-1; i>=0; i--) {
+    hop = array_get(path, i);
+    edge = array_get(network->edges, hop->edge);
+    if(i == 0)
+      capacity = edge_get_balance(edge);
+    else
+      capacity = estimate_capacity(edge, network, routing_method);
+    if(capacity < amt_to_send || amt_to_send < edge->policy.min_htlc)
+      return 0;
+    if(i == 0) break;
+    fee = compute_fee(amt_to_send, edge->policy);
+    total_fee += fee;
+    if(total_fee > max_fee_limit)
+      return 0;
+    amt_to_send += fee;
+  }
+  return 1;
+}
+
+/* return a copy of the path cached for the endpoints and the bucket of the amount, NULL if there is none or it cannot be used */
+struct array* route_cache_get(struct route_cache* cache, long sender, long receiver, uint64_t amount, uint64_t max_fee_limit, struct network* network, enum routing_method routing_method) {
+  struct route_cache_entry* entry;
+
+  entry = find_route_cache_entry(cache, sender, receiver, get_amount_bucket(amount));
+  if(entry->sender == -1) {
+    cache->n_misses++;
+    return NULL;
+  }
+  if(!is_route_cache_entry_valid(entry, network, routing_method)) {
+    cache->n_invalidations++;
+    return NULL;
+  }
+  if(!is_path_feasible(entry->path, amount, max_fee_limit, network, routing_method)) {
+    cache->n_rejections++;
+    return NULL;
+  }
+  cache->n_hits++;
+  return copy_path(entry->path);
+}
+
+/* cache a path found by dijkstra, with the versions of the edges and groups its estimated capacities depend on */
+void route_cache_put(struct route_cache* cache, long sender, long receiver, uint64_t amount, struct array* path, struct network* network) {
+  struct route_cache_entry* entry;
+  struct path_hop* hop;
+  struct edge* edge;
+  struct group* group;
+  long i, bucket, n_hops;
+
+  if(2*(cache->n_entries+1) > cache->size)
+    resize_route_cache(cache);
+
+  bucket = get_amount_bucket(amount);
+  entry = find_route_cache_entry(cache, sender, receiver, bucket);
+  if(entry->sender == -1)
+    cache->n_entries++;
+  else
+    free_route_cache_entry(entry);
+
+  n_hops = array_len(path);
+  entry->sender = sender;
+  entry->receiver = receiver;
+  entry->bucket = bucket;
+  entry->path = copy_path(path);
+  entry->edge_versions = malloc(sizeof(uint64_t)*n_hops);
+  entry->groups = malloc(sizeof(struct group*)*n_hops);
+  entry->group_versions = malloc(sizeof(uint64_t)*n_hops);
+  for(i=0; i<n_hops; i++) {
+    hop = array_get(path, i);
+    edge = array_get(network->edges, hop->edge);
+    group = edge_get_group(edge);
+    entry->edge_versions[i] = edge_cold(edge)->version;
+    entry->groups[i] = group;
+    entry->group_versions[i] = group != NULL ? group->version : 0;
+  }
+}
+
+void print_route_cache_stats(struct route_cache* cache) {
+  printf("Route cache: %ld hits, %ld misses, %ld invalidations, %ld rejected for the amount\n",
+         cache->n_hits, cache->n_misses, cache->n_invalidations, cache->n_rejections);
+}
+
+void route_cache_free(struct route_cache* cache) {
+  long i;
+  if(cache == NULL) return;
+  for(i=0; i<cache->size; i++)
+    if(cache->entries[i].sender != -1)
+      free_route_cache_entry(&(cache->entries[i]));
+  free(cache->entries);
+  free(cache);
+}
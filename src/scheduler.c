@@ -0,0 +1,206 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "../include/scheduler.h"
+#include "../include/event.h"
+
+/* Functions in this file implement the schedulers of the events of the simulation (see `struct scheduler`) */
+
+#define CALENDAR_MIN_BUCKETS 2
+#define CALENDAR_N_SAMPLES 25
+
+/* CALENDAR QUEUE */
+
+static long calendar_bucket(struct calendar_queue* cq, uint64_t time) {
+  return (long)((time / cq->width) % (uint64_t)cq->n_buckets);
+}
+
+/* insert the event in its bucket after the events with lower or equal time */
+static void calendar_link(struct calendar_queue* cq, struct event* event) {
+  struct event *prev, *iterator;
+  long i;
+
+  i = calendar_bucket(cq, event->time);
+  prev = NULL;
+  for(iterator = cq->buckets[i]; iterator != NULL && iterator->time <= event->time; iterator = iterator->next)
+    prev = iterator;
+  event->next = iterator;
+  if(prev == NULL)
+    cq->buckets[i] = event;
+  else
+    prev->next = event;
+  cq->size++;
+}
+
+static void calendar_set_position(struct calendar_queue* cq, uint64_t time) {
+  cq->last_time = time;
+  cq->last_bucket = calendar_bucket(cq, time);
+  cq->bucket_top = (time / cq->width + 1) * cq->width;
+}
+
+/* bucket width estimated from the separation of the earliest events (see Brown's paper);
+   the current width is kept if the events cannot be sampled */
+static uint64_t calendar_sample_width(struct calendar_queue* cq) {
+  uint64_t times[CALENDAR_N_SAMPLES], top, avg, sum_gaps, gap;
+  long n_samples, i, n, n_gaps;
+  struct event* iterator;
+
+  n_samples = 0;
+  i = cq->last_bucket;
+  top = cq->bucket_top;
+  for(n = 0; n < cq->n_buckets && n_samples < CALENDAR_N_SAMPLES; n++) {
+    for(iterator = cq->buckets[i]; iterator != NULL && iterator->time < top && n_samples < CALENDAR_N_SAMPLES; iterator = iterator->next)
+      times[n_samples++] = iterator->time;
+    i = (i + 1) % cq->n_buckets;
+    top += cq->width;
+  }
+  if(n_samples < 2)
+    return cq->width;
+
+  avg = (times[n_samples-1] - times[0]) / (n_samples - 1);
+  sum_gaps = 0;
+  n_gaps = 0;
+  for(i = 1; i < n_samples; i++) {
+    gap = times[i] - times[i-1];
+    if(gap > 2*avg) continue;
+    sum_gaps += gap;
+    n_gaps++;
+  }
+  avg = n_gaps > 0 ? sum_gaps / n_gaps : avg;
+  if(avg == 0)
+    return cq->width;
+  return 3*avg;
+}
+
+static void calendar_resize(struct calendar_queue* cq, long n_buckets) {
+  struct event **old_buckets, *iterator, *next;
+  long old_n_buckets, i;
+
+  cq->width = calendar_sample_width(cq);
+  old_buckets = cq->buckets;
+  old_n_buckets = cq->n_buckets;
+
+  cq->buckets = calloc(n_buckets, sizeof(struct event*));
+  if(cq->buckets == NULL) {
+    fprintf(stderr, "ERROR: calloc failed for calendar queue buckets\n");
+    exit(-1);
+  }
+  cq->n_buckets = n_buckets;
+  cq->size = 0;
+  /* events with the same time are in the same old bucket: moving them in order keeps their insertion order */
+  for(i = 0; i < old_n_buckets; i++) {
+    for(iterator = old_buckets[i]; iterator != NULL; iterator = next) {
+      next = iterator->next;
+      calendar_link(cq, iterator);
+    }
+  }
+  free(old_buckets);
+  calendar_set_position(cq, cq->last_time);
+}
+
+struct calendar_queue* calendar_queue_initialize(void) {
+  struct calendar_queue* cq;
+  cq = malloc(sizeof(struct calendar_queue));
+  cq->n_buckets = CALENDAR_MIN_BUCKETS;
+  cq->buckets = calloc(cq->n_buckets, sizeof(struct event*));
+  cq->width = 1;
+  cq->size = 0;
+  calendar_set_position(cq, 0);
+  return cq;
+}
+
+void calendar_queue_insert(struct calendar_queue* cq, struct event* event) {
+  calendar_link(cq, event);
+  if(event->time < cq->last_time) // the event precedes the last popped one: restart the scan from it
+    calendar_set_position(cq, event->time);
+  if(cq->size > 2*cq->n_buckets)
+    calendar_resize(cq, 2*cq->n_buckets);
+}
+
+struct event* calendar_queue_pop(struct calendar_queue* cq) {
+  struct event* event;
+  long i, n, best;
+  uint64_t top;
+
+  if(cq->size == 0) return NULL;
+
+  event = NULL;
+  i = cq->last_bucket;
+  top = cq->bucket_top;
+  for(n = 0; n < cq->n_buckets; n++) {
+    if(cq->buckets[i] != NULL && cq->buckets[i]->time < top) {
+      event = cq->buckets[i];
+      cq->buckets[i] = event->next;
+      cq->last_bucket = i;
+      cq->bucket_top = top;
+      cq->last_time = event->time;
+      break;
+    }
+    i = (i + 1) % cq->n_buckets;
+    top += cq->width;
+  }
+
+  if(event == NULL) {
+    /* no event in the next year: jump directly to the earliest one */
+    best = -1;
+    for(i = 0; i < cq->n_buckets; i++)
+      if(cq->buckets[i] != NULL && (best == -1 || cq->buckets[i]->time < cq->buckets[best]->time))
+        best = i;
+    event = cq->buckets[best];
+    cq->buckets[best] = event->next;
+    calendar_set_position(cq, event->time);
+  }
+
+  event->next = NULL;
+  cq->size--;
+  if(cq->size < cq->n_buckets/2 && cq->n_buckets > CALENDAR_MIN_BUCKETS)
+    calendar_resize(cq, cq->n_buckets/2);
+
+  return event;
+}
+
+void calendar_queue_free(struct calendar_queue* cq) {
+  free(cq->buckets);
+  free(cq);
+}
+
+/* SCHEDULER */
+
+struct scheduler* scheduler_initialize(enum scheduler_type type, long size) {
+  struct scheduler* scheduler;
+  scheduler = malloc(sizeof(struct scheduler));
+  scheduler->type = type;
+  scheduler->heap = NULL;
+  scheduler->calendar_queue = NULL;
+  if(type == CALENDAR_QUEUE_SCHEDULER)
+    scheduler->calendar_queue = calendar_queue_initialize();
+  else
+    scheduler->heap = heap_initialize(size);
+  return scheduler;
+}
+
+void scheduler_insert(struct scheduler* scheduler, struct event* event) {
+  if(scheduler->type == CALENDAR_QUEUE_SCHEDULER)
+    calendar_queue_insert(scheduler->calendar_queue, event);
+  else
+    scheduler->heap = heap_insert(scheduler->heap, event, compare_event);
+}
+
+struct event* scheduler_pop(struct scheduler* scheduler) {
+  if(scheduler->type == CALENDAR_QUEUE_SCHEDULER)
+    return calendar_queue_pop(scheduler->calendar_queue);
+  return heap_pop(scheduler->heap, compare_event);
+}
+
+long scheduler_len(struct scheduler* scheduler) {
+  if(scheduler->type == CALENDAR_QUEUE_SCHEDULER)
+    return scheduler->calendar_queue->size;
+  return heap_len(scheduler->heap);
+}
+
+void scheduler_free(struct scheduler* scheduler) {
+  if(scheduler->type == CALENDAR_QUEUE_SCHEDULER)
+    calendar_queue_free(scheduler->calendar_queue);
+  else
+    heap_free(scheduler->heap);
+  free(scheduler);
+}
@@ -0,0 +1,187 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../include/snapshot.h"
+#include "../include/array.h"
+
+/* Functions in this file load a network from a binary snapshot mapped in memory (see snapshot.h) */
+
+static const char* section_names[N_SNAPSHOT_SECTIONS] = {"nodes", "channels", "edges"};
+static const uint64_t record_sizes[N_SNAPSHOT_SECTIONS] = {SNAPSHOT_NODE_RECORD_SIZE, SNAPSHOT_CHANNEL_RECORD_SIZE, SNAPSHOT_EDGE_RECORD_SIZE};
+
+/* little-endian readers, independent of the byte order of the host */
+static inline uint32_t get_u32(const unsigned char* p) {
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline uint64_t get_u64(const unsigned char* p) {
+  return (uint64_t)get_u32(p) | (uint64_t)get_u32(p + 4) << 32;
+}
+
+static inline long get_long(const unsigned char* p) {
+  return (long)(int64_t)get_u64(p);
+}
+
+/* CRC-32 (IEEE 802.3, the one of zlib), computed a byte at a time with a table */
+static uint32_t crc32_update(uint32_t crc, const unsigned char* data, size_t size) {
+  static uint32_t table[256];
+  static int is_table_ready = 0;
+  uint32_t c;
+  size_t i;
+  int j;
+
+  if(!is_table_ready) {
+    for(i = 0; i < 256; i++) {
+      c = (uint32_t) i;
+      for(j = 0; j < 8; j++)
+        c = c & 1 ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+      table[i] = c;
+    }
+    is_table_ready = 1;
+  }
+
+  crc = ~crc;
+  for(i = 0; i < size; i++)
+    crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+static void snapshot_error(char filename[], const char* message) {
+  fprintf(stderr, "ERROR: wrong network snapshot <%s>: %s\n", filename, message);
+  exit(-1);
+}
+
+static void check_id(char filename[], long id, long n, const char* what) {
+  if(id < 0 || id >= n) {
+    fprintf(stderr, "ERROR: wrong network snapshot <%s>: %s <%ld> does not exist\n", filename, what, id);
+    exit(-1);
+  }
+}
+
+struct network* load_network_snapshot(char filename[]) {
+  int file;
+  struct stat file_stat;
+  const unsigned char *data, *section, *record;
+  unsigned char zero[4] = {0, 0, 0, 0};
+  size_t size;
+  uint64_t offsets[N_SNAPSHOT_SECTIONS], n_records[N_SNAPSHOT_SECTIONS];
+  uint32_t checksum;
+  long i, n_nodes, n_channels, n_edges, *n_open_edges;
+  struct network* network;
+  struct node* node;
+  struct channel* channel;
+  struct edge* edge;
+  struct policy policy;
+
+  file = open(filename, O_RDONLY);
+  if(file < 0) {
+    fprintf(stderr, "ERROR: cannot open file <%s>\n", filename);
+    exit(-1);
+  }
+  if(fstat(file, &file_stat) != 0) {
+    fprintf(stderr, "ERROR: cannot stat file <%s>\n", filename);
+    exit(-1);
+  }
+  size = file_stat.st_size;
+  if(size < SNAPSHOT_HEADER_SIZE + N_SNAPSHOT_SECTIONS*SNAPSHOT_SECTION_SIZE)
+    snapshot_error(filename, "file too short");
+  data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, file, 0);
+  close(file);
+  if(data == MAP_FAILED) {
+    fprintf(stderr, "ERROR: cannot map file <%s> in memory\n", filename);
+    exit(-1);
+  }
+  madvise((void*) data, size, MADV_SEQUENTIAL);
+
+  if(memcmp(data, SNAPSHOT_MAGIC, strlen(SNAPSHOT_MAGIC)) != 0)
+    snapshot_error(filename, "not a network snapshot");
+  if(get_u32(data + 8) != SNAPSHOT_VERSION)
+    snapshot_error(filename, "unsupported version");
+  if(get_u32(data + 12) != N_SNAPSHOT_SECTIONS)
+    snapshot_error(filename, "wrong number of sections");
+
+  checksum = crc32_update(0, data, SNAPSHOT_CHECKSUM_OFFSET);
+  checksum = crc32_update(checksum, zero, 4);
+  checksum = crc32_update(checksum, data + SNAPSHOT_CHECKSUM_OFFSET + 4, size - SNAPSHOT_CHECKSUM_OFFSET - 4);
+  if(checksum != get_u32(data + SNAPSHOT_CHECKSUM_OFFSET))
+    snapshot_error(filename, "wrong checksum");
+
+  for(i = 0; i < N_SNAPSHOT_SECTIONS; i++) {
+    section = data + SNAPSHOT_HEADER_SIZE + i*SNAPSHOT_SECTION_SIZE;
+    if(strncmp((const char*) section, section_names[i], SNAPSHOT_SECTION_NAME_SIZE) != 0)
+      snapshot_error(filename, "wrong section name");
+    offsets[i] = get_u64(section + 8);
+    n_records[i] = get_u64(section + 16);
+    if(get_u64(section + 24) != record_sizes[i])
+      snapshot_error(filename, "wrong record size");
+    if(offsets[i] > size || n_records[i] > (size - offsets[i]) / record_sizes[i])
+      snapshot_error(filename, "section out of the file");
+  }
+  n_nodes = n_records[SNAPSHOT_NODES];
+  n_channels = n_records[SNAPSHOT_CHANNELS];
+  n_edges = n_records[SNAPSHOT_EDGES];
+
+  network = (struct network*) malloc(sizeof(struct network));
+  network->faulty_node_prob = NULL;
+  network->nodes = array_initialize(n_nodes > 0 ? n_nodes : 1);
+  network->channels = array_initialize(n_channels > 0 ? n_channels : 1);
+  network->edges = array_initialize(n_edges > 0 ? n_edges : 1);
+  network->edge_store = new_edge_store(n_edges > 0 ? n_edges : 1);
+
+  /* the open edges of each node are allocated at their final size */
+  n_open_edges = calloc(n_nodes > 0 ? n_nodes : 1, sizeof(long));
+  record = data + offsets[SNAPSHOT_EDGES];
+  for(i = 0; i < n_edges; i++, record += SNAPSHOT_EDGE_RECORD_SIZE) {
+    check_id(filename, get_long(record + 24), n_nodes, "node");
+    n_open_edges[get_long(record + 24)]++;
+  }
+
+  record = data + offsets[SNAPSHOT_NODES];
+  for(i = 0; i < n_nodes; i++, record += SNAPSHOT_NODE_RECORD_SIZE) {
+    if(get_long(record) != i)
+      snapshot_error(filename, "nodes not in id order");
+    node = new_node(i);
+    array_free(node->open_edges);
+    node->open_edges = array_initialize(n_open_edges[i] > 0 ? n_open_edges[i] : 1);
+    network->nodes = array_insert(network->nodes, node);
+  }
+  free(n_open_edges);
+
+  record = data + offsets[SNAPSHOT_CHANNELS];
+  for(i = 0; i < n_channels; i++, record += SNAPSHOT_CHANNEL_RECORD_SIZE) {
+    if(get_long(record) != i)
+      snapshot_error(filename, "channels not in id order");
+    check_id(filename, get_long(record + 8), n_edges, "edge");
+    check_id(filename, get_long(record + 16), n_edges, "edge");
+    check_id(filename, get_long(record + 24), n_nodes, "node");
+    check_id(filename, get_long(record + 32), n_nodes, "node");
+    channel = new_channel(i, get_long(record + 8), get_long(record + 16), get_long(record + 24), get_long(record + 32), get_u64(record + 40));
+    network->channels = array_insert(network->channels, channel);
+  }
+
+  record = data + offsets[SNAPSHOT_EDGES];
+  for(i = 0; i < n_edges; i++, record += SNAPSHOT_EDGE_RECORD_SIZE) {
+    if(get_long(record) != i)
+      snapshot_error(filename, "edges not in id order");
+    check_id(filename, get_long(record + 8), n_channels, "channel");
+    check_id(filename, get_long(record + 16), n_edges, "edge");
+    check_id(filename, get_long(record + 32), n_nodes, "node");
+    policy.fee_base = get_u64(record + 48);
+    policy.fee_proportional = get_u64(record + 56);
+    policy.min_htlc = get_u64(record + 64);
+    policy.timelock = get_u32(record + 72);
+    channel = array_get(network->channels, get_long(record + 8));
+    edge = new_edge(network->edge_store, i, channel->id, get_long(record + 16), get_long(record + 24), get_long(record + 32),
+                    get_u64(record + 40), policy, channel->capacity);
+    network->edges = array_insert(network->edges, edge);
+    node = array_get(network->nodes, edge->from_node_id);
+    node->open_edges = array_insert(node->open_edges, &(edge->id));
+  }
+
+  munmap((void*) data, size);
+  return network;
+}
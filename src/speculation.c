@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "../include/speculation.h"
+#include "../include/htlc.h"
+#include "../include/routing.h"
+
+/* Functions in this file implement the speculative path finding (see `struct speculation`) */
+
+struct speculation* speculation=NULL;
+
+struct speculation_args {
+  struct network* network;
+  uint64_t current_time;
+  uint64_t network_version;
+  enum routing_method routing_method;
+};
+
+struct speculation* speculation_initialize(long window) {
+  struct speculation* s;
+  s = malloc(sizeof(struct speculation));
+  s->window = window > 0 ? window : 1;
+  s->next_payment = 0;
+  s->pending_retries = array_initialize(64);
+  s->jobs_size = s->window + 64;
+  s->jobs = malloc(sizeof(struct speculation_job)*s->jobs_size);
+  s->n_rounds = 0;
+  s->n_speculated = 0;
+  s->n_exact = 0;
+  s->n_validated = 0;
+  s->n_stale = 0;
+  return s;
+}
+
+/* a retry of the payment was scheduled: its path is found in the next round */
+void add_pending_retry(struct payment* payment) {
+  speculation->pending_retries = array_insert(speculation->pending_retries, payment);
+}
+
+static void free_path(struct array* path) {
+  long i;
+  if(path == NULL) return;
+  for(i=0; i<array_len(path); i++)
+    free(array_get(path, i));
+  array_free(path);
+}
+
+void discard_speculated_path(struct payment* payment) {
+  if(payment->speculated_path == NULL) return;
+  free_path(payment->speculated_path->path);
+  free(payment->speculated_path);
+  payment->speculated_path = NULL;
+}
+
+static long add_job(long n_jobs, struct payment* payment, int attempt) {
+  if(n_jobs >= speculation->jobs_size) {
+    speculation->jobs_size *= 2;
+    speculation->jobs = realloc(speculation->jobs, sizeof(struct speculation_job)*speculation->jobs_size);
+    if(speculation->jobs == NULL) {
+      fprintf(stderr, "ERROR: realloc failed for speculation jobs\n");
+      exit(-1);
+    }
+  }
+  speculation->jobs[n_jobs].payment = payment;
+  speculation->jobs[n_jobs].attempt = attempt;
+  return n_jobs + 1;
+}
+
+/* a job of the thread pool: find the path of the speculation job with index `job_index` */
+static void speculation_job(long job_index, long thread_index, void* arg) {
+  struct speculation_args* args = (struct speculation_args*) arg;
+  struct speculation_job* job;
+  struct speculated_path* speculated;
+
+  job = &(speculation->jobs[job_index]);
+  speculated = malloc(sizeof(struct speculated_path));
+  speculated->path = find_payment_path(job->payment, job->attempt, args->network, args->current_time, thread_index+1, args->routing_method);
+  speculated->attempt = job->attempt;
+  speculated->network_version = args->network_version;
+  speculated->time = args->current_time;
+  job->payment->speculated_path = speculated;
+}
+
+/* find in parallel the paths of `payment` (whose attempt is being executed), of the scheduled retries and of the next payments to be started */
+static void speculate_paths(struct payment* payment, struct array* payments, struct network* network, uint64_t current_time, enum routing_method routing_method) {
+  struct speculation_args args;
+  struct payment* p;
+  long i, n_jobs, n_first_attempts;
+
+  n_jobs = add_job(0, payment, payment->attempts);
+
+  for(i=0; i<array_len(speculation->pending_retries); i++) {
+    p = array_get(speculation->pending_retries, i);
+    if(p == payment || p->speculated_path != NULL || p->end_time != 0) continue;
+    n_jobs = add_job(n_jobs, p, p->attempts + 1);
+  }
+  array_delete_all(speculation->pending_retries);
+
+  n_first_attempts = 0;
+  for(; speculation->next_payment < array_len(payments) && n_first_attempts < speculation->window; speculation->next_payment++) {
+    p = array_get(payments, speculation->next_payment);
+    if(p == payment || p->attempts != 0 || p->speculated_path != NULL) continue;
+    n_jobs = add_job(n_jobs, p, 1);
+    n_first_attempts++;
+  }
+
+  args.network = network;
+  args.current_time = current_time;
+  args.network_version = network_version;
+  args.routing_method = routing_method;
+  thread_pool_run(thread_pool, n_jobs, 1, speculation_job, &args);
+
+  speculation->n_rounds++;
+  speculation->n_speculated += n_jobs;
+}
+
+/* return the path of the current attempt of a payment: the speculated one if it is still valid, a new one otherwise */
+struct array* get_speculated_path(struct payment* payment, struct array* payments, struct network* network, uint64_t current_time, enum routing_method routing_method) {
+  struct speculated_path* speculated;
+  struct array* path;
+
+  if(payment->speculated_path != NULL && payment->speculated_path->attempt != payment->attempts)
+    discard_speculated_path(payment);
+  if(payment->speculated_path == NULL)
+    speculate_paths(payment, payments, network, current_time, routing_method);
+
+  speculated = payment->speculated_path;
+  payment->speculated_path = NULL;
+  path = speculated->path;
+
+  /* same state of the network: the path is the one a synchronous search would find now
+     (in the cloth method the probabilities of the edges depend also on the time) */
+  if(speculated->network_version == network_version && (routing_method != CLOTH_ORIGINAL || speculated->time == current_time))
+    speculation->n_exact++;
+  else if(path != NULL && has_path_enough_capacity(path, payment, network, current_time, routing_method))
+    speculation->n_validated++;
+  else {
+    speculation->n_stale++;
+    free_path(path);
+    path = find_payment_path(payment, payment->attempts, network, current_time, 0, routing_method);
+  }
+
+  free(speculated);
+  return path;
+}
+
+void print_speculation_stats(struct speculation* speculation) {
+  printf("Speculative pathfinding: %ld rounds, %ld paths speculated, %ld used as found, %ld validated, %ld found again\n",
+         speculation->n_rounds, speculation->n_speculated, speculation->n_exact, speculation->n_validated, speculation->n_stale);
+}
+
+void speculation_free(struct speculation* speculation) {
+  if(speculation == NULL) return;
+  array_free(speculation->pending_retries);
+  free(speculation->jobs);
+  free(speculation);
+}
@@ -0,0 +1,220 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "../include/sweep.h"
+
+/* Functions in this file read the points of a parameter sweep and simulate them in child processes (see sweep.h) */
+
+static void copy_token(char* destination, size_t size, const char* token, const char* what, long line_number) {
+  if(strlen(token) >= size) {
+    fprintf(stderr, "ERROR: %s too long at line %ld of the sweep file\n", what, line_number);
+    exit(-1);
+  }
+  strcpy(destination, token);
+}
+
+struct array* read_sweep_points(char filename[]) {
+  FILE* sweep_file;
+  struct array* points;
+  struct sweep_point* point, *other;
+  char line[8192], *token, *equal;
+  long line_number, i;
+
+  sweep_file = fopen(filename, "r");
+  if(sweep_file == NULL) {
+    fprintf(stderr, "ERROR: cannot open the sweep file <%s>\n", filename);
+    exit(-1);
+  }
+
+  points = array_initialize(16);
+  line_number = 0;
+  while(fgets(line, sizeof(line), sweep_file)) {
+    line_number++;
+    line[strcspn(line, "\r\n")] = '\0';
+    token = strtok(line, " \t");
+    if(token == NULL || token[0] == '#')
+      continue;
+
+    point = malloc(sizeof(struct sweep_point));
+    copy_token(point->name, sizeof(point->name), token, "name", line_number);
+    if(strchr(point->name, '/') != NULL || strcmp(point->name, ".") == 0 || strcmp(point->name, "..") == 0) {
+      fprintf(stderr, "ERROR: wrong name <%s> at line %ld of the sweep file, it must be a directory name\n", point->name, line_number);
+      exit(-1);
+    }
+    for(i = 0; i < array_len(points); i++) {
+      other = array_get(points, i);
+      if(strcmp(other->name, point->name) == 0) {
+        fprintf(stderr, "ERROR: point <%s> repeated at line %ld of the sweep file\n", point->name, line_number);
+        exit(-1);
+      }
+    }
+
+    point->n_overrides = 0;
+    while((token = strtok(NULL, " \t")) != NULL) {
+      equal = strchr(token, '=');
+      if(equal == NULL || equal == token) {
+        fprintf(stderr, "ERROR: wrong override <%s> at line %ld of the sweep file, use <parameter>=<value>\n", token, line_number);
+        exit(-1);
+      }
+      if(point->n_overrides == SWEEP_MAX_OVERRIDES) {
+        fprintf(stderr, "ERROR: more than %d overrides at line %ld of the sweep file\n", SWEEP_MAX_OVERRIDES, line_number);
+        exit(-1);
+      }
+      *equal = '\0';
+      copy_token(point->parameters[point->n_overrides], sizeof(point->parameters[0]), token, "parameter", line_number);
+      copy_token(point->values[point->n_overrides], sizeof(point->values[0]), equal + 1, "value", line_number);
+      point->n_overrides++;
+    }
+    points = array_insert(points, point);
+  }
+
+  fclose(sweep_file);
+  return points;
+}
+
+/* copy cloth_input.txt in the output directory of the point, with its overrides applied */
+static void write_point_input(struct sweep_point* point, char output_dir_name[]) {
+  FILE* input_file, *point_input_file;
+  char line[1024], parameter[1024], filename[1100];
+  int* is_written;
+  long i;
+
+  snprintf(filename, sizeof(filename), "%scloth_input.txt", output_dir_name);
+  input_file = fopen("cloth_input.txt", "r");
+  point_input_file = fopen(filename, "w");
+  if(input_file == NULL || point_input_file == NULL) {
+    fprintf(stderr, "ERROR: cannot write <%s>\n", filename);
+    exit(-1);
+  }
+
+  is_written = calloc(point->n_overrides + 1, sizeof(int));
+  while(fgets(line, sizeof(line), input_file)) {
+    line[strcspn(line, "\r\n")] = '\0';
+    strcpy(parameter, line);
+    parameter[strcspn(parameter, "=")] = '\0';
+    for(i = 0; i < point->n_overrides; i++)
+      if(strcmp(parameter, point->parameters[i]) == 0)
+        break;
+    if(i < point->n_overrides) {
+      fprintf(point_input_file, "%s=%s\n", point->parameters[i], point->values[i]);
+      is_written[i] = 1;
+    }
+    else
+      fprintf(point_input_file, "%s\n", line);
+  }
+  for(i = 0; i < point->n_overrides; i++)
+    if(!is_written[i])
+      fprintf(point_input_file, "%s=%s\n", point->parameters[i], point->values[i]);
+
+  free(is_written);
+  fclose(input_file);
+  fclose(point_input_file);
+}
+
+/* create the child process which simulates a point; its standard output and error go to cloth.log in the output directory of the point */
+static pid_t start_point(struct sweep_point* point, char output_dir_name[], sweep_job job, void* arg) {
+  char point_dir_name[1024], log_filename[1100];
+  size_t len;
+  pid_t pid;
+  int log_file, status;
+
+  len = strlen(output_dir_name);
+  snprintf(point_dir_name, sizeof(point_dir_name), "%s%s%s/", output_dir_name, len > 0 && output_dir_name[len-1] == '/' ? "" : "/", point->name);
+  if(mkdir(point_dir_name, 0755) != 0 && errno != EEXIST) {
+    fprintf(stderr, "ERROR: cannot create the directory <%s>\n", point_dir_name);
+    exit(-1);
+  }
+
+  pid = fork();
+  if(pid < 0) {
+    fprintf(stderr, "ERROR: fork failed for the point <%s>\n", point->name);
+    exit(-1);
+  }
+  if(pid > 0)
+    return pid;
+
+  snprintf(log_filename, sizeof(log_filename), "%scloth.log", point_dir_name);
+  log_file = open(log_filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if(log_file < 0) {
+    fprintf(stderr, "ERROR: cannot open <%s>\n", log_filename);
+    _exit(-1);
+  }
+  dup2(log_file, STDOUT_FILENO);
+  dup2(log_file, STDERR_FILENO);
+  close(log_file);
+
+  write_point_input(point, point_dir_name);
+  status = job(point, point_dir_name, arg);
+  fflush(stdout);
+  fflush(stderr);
+  _exit(status);
+}
+
+/* simulate the points in child processes, at most `max_processes` at a time; it returns the number of points which failed */
+long run_sweep(struct array* points, char output_dir_name[], long max_processes, sweep_job job, void* arg) {
+  struct sweep_point* point;
+  pid_t* pids, pid;
+  long i, n_points, next_point, n_running, n_done, n_failed;
+  int status;
+
+  n_points = array_len(points);
+  pids = malloc(sizeof(pid_t)*(n_points > 0 ? n_points : 1));
+  if(max_processes < 1)
+    max_processes = 1;
+
+  /* the buffered output of the parent would be written again by the children */
+  fflush(stdout);
+  fflush(stderr);
+
+  next_point = n_running = n_done = n_failed = 0;
+  while(n_done < n_points) {
+    while(n_running < max_processes && next_point < n_points) {
+      point = array_get(points, next_point);
+      pids[next_point] = start_point(point, output_dir_name, job, arg);
+      printf("sweep: point %s started (pid %d)\n", point->name, (int) pids[next_point]);
+      fflush(stdout);
+      next_point++;
+      n_running++;
+    }
+
+    pid = wait(&status);
+    if(pid < 0) {
+      if(errno == EINTR)
+        continue;
+      fprintf(stderr, "ERROR: wait failed in the sweep\n");
+      exit(-1);
+    }
+    for(i = 0; i < next_point && pids[i] != pid; i++);
+    if(i == next_point)
+      continue;
+    point = array_get(points, i);
+    n_running--;
+    n_done++;
+    if(WIFEXITED(status) && WEXITSTATUS(status) == 0)
+      printf("sweep: point %s done (%ld/%ld)\n", point->name, n_done, n_points);
+    else {
+      n_failed++;
+      if(WIFSIGNALED(status))
+        printf("sweep: point %s killed by signal %d (%ld/%ld)\n", point->name, WTERMSIG(status), n_done, n_points);
+      else
+        printf("sweep: point %s failed with status %d (%ld/%ld), see its cloth.log\n", point->name, WEXITSTATUS(status), n_done, n_points);
+    }
+    fflush(stdout);
+  }
+
+  free(pids);
+  return n_failed;
+}
+
+void free_sweep_points(struct array* points) {
+  long i;
+  for(i = 0; i < array_len(points); i++)
+    free(array_get(points, i));
+  array_free(points);
+}
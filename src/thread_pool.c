@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "../include/thread_pool.h"
+
+/* Functions in this file implement a persistent pool of worker threads (see `struct thread_pool`) */
+
+struct worker_args {
+  struct thread_pool* pool;
+  long thread_index;
+};
+
+/* number of threads to use: the configured one, or the number of online processors if it is not positive */
+long get_n_threads(long configured_threads) {
+  long n;
+  if(configured_threads > 0)
+    return configured_threads;
+  n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? n : 1;
+}
+
+static void* thread_pool_worker(void* arg) {
+  struct worker_args* worker_args = (struct worker_args*) arg;
+  struct thread_pool* pool = worker_args->pool;
+  long thread_index = worker_args->thread_index;
+  unsigned long seen_run_id = 0;
+  long start, end, i;
+
+  free(worker_args);
+
+  while(1) {
+    pthread_mutex_lock(&(pool->mutex));
+    while(pool->run_id == seen_run_id && !pool->shutdown)
+      pthread_cond_wait(&(pool->work_available), &(pool->mutex));
+    if(pool->shutdown) {
+      pthread_mutex_unlock(&(pool->mutex));
+      break;
+    }
+    seen_run_id = pool->run_id;
+    pthread_mutex_unlock(&(pool->mutex));
+
+    while((start = atomic_fetch_add(&(pool->next_job), pool->batch_size)) < pool->n_jobs) {
+      end = start + pool->batch_size;
+      if(end > pool->n_jobs) end = pool->n_jobs;
+      for(i = start; i < end; i++)
+        pool->job(i, thread_index, pool->arg);
+    }
+
+    pthread_mutex_lock(&(pool->mutex));
+    if(--(pool->n_active) == 0)
+      pthread_cond_signal(&(pool->work_done));
+    pthread_mutex_unlock(&(pool->mutex));
+  }
+
+  return NULL;
+}
+
+struct thread_pool* thread_pool_initialize(long n_threads) {
+  struct thread_pool* pool;
+  struct worker_args* worker_args;
+  long i;
+
+  pool = malloc(sizeof(struct thread_pool));
+  pool->n_threads = n_threads;
+  pool->tid = malloc(sizeof(pthread_t)*n_threads);
+  pthread_mutex_init(&(pool->mutex), NULL);
+  pthread_cond_init(&(pool->work_available), NULL);
+  pthread_cond_init(&(pool->work_done), NULL);
+  pool->run_id = 0;
+  pool->n_active = 0;
+  pool->shutdown = 0;
+  pool->job = NULL;
+  pool->arg = NULL;
+  pool->n_jobs = 0;
+  pool->batch_size = 1;
+  atomic_init(&(pool->next_job), 0);
+
+  for(i = 0; i < n_threads; i++) {
+    worker_args = malloc(sizeof(struct worker_args));
+    worker_args->pool = pool;
+    worker_args->thread_index = i;
+    if(pthread_create(&(pool->tid[i]), NULL, thread_pool_worker, worker_args) != 0) {
+      fprintf(stderr, "ERROR: cannot create thread %ld of the thread pool\n", i);
+      exit(-1);
+    }
+  }
+
+  return pool;
+}
+
+/* execute the jobs [0, n_jobs) in the worker threads and wait for their completion */
+void thread_pool_run(struct thread_pool* pool, long n_jobs, long batch_size, thread_pool_job job, void* arg) {
+  if(n_jobs <= 0) return;
+
+  pthread_mutex_lock(&(pool->mutex));
+  pool->job = job;
+  pool->arg = arg;
+  pool->n_jobs = n_jobs;
+  pool->batch_size = batch_size > 0 ? batch_size : 1;
+  atomic_store(&(pool->next_job), 0);
+  pool->n_active = pool->n_threads;
+  pool->run_id++;
+  pthread_cond_broadcast(&(pool->work_available));
+  while(pool->n_active > 0)
+    pthread_cond_wait(&(pool->work_done), &(pool->mutex));
+  pthread_mutex_unlock(&(pool->mutex));
+}
+
+void thread_pool_free(struct thread_pool* pool) {
+  long i;
+  if(pool == NULL) return;
+  pthread_mutex_lock(&(pool->mutex));
+  pool->shutdown = 1;
+  pthread_cond_broadcast(&(pool->work_available));
+  pthread_mutex_unlock(&(pool->mutex));
+  for(i = 0; i < pool->n_threads; i++)
+    pthread_join(pool->tid[i], NULL);
+  pthread_mutex_destroy(&(pool->mutex));
+  pthread_cond_destroy(&(pool->work_available));
+  pthread_cond_destroy(&(pool->work_done));
+  free(pool->tid);
+  free(pool);
+}
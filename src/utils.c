@@ -2,14 +2,6 @@
 #include "../include/utils.h"
 #include "../include/routing.h"
 
-int is_equal_result(struct node_pair_result *a, struct node_pair_result *b ){
-  return a->to_node_id == b->to_node_id;
-}
-
-int is_equal_key_result(long key, struct node_pair_result *a){
-  return key == a->to_node_id;
-}
-
 int is_equal_long(long* a, long* b) {
   return *a==*b;
 }
@@ -38,9 +30,9 @@ int is_present(long element, struct array* long_array) {
 int can_join_group(struct group* group, struct edge* edge){
 
   if (!group || !edge) return 0;
-  if (edge->group != NULL) return 0;
+  if (edge_get_group(edge) != NULL) return 0;
 
-  if(edge->balance < group->min_cap_limit || edge->balance > group->max_cap_limit){
+  if(edge_get_balance(edge) < group->min_cap_limit || edge_get_balance(edge) > group->max_cap_limit){
     return 0;
   }
 
@@ -65,10 +57,10 @@ int can_fill_group(struct group* group, struct edge* edge, struct network_params
   if ((long)array_len(group->edges) >= (long)net_params.group_size) return 0;
 
   /* 既に所属している edge は不可 */
-  if (edge->group != NULL) return 0;
+  if (edge_get_group(edge) != NULL) return 0;
 
   /* (d) group_cap を下げない：補充で公開最小値が下がるのを抑止 */
-  if (edge->balance < group->group_cap) return 0;
+  if (edge_get_balance(edge) < group->group_cap) return 0;
 
   /* (a)(b) レンジ＋構造（ノード共有禁止等）は既存判定を流用 */
   return can_join_group(group, edge);